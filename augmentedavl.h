@@ -0,0 +1,369 @@
+#ifndef AUGMENTEDAVL_H
+#define AUGMENTEDAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include "avlbst.h"
+
+/*
+ * An aggregate for AugmentedAVLTree is a monoid over the tree's items:
+ *
+ *   typedef ... type;                                  summary type
+ *   static type identity();                            summary of no items
+ *   static type lift(const Key&, const Value&);        summary of one item
+ *   static type combine(const type&, const type&);     associative
+ *
+ * combine is always called with the smaller keys on the left, so it does
+ * not need to be commutative. The three below cover the common cases.
+ */
+
+/**
+* Sum of the values.
+*/
+template <typename Key, typename Value>
+struct SumAggregate
+{
+    typedef Value type;
+    static type identity() { return Value(); }
+    static type lift(const Key&, const Value& value) { return value; }
+    static type combine(const type& a, const type& b) { return a + b; }
+};
+
+/**
+* Smallest value.
+*/
+template <typename Key, typename Value>
+struct MinAggregate
+{
+    typedef Value type;
+    static type identity() { return std::numeric_limits<Value>::max(); }
+    static type lift(const Key&, const Value& value) { return value; }
+    static type combine(const type& a, const type& b) { return std::min(a, b); }
+};
+
+/**
+* Largest value.
+*/
+template <typename Key, typename Value>
+struct MaxAggregate
+{
+    typedef Value type;
+    static type identity() { return std::numeric_limits<Value>::lowest(); }
+    static type lift(const Key&, const Value& value) { return value; }
+    static type combine(const type& a, const type& b) { return std::max(a, b); }
+};
+
+/**
+* An AVLNode that also stores the aggregate of its whole subtree.
+*/
+template <typename Key, typename Value, typename Aggregate>
+class AugmentedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    typedef typename Aggregate::type Summary;
+
+    AugmentedAVLNode(const Key& key, const Value& value, AugmentedAVLNode<Key, Value, Aggregate>* parent);
+    virtual ~AugmentedAVLNode();
+
+    const Summary& getSummary() const;
+    void setSummary(const Summary& summary);
+
+    virtual AugmentedAVLNode<Key, Value, Aggregate>* getParent() const override;
+    virtual AugmentedAVLNode<Key, Value, Aggregate>* getLeft() const override;
+    virtual AugmentedAVLNode<Key, Value, Aggregate>* getRight() const override;
+
+protected:
+    Summary summary_;
+};
+
+/*
+  ------------------------------------------------------
+  Begin implementations for the AugmentedAVLNode class.
+  ------------------------------------------------------
+*/
+
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>::AugmentedAVLNode(const Key& key, const Value& value, AugmentedAVLNode<Key, Value, Aggregate>* parent) :
+    AVLNode<Key, Value>(key, value, parent), summary_(Aggregate::lift(key, value))
+{
+
+}
+
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>::~AugmentedAVLNode()
+{
+
+}
+
+template<class Key, class Value, class Aggregate>
+const typename AugmentedAVLNode<Key, Value, Aggregate>::Summary&
+AugmentedAVLNode<Key, Value, Aggregate>::getSummary() const
+{
+    return summary_;
+}
+
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLNode<Key, Value, Aggregate>::setSummary(const Summary& summary)
+{
+    summary_ = summary;
+}
+
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>* AugmentedAVLNode<Key, Value, Aggregate>::getParent() const
+{
+    return static_cast<AugmentedAVLNode<Key, Value, Aggregate>*>(this->parent_);
+}
+
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>* AugmentedAVLNode<Key, Value, Aggregate>::getLeft() const
+{
+    return static_cast<AugmentedAVLNode<Key, Value, Aggregate>*>(this->left_);
+}
+
+template<class Key, class Value, class Aggregate>
+AugmentedAVLNode<Key, Value, Aggregate>* AugmentedAVLNode<Key, Value, Aggregate>::getRight() const
+{
+    return static_cast<AugmentedAVLNode<Key, Value, Aggregate>*>(this->right_);
+}
+
+/*
+  ----------------------------------------------------
+  End implementations for the AugmentedAVLNode class.
+  ----------------------------------------------------
+*/
+
+/**
+* An AVLTree that keeps a per-subtree summary under a user-supplied
+* aggregate (see SumAggregate above), so aggregate(lo, hi) over any key
+* range costs O(log n) instead of iterating over the range.
+*
+* Summaries are repaired by the rotations, by bulk loads and along the
+* modified path after every insert and remove. Values changed in place
+* through operator[] or an iterator bypass this; update them with insert().
+*/
+template <class Key, class Value, class Aggregate>
+class AugmentedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename Aggregate::type Summary;
+    typedef typename AVLTree<Key, Value>::iterator iterator;
+
+    virtual void insert(const std::pair<const Key, Value> &new_item);
+    virtual iterator insert(iterator hint, const std::pair<const Key, Value> &new_item);
+    virtual void remove(const Key& key);
+    Summary aggregate() const;
+    Summary aggregate(const Key& lo, const Key& hi) const;
+
+protected:
+    typedef AugmentedAVLNode<Key, Value, Aggregate> NodeType;
+
+    virtual void rotateLeft(Node<Key,Value>* node) override;
+    virtual void rotateRight(Node<Key,Value>* node) override;
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent) override;
+    virtual void finishBuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight) override;
+
+    static Summary summaryOf(NodeType* node);
+    static void recompute(NodeType* node);
+    static void updatePath(NodeType* node);
+    static Summary aggregateFrom(NodeType* node, const Key& lo);
+    static Summary aggregateTo(NodeType* node, const Key& hi);
+};
+
+/*
+  -----------------------------------------------------
+  Begin implementations for the AugmentedAVLTree class.
+  -----------------------------------------------------
+*/
+
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLTree<Key, Value, Aggregate>::insert(const std::pair<const Key, Value> &new_item)
+{
+    AVLTree<Key, Value>::insert(new_item);
+    updatePath(static_cast<NodeType*>(this->internalFind(new_item.first)));
+}
+
+template<class Key, class Value, class Aggregate>
+typename AugmentedAVLTree<Key, Value, Aggregate>::iterator
+AugmentedAVLTree<Key, Value, Aggregate>::insert(iterator hint, const std::pair<const Key, Value> &new_item)
+{
+    iterator it = AVLTree<Key, Value>::insert(hint, new_item);
+    updatePath(static_cast<NodeType*>(this->iteratorNode(it)));
+    return it;
+}
+
+/**
+* Removes key and then repairs summaries from the lowest node whose
+* subtree lost an item. When the removed node had two children it trades
+* places with its predecessor first, so that is where the gap appears.
+*/
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLTree<Key, Value, Aggregate>::remove(const Key& key)
+{
+    NodeType* removed = static_cast<NodeType*>(this->internalFind(key));
+    if(removed == nullptr){
+        return;
+    }
+    NodeType* start = removed->getParent();
+    if(removed->getLeft() != nullptr && removed->getRight() != nullptr){
+        NodeType* pred = static_cast<NodeType*>(this->predecessor(removed));
+        start = (pred->getParent() == removed) ? pred : pred->getParent();
+    }
+    AVLTree<Key, Value>::remove(key);
+    updatePath(start);
+}
+
+/**
+* Aggregate of every item in the tree, in O(1).
+*/
+template<class Key, class Value, class Aggregate>
+typename AugmentedAVLTree<Key, Value, Aggregate>::Summary
+AugmentedAVLTree<Key, Value, Aggregate>::aggregate() const
+{
+    return summaryOf(static_cast<NodeType*>(this->root_));
+}
+
+/**
+* Aggregate of the items with lo <= key <= hi. Finds the node where the
+* paths to lo and hi split, then combines whole-subtree summaries hanging
+* off each of the two paths, so O(log n) nodes are visited.
+*/
+template<class Key, class Value, class Aggregate>
+typename AugmentedAVLTree<Key, Value, Aggregate>::Summary
+AugmentedAVLTree<Key, Value, Aggregate>::aggregate(const Key& lo, const Key& hi) const
+{
+    NodeType* split = static_cast<NodeType*>(this->root_);
+    while(split != nullptr){
+        if(split->getKey() < lo){
+            split = split->getRight();
+        }
+        else if(hi < split->getKey()){
+            split = split->getLeft();
+        }
+        else{
+            break;
+        }
+    }
+    if(split == nullptr){
+        return Aggregate::identity();
+    }
+    return Aggregate::combine(aggregateFrom(split->getLeft(), lo),
+                              Aggregate::combine(Aggregate::lift(split->getKey(), split->getValue()),
+                                                 aggregateTo(split->getRight(), hi)));
+}
+
+/**
+* Aggregate of the keys >= lo in the subtree at node. Walks one path,
+* prepending node and its right subtree whenever the path turns left.
+*/
+template<class Key, class Value, class Aggregate>
+typename AugmentedAVLTree<Key, Value, Aggregate>::Summary
+AugmentedAVLTree<Key, Value, Aggregate>::aggregateFrom(NodeType* node, const Key& lo)
+{
+    Summary result = Aggregate::identity();
+    while(node != nullptr){
+        if(node->getKey() < lo){
+            node = node->getRight();
+        }
+        else{
+            result = Aggregate::combine(Aggregate::combine(Aggregate::lift(node->getKey(), node->getValue()),
+                                                           summaryOf(node->getRight())),
+                                        result);
+            node = node->getLeft();
+        }
+    }
+    return result;
+}
+
+/**
+* Aggregate of the keys <= hi in the subtree at node; mirror image of
+* aggregateFrom.
+*/
+template<class Key, class Value, class Aggregate>
+typename AugmentedAVLTree<Key, Value, Aggregate>::Summary
+AugmentedAVLTree<Key, Value, Aggregate>::aggregateTo(NodeType* node, const Key& hi)
+{
+    Summary result = Aggregate::identity();
+    while(node != nullptr){
+        if(hi < node->getKey()){
+            node = node->getLeft();
+        }
+        else{
+            result = Aggregate::combine(result,
+                                        Aggregate::combine(summaryOf(node->getLeft()),
+                                                           Aggregate::lift(node->getKey(), node->getValue())));
+            node = node->getRight();
+        }
+    }
+    return result;
+}
+
+// the node that moves down is repaired first, then its new parent
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLTree<Key, Value, Aggregate>::rotateLeft(Node<Key,Value>* node)
+{
+    AVLTree<Key, Value>::rotateLeft(node);
+    recompute(static_cast<NodeType*>(node));
+    recompute(static_cast<NodeType*>(node)->getParent());
+}
+
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLTree<Key, Value, Aggregate>::rotateRight(Node<Key,Value>* node)
+{
+    AVLTree<Key, Value>::rotateRight(node);
+    recompute(static_cast<NodeType*>(node));
+    recompute(static_cast<NodeType*>(node)->getParent());
+}
+
+template<class Key, class Value, class Aggregate>
+Node<Key, Value>* AugmentedAVLTree<Key, Value, Aggregate>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new NodeType(key, value, static_cast<NodeType*>(parent));
+}
+
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLTree<Key, Value, Aggregate>::finishBuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+    AVLTree<Key, Value>::finishBuiltNode(node, leftHeight, rightHeight);
+    recompute(static_cast<NodeType*>(node));
+}
+
+template<class Key, class Value, class Aggregate>
+typename AugmentedAVLTree<Key, Value, Aggregate>::Summary
+AugmentedAVLTree<Key, Value, Aggregate>::summaryOf(NodeType* node)
+{
+    return node == nullptr ? Aggregate::identity() : node->getSummary();
+}
+
+/**
+* Rebuilds node's summary from its children, which must be up to date.
+*/
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLTree<Key, Value, Aggregate>::recompute(NodeType* node)
+{
+    node->setSummary(Aggregate::combine(Aggregate::combine(summaryOf(node->getLeft()),
+                                                           Aggregate::lift(node->getKey(), node->getValue())),
+                                        summaryOf(node->getRight())));
+}
+
+/**
+* Recomputes node and every ancestor, bottom up.
+*/
+template<class Key, class Value, class Aggregate>
+void AugmentedAVLTree<Key, Value, Aggregate>::updatePath(NodeType* node)
+{
+    while(node != nullptr){
+        recompute(node);
+        node = node->getParent();
+    }
+}
+
+/*
+  ---------------------------------------------------
+  End implementations for the AugmentedAVLTree class.
+  ---------------------------------------------------
+*/
+
+#endif
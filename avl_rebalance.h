@@ -0,0 +1,185 @@
+#ifndef AVL_REBALANCE_H
+#define AVL_REBALANCE_H
+
+#include "tree_stats.h"
+
+// AVL rebalancing
+//
+// AVLTree (pointer-linked nodes) and CompactAVLTree (nodes addressed by
+// arena index) keep the same balance factor, right height minus left
+// height, in every node and restore it after an insert or a remove with
+// the same walk up the tree. The walk is written once here; a links
+// policy, as in tree_shape.h, tells it how to reach and change a node:
+//
+//   typedef ... Handle;                 node pointer or index
+//   Handle null() const;                "no node"
+//   Handle parent(Handle n) const;
+//   Handle left(Handle n) const;
+//   Handle right(Handle n) const;
+//   int balance(Handle n) const;
+//   void setBalance(Handle n, int balance);
+//   void rotateLeft(Handle n);          relink n, its child and its
+//   void rotateRight(Handle n);         parent; balances are left alone
+//
+// Rotations count as TREE_ZIGZIG or TREE_ZIGZAG in tree_stats.h.
+
+/**
+* Called once child, a subtree of parent, has grown by one level (a new
+* leaf, for an insert): updates parent's balance and walks up while
+* subtrees keep growing, rotating once if some node reaches +/-2.
+*/
+template <class Links>
+void avlInsertFix(Links& links, typename Links::Handle parent, typename Links::Handle child)
+{
+    typedef typename Links::Handle Handle;
+    while(parent != links.null()){
+        int balance = links.balance(parent) + (links.left(parent) == child ? -1 : 1);
+        links.setBalance(parent, balance);
+        // subtree height unchanged
+        if(balance == 0){
+            return;
+        }
+        // subtree grew by one, keep walking up
+        if(balance == -1 || balance == 1){
+            child = parent;
+            parent = links.parent(parent);
+            continue;
+        }
+        // balance is -2 or 2; child is the taller side
+        if(balance == -2){
+            // zig-zig
+            if(links.balance(child) == -1){
+                BST_STAT_ADD(TREE_ZIGZIG, 1);
+                links.rotateRight(parent);
+                links.setBalance(parent, 0);
+                links.setBalance(child, 0);
+            }
+            // zig-zag
+            else{
+                BST_STAT_ADD(TREE_ZIGZAG, 1);
+                Handle grand = links.right(child);
+                int g = links.balance(grand);
+                links.rotateLeft(child);
+                links.rotateRight(parent);
+                links.setBalance(parent, g == -1 ? 1 : 0);
+                links.setBalance(child, g == 1 ? -1 : 0);
+                links.setBalance(grand, 0);
+            }
+        }
+        else{
+            // zig-zig
+            if(links.balance(child) == 1){
+                BST_STAT_ADD(TREE_ZIGZIG, 1);
+                links.rotateLeft(parent);
+                links.setBalance(parent, 0);
+                links.setBalance(child, 0);
+            }
+            // zig-zag
+            else{
+                BST_STAT_ADD(TREE_ZIGZAG, 1);
+                Handle grand = links.left(child);
+                int g = links.balance(grand);
+                links.rotateRight(child);
+                links.rotateLeft(parent);
+                links.setBalance(parent, g == 1 ? -1 : 0);
+                links.setBalance(child, g == -1 ? 1 : 0);
+                links.setBalance(grand, 0);
+            }
+        }
+        // the rotated subtree is as tall as before the insert
+        return;
+    }
+}
+
+/**
+* Called once a subtree of current has shrunk by one level; diff is the
+* resulting change of current's balance (+1 when the left side shrank,
+* -1 when the right side did). Walks up while subtrees keep shrinking,
+* rotating wherever a node reaches +/-2.
+*/
+template <class Links>
+void avlRemoveFix(Links& links, typename Links::Handle current, int diff)
+{
+    typedef typename Links::Handle Handle;
+    while(current != links.null()){
+        Handle parent = links.parent(current);
+        int ndiff = 0;
+        if(parent != links.null()){
+            ndiff = (links.left(parent) == current) ? 1 : -1;
+        }
+
+        int balance = links.balance(current) + diff;
+        if(balance == -2){
+            Handle child = links.left(current);
+            int c = links.balance(child);
+            // case 1a
+            if(c == -1){
+                BST_STAT_ADD(TREE_ZIGZIG, 1);
+                links.rotateRight(current);
+                links.setBalance(current, 0);
+                links.setBalance(child, 0);
+            }
+            // case 1b: height unchanged, done
+            else if(c == 0){
+                BST_STAT_ADD(TREE_ZIGZIG, 1);
+                links.rotateRight(current);
+                links.setBalance(current, -1);
+                links.setBalance(child, 1);
+                return;
+            }
+            // case 1c
+            else{
+                BST_STAT_ADD(TREE_ZIGZAG, 1);
+                Handle grand = links.right(child);
+                int g = links.balance(grand);
+                links.rotateLeft(child);
+                links.rotateRight(current);
+                links.setBalance(current, g == -1 ? 1 : 0);
+                links.setBalance(child, g == 1 ? -1 : 0);
+                links.setBalance(grand, 0);
+            }
+        }
+        else if(balance == 2){
+            Handle child = links.right(current);
+            int c = links.balance(child);
+            // case 1a
+            if(c == 1){
+                BST_STAT_ADD(TREE_ZIGZIG, 1);
+                links.rotateLeft(current);
+                links.setBalance(current, 0);
+                links.setBalance(child, 0);
+            }
+            // case 1b: height unchanged, done
+            else if(c == 0){
+                BST_STAT_ADD(TREE_ZIGZIG, 1);
+                links.rotateLeft(current);
+                links.setBalance(current, 1);
+                links.setBalance(child, -1);
+                return;
+            }
+            // case 1c
+            else{
+                BST_STAT_ADD(TREE_ZIGZAG, 1);
+                Handle grand = links.left(child);
+                int g = links.balance(grand);
+                links.rotateRight(child);
+                links.rotateLeft(current);
+                links.setBalance(current, g == 1 ? -1 : 0);
+                links.setBalance(child, g == -1 ? 1 : 0);
+                links.setBalance(grand, 0);
+            }
+        }
+        // the taller side shrank to match, height unchanged
+        else if(balance == -1 || balance == 1){
+            links.setBalance(current, balance);
+            return;
+        }
+        else{
+            links.setBalance(current, 0);
+        }
+        current = parent;
+        diff = ndiff;
+    }
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <algorithm>
 #include "bst.h"
+#include "avl_rebalance.h"
 
 struct KeyError { };
 
@@ -131,342 +132,212 @@ template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    AVLTree();
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
+    virtual iterator insert(iterator hint, const std::pair<const Key, Value> &new_item);
     virtual void remove(const Key& key);  // TODO
+    virtual void clear();
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
 
     // Add helper functions here
     int getHeight(AVLNode<Key,Value>* root) const;
+    struct Links;
     void insertFix(AVLNode<Key,Value>* parent, AVLNode<Key,Value>* node);
-    void rotateRight(AVLNode<Key,Value>* node);
-    void rotateLeft(AVLNode<Key,Value>* node);
-    bool zigZig(AVLNode<Key,Value>* n, AVLNode<Key,Value>* p, AVLNode<Key,Value>* g);
-    bool zigZag(AVLNode<Key,Value>* n, AVLNode<Key,Value>* p, AVLNode<Key,Value>* g);
     void removeFix(AVLNode<Key,Value>* node, int diff);
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void finishBuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight);
+    AVLNode<Key,Value>* attachLeaf(AVLNode<Key,Value>* parent, const std::pair<const Key, Value> &new_item, bool right);
+    AVLNode<Key,Value>* getLargestNode();
 
+    // cached node holding the largest key, or NULL if not yet known
+    AVLNode<Key,Value>* rightmost_;
 };
 
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree() :
+    rightmost_(nullptr)
+{
+
+}
+
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
+ *
+ * Keys larger than everything in the tree (e.g. increasing timestamps)
+ * are attached straight to the cached rightmost node, so sorted ingest
+ * costs O(1) amortized instead of a descent from the root.
  */
 template<class Key, class Value>
 void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
 {
+    BST_STAT_TIMER(TREE_INSERT);
     // if tree is empty, insert node at top
     if(this->empty()){
-        AVLNode<Key, Value>* initialNode = new AVLNode<Key, Value>(new_item.first, new_item.second, nullptr);
+        AVLNode<Key, Value>* initialNode = static_cast<AVLNode<Key, Value>*>(createNode(new_item.first, new_item.second, nullptr));
         this->root_ = initialNode;
-        initialNode->setBalance(0);
+        rightmost_ = initialNode;
+        this->size_++;
+        return;
     }
-    // if key already exists in tree, override current value
-    else if(static_cast<AVLNode<Key, Value>*>(this->internalFind(new_item.first)) != nullptr){
-        AVLNode<Key, Value> *changedNode = static_cast<AVLNode<Key, Value>*>(this->internalFind(new_item.first));
-        changedNode->setValue(new_item.second);
+    // append fast path
+    AVLNode<Key, Value>* largest = getLargestNode();
+    BST_STAT_ADD(TREE_COMPARISONS, 1);
+    if(largest->getKey() < new_item.first){
+        rightmost_ = attachLeaf(largest, new_item, true);
+        return;
     }
 
-    // otherwise, walk down tree, find place to insert
-    else{
-        AVLNode<Key, Value>* temp = static_cast<AVLNode<Key, Value>*>(this->root_);
-        AVLNode<Key, Value>* tempParent = nullptr;
-        while(temp != nullptr){
-            // if greater than root_, move right
-            tempParent = temp;
-            if(temp->getKey() < new_item.first){
-                temp = temp->getRight();
-            }
-            // else, move left
-            else{
-                // std::cout << "Makes it here 1" << std::endl;
-                temp = temp->getLeft();
-            }
-        }
-        AVLNode<Key, Value>* addedNode = new AVLNode<Key, Value>(new_item.first, new_item.second, tempParent);
-        addedNode->setBalance(0);
-        // if temp has balance of -1 or 1, set balance to 0
-        if(tempParent->getBalance() == -1 || tempParent->getBalance() == 1){
-            // if tempParent has balance of 1, right child was added
-            if(tempParent->getBalance() == -1){
-                tempParent->setRight(addedNode);
-
-            }
-            else{
-                tempParent->setLeft(addedNode);
-            }
-            // else, left child was added
-            // std::cout << "Makes it here 2" << std::endl;
-            tempParent->setBalance(0);
-            
-
-        }
-        // else, temp balance is 0 
-        else{
-            // connecting parent node ptr to added node (right)
-            if(tempParent->getKey() < new_item.first){
-                tempParent->setRight(addedNode);
-                tempParent->setBalance(tempParent->getBalance()+1);
-                addedNode->setParent(tempParent);
-            }
-            // connecting parent node ptr to added node (left)
-            else{
-                tempParent->setLeft(addedNode);
-                tempParent->setBalance(tempParent->getBalance()-1);
-                addedNode->setParent(tempParent);
-            }
-            insertFix(tempParent, addedNode);
-        }
+    // otherwise, walk down tree, either finding the key or a place to insert
+    Node<Key, Value>* tempParent;
+    size_t depth;
+    Node<Key, Value>* existing = this->descend(new_item.first, tempParent, depth);
+    // key already exists in tree, override current value
+    if(existing != nullptr){
+        existing->setValue(new_item.second);
+        return;
     }
+    attachLeaf(static_cast<AVLNode<Key, Value>*>(tempParent), new_item, tempParent->getKey() < new_item.first);
 }
 
+/**
+* Inserts new_item starting from hint instead of the root, following the
+* std::map convention that the item belongs just before hint (end() means
+* "after the largest key"). When the hint is right, only the neighbours of
+* hint are examined; otherwise this falls back to a normal insert.
+* Returns an iterator to the inserted or updated item, which is the
+* natural hint for the next key of an ascending run.
+*
+* Subclasses that keep their own bookkeeping override this and call it;
+* the fallback therefore uses AVLTree::insert(new_item) directly, so an
+* override is never re-entered through the virtual insert().
+*/
 template<class Key, class Value>
-void AVLTree<Key, Value>:: insertFix(AVLNode<Key,Value>* parent, AVLNode<Key,Value>* node){
-    if(parent == nullptr || parent->getParent() == nullptr){
-        return;
-    }
-    AVLNode<Key,Value>* grand = parent->getParent();
-    bool pLeftofG;
-    // check if parent is left child of grand
-    if(grand->getLeft() == parent){
-        pLeftofG = true;
-    }
-    // else, parent is right child of grand
-    else{
-        pLeftofG = false;
-    }
-    // update grands balance to new value depending on if left or right child
-    if(pLeftofG){
-        grand->setBalance(grand->getBalance()-1);
-    }
-    // else, is right child, and update accordingly. 
-    else{
-        grand->setBalance(grand->getBalance()+1);
-    }
-    // if balance of grand is zero, return
-    if(grand->getBalance() == 0){
-        return;
-    }
-    // else if balance of grand is -1 or 1, recurse
-    else if(grand->getBalance() == -1 || grand->getBalance() == 1){
-        insertFix(grand, parent);
-    }
-    // else balance is 2 or -2
-    else{
-        // if zig zig, rotate accordingly
-        if(zigZig(node, parent, grand)){
-            // if left child, rotateRight grand
-            if(pLeftofG){
-                rotateRight(grand);
-            }
-            // else, is right child, rotateLeft grand
-            else{
-                rotateLeft(grand);
-            }
-            // set grand balance and parent balance to 0
-            parent->setBalance(0);
-            grand->setBalance(0);
+typename AVLTree<Key, Value>::iterator
+AVLTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value> &new_item)
+{
+    AVLNode<Key, Value>* h = static_cast<AVLNode<Key, Value>*>(this->iteratorNode(hint));
+    if(h == nullptr){
+        // after the largest key, which is exactly the append fast path
+        if(!this->empty() && getLargestNode()->getKey() < new_item.first){
+            rightmost_ = attachLeaf(getLargestNode(), new_item, true);
+            return this->makeIterator(rightmost_);
         }
-        // if zig zag, rotate accordingly
-        if(zigZag(node, parent, grand)){
-            // if left child, rotateLeft parent, rotateRight grand
-            if(pLeftofG){
-                rotateLeft(parent);
-                rotateRight(grand);
-            }
-            // else, is right child, rotateRight parent, rotateLeft grand
-            else{
-                rotateRight(parent);
-                rotateLeft(grand);
-            }
-            // if pLeftofG
-            if(pLeftofG){
-                // if node balance is -1, parent balance = 0, grand balance = 1 node balance = 0
-                if(node->getBalance() == -1){
-                    parent->setBalance(0);
-                    grand->setBalance(1);
-                    node->setBalance(0);
-                }
-                // else if node balance is 0, parent balance = 0, grand balance = 0, node balance = 0
-                else if(node->getBalance() == 0){
-                    parent->setBalance(0);
-                    grand->setBalance(0);
-                    node->setBalance(0);
-                }
-                // else node balance is 1, parent balance = -1, grand balance = 0, node balance = 0
-                else{
-                    parent->setBalance(-1);
-                    grand->setBalance(0);
-                    node->setBalance(0);
-
-                }
-            }
-            // else if, p is right of g
-            else{
-                // if node balance is 1, parent balance = 0, grand balance = -1 node balance = 0
-                if(node->getBalance() == 1){
-                    parent->setBalance(0);
-                    grand->setBalance(-1);
-                    node->setBalance(0);
-                }
-                // else if node balance is 0, parent balance = 0, grand balance = 0, node balance = 0
-                else if(node->getBalance() == 0){
-                    parent->setBalance(0);
-                    grand->setBalance(0);
-                    node->setBalance(0);
-                }
-                // else node balance is 1, parent balance = 1, grand balance = 0, node balance = 0
-                else{
-                    parent->setBalance(1);
-                    grand->setBalance(0);
-                    node->setBalance(0);
-                }
+    }
+    else if(new_item.first < h->getKey()){
+        AVLNode<Key, Value>* pred = static_cast<AVLNode<Key, Value>*>(this->predecessor(h));
+        if(pred == nullptr || pred->getKey() < new_item.first){
+            // new key sits between pred and h, in whichever has a free slot
+            if(h->getLeft() == nullptr){
+                return this->makeIterator(attachLeaf(h, new_item, false));
             }
+            return this->makeIterator(attachLeaf(pred, new_item, true));
         }
-    }   
-}
-
-
-// rotate right
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateRight(AVLNode<Key,Value>* node){
-    AVLNode<Key,Value>* parent = node->getParent();
-    AVLNode<Key,Value>* leftChild = node->getLeft();
-
-    bool isLeftNode;
-    
-
-    // check for right child existence 
-    AVLNode<Key,Value>* rightChild = nullptr;
-    if(leftChild->getRight() != nullptr){
-        // store right child
-        rightChild = leftChild->getRight();
-        leftChild->setRight(nullptr);
-    }
-
-    // if node is root, rotate accordingly
-    if(parent == nullptr){
-
-        this->root_ = leftChild;
-        node->setParent(leftChild);
-        leftChild->setRight(node);
-        leftChild->setParent(nullptr);
     }
-
-    // else,rotate accordingly
-    else{
-        if(parent->getLeft() == node){
-            isLeftNode = true;
-        }
-        else{
-            isLeftNode = false;
-        }
-
-        // if node is right child
-        if(isLeftNode){
-            parent->setLeft(leftChild);
-        }
-        // else, node is left child
-        else{
-            parent->setRight(leftChild);
+    else if(h->getKey() < new_item.first){
+        AVLNode<Key, Value>* succ = static_cast<AVLNode<Key, Value>*>(this->successor(h));
+        if(succ == nullptr || new_item.first < succ->getKey()){
+            AVLNode<Key, Value>* added = (h->getRight() == nullptr) ? attachLeaf(h, new_item, true)
+                                                                      : attachLeaf(succ, new_item, false);
+            if(succ == nullptr){
+                rightmost_ = added;
+            }
+            return this->makeIterator(added);
         }
-        leftChild->setParent(parent);
-        node->setParent(leftChild);
-        leftChild->setRight(node);
     }
-
-    // if right child doesnt exist
-    if(rightChild == nullptr){
-        node->setLeft(nullptr);
-    }
-    // if left child exists
     else{
-        node->setLeft(rightChild);
-        rightChild->setParent(node);
+        h->setValue(new_item.second);
+        return hint;
     }
+    // wrong hint
+    AVLTree<Key, Value>::insert(new_item);
+    return this->find(new_item.first);
 }
 
-// rotate left
+/**
+* Hangs a new leaf for new_item off the given (empty) side of parent and
+* restores the AVL balances. Returns the new node.
+*/
 template<class Key, class Value>
-void AVLTree<Key, Value>::rotateLeft(AVLNode<Key,Value>* node){
-    AVLNode<Key,Value>* parent = node->getParent();
-    AVLNode<Key,Value>* rightChild = node->getRight();
-
-    bool isRightNode;
-    
-
-
-    // check for left child existence 
-    AVLNode<Key,Value>* leftChild = nullptr;
-    
-    if(rightChild->getLeft() != nullptr){
-        // store left child
-        leftChild = rightChild->getLeft();
-        rightChild->setLeft(nullptr);
-    }
-    // if node is root, rotate accordingly
-    if(parent == nullptr){
-        this->root_ = rightChild;
-        node->setParent(rightChild);
-        rightChild->setLeft(node);
-        rightChild->setParent(nullptr);
+AVLNode<Key, Value>* AVLTree<Key, Value>::attachLeaf(AVLNode<Key,Value>* parent, const std::pair<const Key, Value> &new_item, bool right)
+{
+    AVLNode<Key, Value>* addedNode = static_cast<AVLNode<Key, Value>*>(createNode(new_item.first, new_item.second, parent));
+    if(right){
+        parent->setRight(addedNode);
     }
-    // else, rotate accordingly
     else{
-        if(parent->getRight() == node){
-            isRightNode = true;
-        }
-        else{
-            isRightNode = false;
-        }
-        // if node is right child
-        if(isRightNode){
-            parent->setRight(rightChild);
-        }
-        // else, node is left child
-        else{
-            parent->setLeft(rightChild);
-        }
-        rightChild->setParent(parent);
-        node->setParent(rightChild);
-        rightChild->setLeft(node);
+        parent->setLeft(addedNode);
     }
+    this->size_++;
+    insertFix(parent, addedNode);
+    return addedNode;
+}
 
-    // if left child doesnt exist
-    if(leftChild == nullptr){
-        node->setRight(nullptr);
-    }
-    // if right child exists
-    else{
-        node->setRight(leftChild);
-        leftChild->setParent(node);
+/**
+* Frees every node in one pass, without the rebalancing remove() would
+* do. Subclasses with state of their own reset it after calling this.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::clear()
+{
+    if(this->cache_ != nullptr){
+        this->cache_->flush();
     }
+    this->destroySubtree(this->root_);
+    this->root_ = nullptr;
+    rightmost_ = nullptr;
+    this->size_ = 0;
 }
 
-
+/**
+* Returns the node with the largest key, walking the right spine only
+* when the cache was dropped by a remove.
+*/
 template<class Key, class Value>
-bool AVLTree<Key, Value>::zigZig(AVLNode<Key,Value>* n, AVLNode<Key,Value>* p, AVLNode<Key,Value>* g){
-    // left of left case
-    if(g->getLeft() == p && p->getLeft() == n && p != nullptr && g != nullptr && n != nullptr){
-        return true;
-    }
-    // right of right case
-    if(g->getRight() == p && p->getRight() == n && p != nullptr && g != nullptr && n != nullptr){
-        return true;
+AVLNode<Key, Value>* AVLTree<Key, Value>::getLargestNode()
+{
+    if(rightmost_ == nullptr && this->root_ != nullptr){
+        AVLNode<Key, Value>* temp = static_cast<AVLNode<Key, Value>*>(this->root_);
+        while(temp->getRight() != nullptr){
+            temp = temp->getRight();
+        }
+        rightmost_ = temp;
     }
-    return false;
+    return rightmost_;
 }
 
+/**
+* Adapts the nodes of this tree to the shared AVL rebalancing in
+* avl_rebalance.h. Rotations go through the virtual ones of
+* BinarySearchTree, so subclasses keeping per-node data up to date in
+* rotateLeft/rotateRight (AugmentedAVLTree) stay correct.
+*/
 template<class Key, class Value>
-bool AVLTree<Key, Value>::zigZag(AVLNode<Key,Value>* n, AVLNode<Key,Value>* p, AVLNode<Key,Value>* g){
-    // left then right
-    if(g->getLeft() == p && p->getRight() == n){
-        return true;
-    }
-    // right then left
-    if(g->getRight() == p && p->getLeft() == n){
-        return true;
-    }
-    return false;
+struct AVLTree<Key, Value>::Links
+{
+    typedef AVLNode<Key,Value>* Handle;
+
+    AVLTree<Key, Value>* tree;
+
+    Handle null() const { return nullptr; }
+    Handle parent(Handle n) const { return n->getParent(); }
+    Handle left(Handle n) const { return n->getLeft(); }
+    Handle right(Handle n) const { return n->getRight(); }
+    int balance(Handle n) const { return n->getBalance(); }
+    void setBalance(Handle n, int balance) { n->setBalance(static_cast<int8_t>(balance)); }
+    void rotateLeft(Handle n) { tree->rotateLeft(n); }
+    void rotateRight(Handle n) { tree->rotateRight(n); }
+};
+
+// node, a child of parent, is a subtree that just grew by one level
+template<class Key, class Value>
+void AVLTree<Key, Value>::insertFix(AVLNode<Key,Value>* parent, AVLNode<Key,Value>* node)
+{
+    Links links = { this };
+    avlInsertFix(links, parent, node);
 }
 
 /*
@@ -476,245 +347,120 @@ bool AVLTree<Key, Value>::zigZag(AVLNode<Key,Value>* n, AVLNode<Key,Value>* p, A
 template<class Key, class Value>
 void AVLTree<Key, Value>:: remove(const Key& key)
 {
+    BST_STAT_TIMER(TREE_REMOVE);
     // if key is not found, return
-    if(static_cast<AVLNode<Key, Value>*>(this->internalFind(key)) == nullptr){
+    AVLNode<Key, Value>* removed = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
+    if(removed == nullptr){
         return;
     }
-    // if key is found, delete
-    AVLNode<Key, Value>* removed = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
-    if(static_cast<AVLNode<Key, Value>*>(this->internalFind(key)) != nullptr){   
-        AVLNode<Key, Value> *node = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
-        // if two children exist, swap with pred
-        if(node->getLeft() != nullptr && node->getRight() != nullptr){
-            AVLNode<Key,Value>* temp = static_cast<AVLNode<Key, Value>*>(this->predecessor(removed));
-            nodeSwap(temp, removed);
+    if(removed == rightmost_){
+        rightmost_ = nullptr;
+    }
+    this->uncache(removed);
+    this->size_--;
+    // if two children exist, swap with pred
+    if(removed->getLeft() != nullptr && removed->getRight() != nullptr){
+        AVLNode<Key,Value>* temp = static_cast<AVLNode<Key, Value>*>(this->predecessor(removed));
+        nodeSwap(temp, removed);
+    }
+
+    
+    int diff = 0; 
+    AVLNode<Key,Value>* parent = removed->getParent();
+
+    
+
+    // if parent exists
+    if(parent != nullptr){
+        if(parent->getLeft() == removed){
+            diff = 1;
+        }
+        else if(parent->getRight() == removed){
+            diff = -1;
         }
+    }
 
-        
-        int diff = 0; 
-        AVLNode<Key,Value>* parent = removed->getParent();
+    // node has no children
+    if(removed->getLeft() == nullptr && removed->getRight() == nullptr){
+        // root case
+        if(parent == nullptr){
+            this->root_ = nullptr;
+            delete removed;
+            return;
+        }
 
-        
+        // removed is a left node
+        else if(parent->getLeft() == removed){
+            parent->setLeft(nullptr);
+            delete removed;
 
-        // if parent exists
-        if(parent != nullptr){
-            if(parent->getLeft() == removed){
-                diff = 1;
-            }
-            else if(parent->getRight() == removed){
-                diff = -1;
-            }
         }
-    
-        // node has no children
-        if(node->getLeft() == nullptr && node->getRight() == nullptr){
-            // root case
-            if(parent == nullptr){
-                this->root_ = nullptr;
-                delete removed;
-                return;
-            }
+        // removed is a right node
+        else if(parent->getLeft() != removed){
+            parent->setRight(nullptr);
+            delete removed;
+        }
+    }
 
-            // removed is a left node
-            else if(parent->getLeft() == removed){
-                parent->setLeft(nullptr);
+    // node has single children
+    else{
+        // root case
+        if(parent == nullptr){
+            // has left child
+            if(removed->getLeft() != nullptr){
+                removed->getLeft()->setParent(nullptr);
+                this->root_ = removed->getLeft();
                 delete removed;
-
             }
-            // removed is a right node
-            else if(parent->getLeft() != removed){
-                parent->setRight(nullptr);
+            // has right child
+            else{
+                removed->getRight()->setParent(nullptr);
+                this->root_ = removed->getRight();
                 delete removed;
             }
-        }
 
-        // node has single children
+        }
         else{
-            // root case
-            if(parent == nullptr){
-                // has left child
-                if(removed->getLeft() != nullptr){
-                    removed->getLeft()->setParent(nullptr);
-                    this->root_ = removed->getLeft();
-                    delete removed;
+            // has left child
+            if(removed->getRight() == nullptr){
+                if(parent->getLeft() == removed){
+                    parent->setLeft(removed->getLeft());
                 }
-                // has right child
                 else{
-                    removed->getRight()->setParent(nullptr);
-                    this->root_ = removed->getRight();
-                    delete removed;
+                    parent->setRight(removed->getLeft());
                 }
-
+                removed->getLeft()->setParent(parent);
+                delete removed;
             }
+            
+            // has right child
             else{
-                // has left child
-                if(removed->getRight() == nullptr){
-                    if(parent->getLeft() == removed){
-                        parent->setLeft(removed->getLeft());
-                    }
-                    else{
-                        parent->setRight(removed->getLeft());
-                    }
-                    removed->getLeft()->setParent(parent);
-                    delete removed;
+                if(parent->getLeft() == removed){
+                    parent->setLeft(removed->getRight());
                 }
-                
-                // has right child
                 else{
-                    if(parent->getLeft() == removed){
-                        parent->setLeft(removed->getRight());
-                    }
-                    else{
-                        parent->setRight(removed->getRight());
-                    }
-                    removed->getRight()->setParent(parent);
-                    delete removed;
-                   
+                    parent->setRight(removed->getRight());
                 }
+                removed->getRight()->setParent(parent);
+                delete removed;
                
-                
-            }
-        }
-        removeFix(parent, diff);
-
-    }
-}
-
-template<class Key, class Value>
-void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* node, int diff) {
-    // if node is null, return 
-    if(node == nullptr){
-        return;
-    }
-    AVLNode<Key, Value>* parent = node->getParent();
-    AVLNode<Key, Value>* child = node->getLeft();
-    
-    int ndiff = 0;
-    // establishing ndiff
-    if(parent != nullptr){
-        if(parent->getRight() == node){
-            ndiff = -1;
-        }
-        else{
-            ndiff = 1;
-        }
-    }
-
-    // diff == -2
-    if(node->getBalance() + diff == -2){
-        if(child == nullptr){
-            return;
-        }
-        // case 1a
-        if(child->getBalance() == -1){
-            rotateRight(node);
-            node->setBalance(0);
-            child->setBalance(0);
-            removeFix(parent, ndiff);
-        }
-        // case 1b
-        else if(child->getBalance() == 0){
-            rotateRight(node);
-            node->setBalance(-1);
-            child->setBalance(1);
-            return;
-        }
-        // case 1c
-        else if(child->getBalance() == 1){
-            AVLNode<Key, Value>* grand = child->getRight();
-            if(grand == nullptr){
-                return;
             }
-            rotateLeft(child);
-            rotateRight(node);
-            if(grand->getBalance() == 1){
-                node->setBalance(0);
-                child->setBalance(-1);
-                grand->setBalance(0);
-            }
-            else if(grand->getBalance() == 0){
-                node->setBalance(0);
-                child->setBalance(0);
-                grand->setBalance(0);
-            }
-            else if(grand->getBalance() == -1){
-                node->setBalance(1);
-                child->setBalance(0);
-                grand->setBalance(0);
-            }
-            removeFix(parent, ndiff);
+           
+            
         }
-
-
     }
-    // diff == 2
-    else if(node->getBalance() + diff == 2){
-        // std::cout << "Enters diff = 2" << std::endl;
-        child = node->getRight();
-        if(child == nullptr){
-            return;
-        }
-        // case 1a
-        if(child->getBalance() == 1){         
-            rotateLeft(node);
-            node->setBalance(0);
-            child->setBalance(0);
-            removeFix(parent, ndiff);
-        }
-        // case 1b
-        else if(child->getBalance() == 0){
-            rotateLeft(node);
-            node->setBalance(1);
-            child->setBalance(-1);
-            return;
-        }
-        // case 1c
-        else if(child->getBalance() == -1){
-            AVLNode<Key, Value>* grand = child->getLeft();
-            if(grand == nullptr){
-                return;
-            }
-            rotateRight(child);
-            rotateLeft(node);
-            if(grand->getBalance() == -1){
-                node->setBalance(0);
-                child->setBalance(1);
-                grand->setBalance(0);
-            }
-            else if(grand->getBalance() == 0){
-                node->setBalance(0);
-                child->setBalance(0);
-                grand->setBalance(0);
-            }
-            else if(grand->getBalance() == 1){
-                node->setBalance(-1);
-                child->setBalance(0);
-                grand->setBalance(0);
-            }
-            removeFix(parent, ndiff);
-        }
+    removeFix(parent, diff);
 
 
-    }
-    else if(node->getBalance() + diff == -1){
-        node->setBalance(-1);
-        return;
-    }
-    else if(node->getBalance() + diff == 1){
-        node->setBalance(1);
-        return;
-    }
-    else{
-        node->setBalance(0);
-        removeFix(parent, ndiff);
-    }
-
 }
 
-
-
-
-
+// a subtree of node just shrank by one level, changing its balance by diff
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* node, int diff)
+{
+    Links links = { this };
+    avlRemoveFix(links, node, diff);
+}
 
 
 // HELPER FUNCTION TO FIND HEIGHT OF TREE
@@ -726,6 +472,19 @@ int AVLTree<Key, Value>::getHeight(AVLNode<Key,Value>* root) const{
     return 1 + std::max(getHeight(root->getLeft()), getHeight(root->getRight()));
 }
 
+template<class Key, class Value>
+Node<Key, Value>* AVLTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new AVLNode<Key, Value>(key, value, static_cast<AVLNode<Key, Value>*>(parent));
+}
+
+// bulk-built nodes get their balance straight from the subtree heights
+template<class Key, class Value>
+void AVLTree<Key, Value>::finishBuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+    static_cast<AVLNode<Key, Value>*>(node)->setBalance(rightHeight - leftHeight);
+}
+
 template<class Key, class Value>
 void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
 {
@@ -0,0 +1,217 @@
+// Measures how far coroutine lookups (CompactAVLTree::findAsync, see
+// lookup_task.h) overlap the stalls of a tree that does not fit in memory.
+//
+// usage: async-bench [entries] [lookups] [latency_us]
+//
+// Builds a CompactAVLTree of entries (default 1M) random keys, inserted in
+// random order so that tree neighbours are scattered over the arena, and
+// looks up a random mix of present and absent keys with 1, 4, 16, 64 and
+// 256 lookups in flight on one thread.
+//
+// "simulated": the nodes are read through SimulatedPager, which stands for a
+// disk-backed tree with an eighth of its pages in the page cache: reading
+// a page that is not resident costs latency_us (default 20) until it is,
+// and the pages are evicted first in, first out. With one lookup in flight
+// every miss is waited out in full, as a blocking find() would; with more,
+// the waits overlap.
+//
+// "prefetch": the same lookups on the in-memory tree through PrefetchPager,
+// next to plain find(), to show what interleaving does for cache misses
+// alone.
+//
+// Prints one JSON object per (pager, lookups in flight).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../compactavl.h"
+#include "perf_counters.h"
+
+typedef CompactAVLTree<uint64_t, uint64_t> Tree;
+
+/**
+* Pretends every page is on disk: a page becomes resident latency after
+* it was first fetched, and the oldest resident page is dropped once more
+* than capacity are.
+*/
+class SimulatedPager
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    SimulatedPager(size_t capacity, std::chrono::nanoseconds latency) :
+        capacity_(capacity), latency_(latency), fetches_(0)
+    {
+    }
+
+    bool resident(const void* addr, size_t size)
+    {
+        return pageResident(page(addr)) && pageResident(page(static_cast<const char*>(addr) + size - 1));
+    }
+
+    void fetch(const void* addr, size_t size)
+    {
+        pageFetch(page(addr));
+        pageFetch(page(static_cast<const char*>(addr) + size - 1));
+    }
+
+    // refetches pages evicted before the waiting lookup got to them
+    bool arrived(const void* addr, size_t size)
+    {
+        if(resident(addr, size)){
+            return true;
+        }
+        fetch(addr, size);
+        return false;
+    }
+
+    size_t fetches() const { return fetches_; }
+
+private:
+    static uintptr_t page(const void* addr)
+    {
+        return reinterpret_cast<uintptr_t>(addr) >> 12;
+    }
+
+    bool pageResident(uintptr_t p)
+    {
+        if(resident_.count(p)){
+            return true;
+        }
+        std::unordered_map<uintptr_t, Clock::time_point>::iterator it = pending_.find(p);
+        if(it == pending_.end() || Clock::now() < it->second){
+            return false;
+        }
+        pending_.erase(it);
+        resident_.insert(p);
+        order_.push_back(p);
+        if(order_.size() > capacity_){
+            resident_.erase(order_.front());
+            order_.pop_front();
+        }
+        return true;
+    }
+
+    void pageFetch(uintptr_t p)
+    {
+        if(!resident_.count(p) && !pending_.count(p)){
+            pending_[p] = Clock::now() + latency_;
+            fetches_++;
+        }
+    }
+
+    size_t capacity_;
+    std::chrono::nanoseconds latency_;
+    std::unordered_set<uintptr_t> resident_;
+    std::deque<uintptr_t> order_;
+    std::unordered_map<uintptr_t, Clock::time_point> pending_;
+    size_t fetches_;
+};
+
+// one lookup slot: runs lookups one after another until none is left
+template <class Pager>
+static LookupTask<uint64_t> lookupLoop(const Tree& tree, const std::vector<uint64_t>& lookups, size_t& next,
+                                       LookupScheduler& scheduler, Pager& pager)
+{
+    uint64_t hits = 0;
+    while(next < lookups.size()){
+        uint64_t key = lookups[next++];
+        Tree::iterator it = co_await tree.findAsync(key, scheduler, pager);
+        hits += it != tree.end();
+    }
+    co_return hits;
+}
+
+template <class Pager>
+static uint64_t runLookups(const Tree& tree, const std::vector<uint64_t>& lookups, size_t inFlight, Pager& pager)
+{
+    LookupScheduler scheduler;
+    size_t next = 0;
+    std::vector<LookupTask<uint64_t> > slots;
+    for(size_t i = 0; i < inFlight; ++i){
+        slots.push_back(lookupLoop(tree, lookups, next, scheduler, pager));
+        scheduler.spawn(slots.back());
+    }
+    scheduler.run();
+    uint64_t hits = 0;
+    for(size_t i = 0; i < slots.size(); ++i){
+        hits += slots[i].result();
+    }
+    return hits;
+}
+
+static void report(const char* pager, const char* mode, size_t entries, size_t inFlight, size_t lookups,
+                   double ns, uint64_t hits, long long fetches)
+{
+    std::printf("{\"bench\":\"async\",\"pager\":\"%s\",\"mode\":\"%s\",\"entries\":%zu,\"in_flight\":%zu,"
+                "\"find_ns_per_op\":%.2f,\"fetches_per_op\":%.3f,\"hits\":%llu}\n",
+                pager, mode, entries, inFlight, ns / lookups,
+                fetches < 0 ? -1.0 : static_cast<double>(fetches) / lookups,
+                static_cast<unsigned long long>(hits));
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t lookupCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5000;
+    long latencyUs = argc > 3 ? std::strtol(argv[3], nullptr, 10) : 20;
+    std::mt19937_64 rng(42);
+
+    // even keys are in the tree, odd ones are not
+    std::vector<uint64_t> keys(entries);
+    for(size_t i = 0; i < entries; ++i){
+        keys[i] = (rng() >> 1) << 1;
+    }
+    Tree tree;
+    for(size_t i = 0; i < entries; ++i){
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    size_t pages = (tree.size() * sizeof(Tree::NodeType) + 4095) / 4096;
+
+    std::vector<uint64_t> lookups(lookupCount);
+    for(size_t i = 0; i < lookupCount; ++i){
+        lookups[i] = keys[rng() % entries] | (rng() & 1);
+    }
+
+    std::vector<uint64_t> warmup(lookupCount);
+    for(size_t i = 0; i < lookupCount; ++i){
+        warmup[i] = keys[rng() % entries];
+    }
+
+    const size_t inFlight[] = { 1, 4, 16, 64, 256 };
+    for(size_t i = 0; i < sizeof(inFlight) / sizeof(inFlight[0]); ++i){
+        SimulatedPager pager(pages / 8, std::chrono::microseconds(latencyUs));
+        // fill the resident set with other lookups first
+        runLookups(tree, warmup, 64, pager);
+        size_t warmFetches = pager.fetches();
+        Stopwatch clock;
+        uint64_t hits = runLookups(tree, lookups, inFlight[i], pager);
+        report("simulated", "findAsync", entries, inFlight[i], lookupCount, clock.elapsedNs(), hits,
+               static_cast<long long>(pager.fetches() - warmFetches));
+    }
+
+    // enough lookups for the in-memory timings to be measurable
+    std::vector<uint64_t> memoryLookups(1000000);
+    for(size_t i = 0; i < memoryLookups.size(); ++i){
+        memoryLookups[i] = keys[rng() % entries] | (rng() & 1);
+    }
+    Stopwatch clock;
+    uint64_t hits = 0;
+    for(size_t i = 0; i < memoryLookups.size(); ++i){
+        hits += tree.find(memoryLookups[i]) != tree.end();
+    }
+    report("none", "find", entries, 1, memoryLookups.size(), clock.elapsedNs(), hits, -1);
+    for(size_t i = 0; i < sizeof(inFlight) / sizeof(inFlight[0]); ++i){
+        PrefetchPager pager;
+        clock.reset();
+        hits = runLookups(tree, memoryLookups, inFlight[i], pager);
+        report("prefetch", "findAsync", entries, inFlight[i], memoryLookups.size(), clock.elapsedNs(), hits, -1);
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Compares AVLTree and WAVLTree on a delete-heavy workload.
+//
+// usage: balance-bench [entries]
+//
+// Inserts entries random keys, then removes them all in a different random
+// order (think session expiry). Rotations are counted by overriding the
+// shared BinarySearchTree rotations. Prints one JSON object per tree.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "../avlbst.h"
+#include "../wavlbst.h"
+#include "perf_counters.h"
+
+template <class Tree>
+class RotationCounting : public Tree
+{
+public:
+    RotationCounting() : rotations(0) {}
+    uint64_t rotations;
+
+protected:
+    virtual void rotateLeft(Node<uint64_t, uint64_t>* node) override
+    {
+        rotations++;
+        Tree::rotateLeft(node);
+    }
+    virtual void rotateRight(Node<uint64_t, uint64_t>* node) override
+    {
+        rotations++;
+        Tree::rotateRight(node);
+    }
+};
+
+template <class Tree>
+static void run(const char* name, const std::vector<uint64_t>& inserts, const std::vector<uint64_t>& removes)
+{
+    RotationCounting<Tree> tree;
+    Stopwatch clock;
+    for(size_t i = 0; i < inserts.size(); ++i){
+        tree.insert(std::make_pair(inserts[i], inserts[i]));
+    }
+    double insertNs = clock.elapsedNs();
+    uint64_t insertRotations = tree.rotations;
+
+    tree.rotations = 0;
+    clock.reset();
+    for(size_t i = 0; i < removes.size(); ++i){
+        tree.remove(removes[i]);
+    }
+    double removeNs = clock.elapsedNs();
+
+    std::printf("{\"bench\":\"balance\",\"tree\":\"%s\",\"entries\":%zu,"
+                "\"insert_ns_per_op\":%.2f,\"insert_rotations_per_op\":%.4f,"
+                "\"remove_ns_per_op\":%.2f,\"remove_rotations_per_op\":%.4f}\n",
+                name, inserts.size(),
+                insertNs / inserts.size(), static_cast<double>(insertRotations) / inserts.size(),
+                removeNs / removes.size(), static_cast<double>(tree.rotations) / removes.size());
+}
+
+int main(int argc, char* argv[])
+{
+    size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> inserts(entries);
+    for(size_t i = 0; i < entries; ++i){
+        inserts[i] = i;
+    }
+    std::shuffle(inserts.begin(), inserts.end(), rng);
+    std::vector<uint64_t> removes(inserts);
+    std::shuffle(removes.begin(), removes.end(), rng);
+
+    run<AVLTree<uint64_t, uint64_t> >("AVLTree", inserts, removes);
+    run<WAVLTree<uint64_t, uint64_t> >("WAVLTree", inserts, removes);
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Compares LockFreeSkipList with an AVLTree behind one mutex as the
+// ordered map of a multi-threaded writer workload.
+//
+// usage: concurrent-bench [entries]
+//
+// For 1, 2, 4, ... 64 writer threads:
+//   "ingest": the threads insert entries (default 1M) distinct random keys
+//             between them into an empty map;
+//   "churn":  on the ingested map, each thread then runs entries / threads
+//             operations of which a quarter insert, a quarter remove and
+//             half look up random keys.
+// run() takes the map as a template parameter and uses only insert(),
+// remove(), find() and end(), which both engines share. Prints one JSON
+// object per (engine, workload, threads); ops_per_sec is over all
+// threads, and the final entry count is checked against the keys inserted.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../avlbst.h"
+#include "../skiplist.h"
+#include "perf_counters.h"
+
+/**
+* An AVLTree made safe for threads the usual way: every call takes one
+* lock.
+*/
+template <class Key, class Value>
+class LockedAVLTree
+{
+public:
+    typedef typename AVLTree<Key, Value>::iterator iterator;
+
+    void insert(const std::pair<const Key, Value>& new_item)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        tree_.insert(new_item);
+    }
+
+    void remove(const Key& key)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        tree_.remove(key);
+    }
+
+    iterator find(const Key& key) const
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return tree_.find(key);
+    }
+
+    iterator begin() const { return tree_.begin(); }
+    iterator end() const { return tree_.end(); }
+
+private:
+    mutable std::mutex mutex_;
+    AVLTree<Key, Value> tree_;
+};
+
+template <class Engine>
+static size_t countEntries(const Engine& map)
+{
+    size_t n = 0;
+    for(typename Engine::iterator it = map.begin(); it != map.end(); ++it){
+        n++;
+    }
+    return n;
+}
+
+static void report(const char* engine, const char* workload, unsigned threads, size_t ops, double ns, size_t entries)
+{
+    std::printf("{\"bench\":\"concurrent\",\"engine\":\"%s\",\"workload\":\"%s\",\"threads\":%u,"
+                "\"ops_per_sec\":%.0f,\"ns_per_op\":%.2f,\"entries\":%zu}\n",
+                engine, workload, threads, ops / (ns / 1e9), ns / ops, entries);
+    std::fflush(stdout);
+}
+
+template <class Engine>
+static void run(const char* name, const std::vector<uint64_t>& keys, unsigned threads)
+{
+    Engine map;
+    size_t perThread = keys.size() / threads;
+    std::vector<std::thread> pool;
+
+    Stopwatch clock;
+    for(unsigned t = 0; t < threads; ++t){
+        pool.push_back(std::thread([&map, &keys, perThread, t]() {
+            for(size_t i = t * perThread; i < (t + 1) * perThread; ++i){
+                map.insert(std::make_pair(keys[i], keys[i]));
+            }
+        }));
+    }
+    for(size_t i = 0; i < pool.size(); ++i){
+        pool[i].join();
+    }
+    double ingestNs = clock.elapsedNs();
+    size_t entries = countEntries(map);
+    if(entries != perThread * threads){
+        std::fprintf(stderr, "%s: %zu entries after ingest, expected %zu\n", name, entries, perThread * threads);
+        std::exit(1);
+    }
+    report(name, "ingest", threads, perThread * threads, ingestNs, entries);
+
+    pool.clear();
+    std::atomic<size_t> hits(0);
+    clock.reset();
+    for(unsigned t = 0; t < threads; ++t){
+        pool.push_back(std::thread([&map, &keys, &hits, perThread, t]() {
+            size_t found = 0;
+            std::mt19937_64 rng(t + 1);
+            for(size_t i = 0; i < perThread; ++i){
+                uint64_t key = keys[rng() % keys.size()];
+                switch(rng() & 3){
+                case 0:
+                    map.insert(std::make_pair(key, i));
+                    break;
+                case 1:
+                    map.remove(key);
+                    break;
+                default:
+                    found += map.find(key) != map.end();
+                }
+            }
+            hits += found;
+        }));
+    }
+    for(size_t i = 0; i < pool.size(); ++i){
+        pool[i].join();
+    }
+    report(name, "churn", threads, perThread * threads, clock.elapsedNs(), countEntries(map));
+}
+
+int main(int argc, char* argv[])
+{
+    size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::mt19937_64 rng(42);
+
+    // distinct keys: a random odd multiplier permutes 0..2^64-1
+    std::vector<uint64_t> keys(entries);
+    uint64_t multiplier = rng() | 1;
+    for(size_t i = 0; i < entries; ++i){
+        keys[i] = i * multiplier;
+    }
+
+    for(unsigned threads = 1; threads <= 64; threads *= 2){
+        run<LockedAVLTree<uint64_t, uint64_t> >("locked_avl", keys, threads);
+        run<LockFreeSkipList<uint64_t, uint64_t> >("lockfree_skiplist", keys, threads);
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Compares the branchless and the if/else descents of AVLTree on random
+// lookups of integer keys.
+//
+// usage: descent-bench [max_entries]
+//
+// For sizes 1K, 10K, ... up to max_entries (default 1M), fills an AVLTree
+// with random keys and looks up a random mix of present and absent keys.
+// uint64_t keys take the branchless descent (see BranchlessDescent);
+// BranchyKey, an enum over the same 64 bits, is not arithmetic and takes
+// the if/else one, with the very same comparisons. Branch misses are read
+// from the hardware counters where perf_event_open is allowed (-1
+// otherwise). Prints one JSON object per (descent, size).
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include "../avlbst.h"
+#include "perf_counters.h"
+
+enum BranchyKey : uint64_t {};
+
+template <class Key>
+static void run(const char* name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& lookups)
+{
+    AVLTree<Key, uint64_t> tree;
+    Stopwatch clock;
+    for(size_t i = 0; i < keys.size(); ++i){
+        tree.insert(std::make_pair(static_cast<Key>(keys[i]), keys[i]));
+    }
+    double insertNs = clock.elapsedNs();
+
+    PerfCounter misses(PerfCounter::BRANCH_MISSES);
+    uint64_t hits = 0;
+    misses.start();
+    clock.reset();
+    for(size_t i = 0; i < lookups.size(); ++i){
+        hits += tree.find(static_cast<Key>(lookups[i])) != tree.end();
+    }
+    double findNs = clock.elapsedNs();
+    uint64_t findMisses = misses.stop();
+
+    std::printf("{\"bench\":\"descent\",\"descent\":\"%s\",\"entries\":%zu,"
+                "\"insert_ns_per_op\":%.2f,\"find_ns_per_op\":%.2f,\"find_branch_misses_per_op\":%.3f,"
+                "\"hits\":%llu}\n",
+                name, keys.size(), insertNs / keys.size(), findNs / lookups.size(),
+                misses.valid() ? static_cast<double>(findMisses) / lookups.size() : -1.0,
+                static_cast<unsigned long long>(hits));
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t maxEntries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::mt19937_64 rng(42);
+
+    for(size_t n = 1000; n <= maxEntries; n *= 10){
+        // even keys are in the tree, odd ones are not
+        std::vector<uint64_t> keys(n);
+        for(size_t i = 0; i < n; ++i){
+            keys[i] = (rng() >> 1) << 1;
+        }
+        std::vector<uint64_t> lookups(2000000);
+        for(size_t i = 0; i < lookups.size(); ++i){
+            lookups[i] = keys[rng() % n] | (rng() & 1);
+        }
+        run<uint64_t>("branchless", keys, lookups);
+        run<BranchyKey>("branchy", keys, lookups);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+* A hardware event counter for the calling thread, read through
+* perf_event_open on Linux. When the event is unavailable (other
+* platforms, containers, perf_event_paranoid too high) valid() is
+* false and read() returns 0, so benchmarks still report timings.
+*/
+class PerfCounter
+{
+public:
+    enum Event { CACHE_MISSES, L1D_READ_MISSES, BRANCH_MISSES, INSTRUCTIONS };
+
+    explicit PerfCounter(Event event);
+    ~PerfCounter();
+
+    bool valid() const;
+    void start();
+    uint64_t stop();
+
+private:
+    PerfCounter(const PerfCounter&);
+    PerfCounter& operator=(const PerfCounter&);
+
+    int fd_;
+};
+
+inline PerfCounter::PerfCounter(Event event) :
+    fd_(-1)
+{
+#if defined(__linux__)
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    switch(event){
+    case CACHE_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case L1D_READ_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case BRANCH_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    }
+    fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+    (void)event;
+#endif
+}
+
+inline PerfCounter::~PerfCounter()
+{
+    if(fd_ >= 0){
+        close(fd_);
+    }
+}
+
+inline bool PerfCounter::valid() const
+{
+    return fd_ >= 0;
+}
+
+inline void PerfCounter::start()
+{
+#if defined(__linux__)
+    if(fd_ >= 0){
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+inline uint64_t PerfCounter::stop()
+{
+    uint64_t count = 0;
+#if defined(__linux__)
+    if(fd_ >= 0){
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(fd_, &count, sizeof(count)) != sizeof(count)){
+            count = 0;
+        }
+    }
+#endif
+    return count;
+}
+
+/**
+* Wall-clock stopwatch in nanoseconds.
+*/
+class Stopwatch
+{
+public:
+    Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+
+    void reset() { start_ = std::chrono::steady_clock::now(); }
+
+    double elapsedNs() const
+    {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif
@@ -0,0 +1,73 @@
+// Measures CompactAVLTree lookups before and after relayout().
+//
+// usage: relayout-bench [entries] [lookups]
+//
+// Keys are inserted in random order, so the arena starts out in insertion
+// order and a descent touches an unrelated cache line at every level.
+// Prints one JSON object per layout.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "../compactavl.h"
+#include "perf_counters.h"
+
+static void measure(const char* layout, CompactAVLTree<uint64_t, uint64_t>& tree,
+                    const std::vector<uint64_t>& probes)
+{
+    PerfCounter misses(PerfCounter::CACHE_MISSES);
+    PerfCounter l1(PerfCounter::L1D_READ_MISSES);
+    uint64_t sum = 0;
+    Stopwatch clock;
+    misses.start();
+    l1.start();
+    for(size_t i = 0; i < probes.size(); ++i){
+        sum += tree.find(probes[i])->second;
+    }
+    uint64_t l1Misses = l1.stop();
+    uint64_t cacheMisses = misses.stop();
+    double ns = clock.elapsedNs();
+
+    std::printf("{\"bench\":\"relayout\",\"layout\":\"%s\",\"entries\":%zu,\"lookups\":%zu,"
+                "\"ns_per_lookup\":%.2f", layout, tree.size(), probes.size(), ns / probes.size());
+    if(misses.valid()){
+        std::printf(",\"llc_misses_per_lookup\":%.3f", static_cast<double>(cacheMisses) / probes.size());
+    }
+    if(l1.valid()){
+        std::printf(",\"l1d_misses_per_lookup\":%.3f", static_cast<double>(l1Misses) / probes.size());
+    }
+    std::printf(",\"checksum\":%llu}\n", static_cast<unsigned long long>(sum));
+}
+
+int main(int argc, char* argv[])
+{
+    size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    size_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(entries);
+    for(size_t i = 0; i < entries; ++i){
+        keys[i] = i * 2654435761u;
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    CompactAVLTree<uint64_t, uint64_t> tree;
+    tree.reserve(entries);
+    for(size_t i = 0; i < entries; ++i){
+        tree.insert(std::make_pair(keys[i], static_cast<uint64_t>(i)));
+    }
+
+    std::vector<uint64_t> probes(lookups);
+    for(size_t i = 0; i < lookups; ++i){
+        probes[i] = keys[rng() % entries];
+    }
+
+    measure("insertion", tree, probes);
+    Stopwatch clock;
+    tree.relayout();
+    std::fprintf(stderr, "relayout of %zu nodes took %.1f ms\n", entries, clock.elapsedNs() / 1e6);
+    measure("veb", tree, probes);
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Compares how long a persisted tree takes to become usable: reopening a
+// MappedAVLTree file against loading an AVLTree snapshot (save()/load()).
+//
+// usage: startup-bench [max_entries] [dir]
+//
+// For sizes 10K, 100K, ... up to max_entries (default 1M), writes both
+// files for the same random keys into dir (default /tmp), then times,
+// from nothing in memory, opening or loading the tree and answering 1000
+// random lookups. "cold" runs first evict the file from the page cache
+// with posix_fadvise(DONTNEED), which works without root as long as the
+// pages are clean; "warm" runs read it straight from the page cache.
+// Prints one JSON object per (format, cache, size); open_ns is the time
+// until the tree can answer, total_ns includes the lookups.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../avlbst.h"
+#include "../mappedavl.h"
+#include "perf_counters.h"
+
+static void evict(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        std::perror(path.c_str());
+        std::exit(1);
+    }
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+static void report(const char* format, bool cold, size_t entries, double openNs, double totalNs, uint64_t sum)
+{
+    std::printf("{\"bench\":\"startup\",\"format\":\"%s\",\"cache\":\"%s\",\"entries\":%zu,"
+                "\"open_ns\":%.0f,\"total_ns\":%.0f,\"checksum\":%llu}\n",
+                format, cold ? "cold" : "warm", entries, openNs, totalNs,
+                static_cast<unsigned long long>(sum));
+    std::fflush(stdout);
+}
+
+static void snapshotRun(const std::string& path, bool cold, size_t entries, const std::vector<uint64_t>& probes)
+{
+    if(cold){
+        evict(path);
+    }
+    Stopwatch clock;
+    AVLTree<uint64_t, uint64_t> tree;
+    std::ifstream in(path.c_str(), std::ios::binary);
+    tree.load(in);
+    double openNs = clock.elapsedNs();
+    uint64_t sum = 0;
+    for(size_t i = 0; i < probes.size(); ++i){
+        sum += tree.find(probes[i])->second;
+    }
+    report("snapshot", cold, entries, openNs, clock.elapsedNs(), sum);
+}
+
+static void mappedRun(const std::string& path, bool cold, size_t entries, const std::vector<uint64_t>& probes)
+{
+    if(cold){
+        evict(path);
+    }
+    Stopwatch clock;
+    const MappedAVLTree<uint64_t, uint64_t> tree(path);
+    double openNs = clock.elapsedNs();
+    uint64_t sum = 0;
+    for(size_t i = 0; i < probes.size(); ++i){
+        sum += tree.find(probes[i])->second;
+    }
+    report("mapped", cold, entries, openNs, clock.elapsedNs(), sum);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t maxEntries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+    std::string snapshotPath = dir + "/startup-bench.snap";
+    std::string mappedPath = dir + "/startup-bench.avl";
+    std::mt19937_64 rng(42);
+
+    for(size_t entries = 10000; entries <= maxEntries; entries *= 10){
+        std::vector<uint64_t> keys(entries);
+        ::unlink(mappedPath.c_str());
+        {
+            AVLTree<uint64_t, uint64_t> tree;
+            MappedAVLTree<uint64_t, uint64_t> mapped(mappedPath);
+            for(size_t i = 0; i < entries; ++i){
+                keys[i] = rng();
+                tree.insert(std::make_pair(keys[i], i));
+                mapped.insert(std::make_pair(keys[i], i));
+            }
+            mapped.relayout();
+            mapped.sync();
+            std::ofstream out(snapshotPath.c_str(), std::ios::binary | std::ios::trunc);
+            tree.save(out);
+        }
+        std::vector<uint64_t> probes(1000);
+        for(size_t i = 0; i < probes.size(); ++i){
+            probes[i] = keys[rng() % entries];
+        }
+
+        for(int cold = 1; cold >= 0; --cold){
+            snapshotRun(snapshotPath, cold, entries, probes);
+            mappedRun(mappedPath, cold, entries, probes);
+        }
+    }
+    ::unlink(snapshotPath.c_str());
+    ::unlink(mappedPath.c_str());
+    return 0;
+}
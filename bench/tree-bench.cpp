@@ -0,0 +1,293 @@
+// Throughput of BinarySearchTree (plain and in scapegoat mode), AVLTree
+// and std::map across key distributions and sizes.
+//
+// usage: tree-bench [max_entries]
+//
+// For every distribution (sorted, reverse, random, zipf, clustered) and
+// every size 1K, 10K, ... up to max_entries (default 1M; 100M needs tens
+// of GB), each tree is timed on:
+//
+//   insert   every generated key, in generation order
+//   find     every generated key again, in the same order
+//   batch    the same lookups through findBatch (a plain loop for std::map)
+//   iterate  one full in-order pass
+//   remove   every generated key, in the same order
+//   clear    a refilled tree, per item
+//
+// Zipf keys repeat (theta 0.99), so those trees hold fewer items than keys
+// were generated; "items" is the resulting size. The unbalanced
+// BinarySearchTree goes quadratic on sorted and reverse keys and is capped
+// at degenerateCap entries there. Heap allocations are counted by
+// replacing the global operator new. rss_bytes is the resident set of the
+// whole process while the filled tree is alive; memory freed by earlier
+// runs is reused, so compare it across builds rather than across trees.
+//
+// Prints one JSON object per (tree, distribution, size).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include <map>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <unistd.h>
+#include "../avlbst.h"
+#include "perf_counters.h"
+
+static uint64_t allocations = 0;
+static uint64_t allocatedBytes = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+    allocatedBytes += size;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if(p == nullptr){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+// kept out of line: once inlined, gcc pairs the free() with the builtin
+// operator new and warns about a mismatch
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+static const size_t degenerateCap = 20000;
+
+typedef ScapegoatBST<uint64_t, uint64_t> ScapegoatTree;
+
+// resident set size in bytes, from /proc/self/statm
+static long residentBytes()
+{
+    long pages = 0;
+    long resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if(f == nullptr){
+        return 0;
+    }
+    if(std::fscanf(f, "%ld %ld", &pages, &resident) != 2){
+        resident = 0;
+    }
+    std::fclose(f);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// bijective scramble, so distinct inputs stay distinct keys
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 31;
+    x *= 0x7fb5d329728ea185ULL;
+    x ^= x >> 27;
+    x *= 0x81dadef4bc2dd44dULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+* Zipfian ranks in [0, n) with the closed-form generator from Gray et
+* al., "Quickly Generating Billion-Record Synthetic Databases", as used
+* by YCSB. Rank 0 is the most popular.
+*/
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(uint64_t n, double theta) :
+        n_(n), theta_(theta), alpha_(1.0 / (1.0 - theta)), zetan_(zeta(n, theta))
+    {
+        eta_ = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta(2, theta) / zetan_);
+    }
+
+    template <class Rng>
+    uint64_t operator()(Rng& rng)
+    {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan_;
+        if(uz < 1.0){
+            return 0;
+        }
+        if(uz < 1.0 + std::pow(0.5, theta_)){
+            return 1;
+        }
+        uint64_t rank = static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return rank < n_ ? rank : n_ - 1;
+    }
+
+private:
+    static double zeta(uint64_t n, double theta)
+    {
+        double sum = 0;
+        for(uint64_t i = 1; i <= n; ++i){
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+
+    uint64_t n_;
+    double theta_;
+    double alpha_;
+    double zetan_;
+    double eta_;
+};
+
+static std::vector<uint64_t> generate(const std::string& distribution, size_t n)
+{
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> keys(n);
+    if(distribution == "sorted"){
+        for(size_t i = 0; i < n; ++i) keys[i] = i;
+    }
+    else if(distribution == "reverse"){
+        for(size_t i = 0; i < n; ++i) keys[i] = n - i;
+    }
+    else if(distribution == "random"){
+        for(size_t i = 0; i < n; ++i) keys[i] = mix(i);
+    }
+    else if(distribution == "zipf"){
+        ZipfGenerator zipf(n, 0.99);
+        for(size_t i = 0; i < n; ++i) keys[i] = mix(zipf(rng));
+    }
+    else{
+        // runs of 64 consecutive keys starting at random places
+        for(size_t i = 0; i < n; ++i) keys[i] = (mix(i / 64) & ~63ULL) + i % 64;
+    }
+    return keys;
+}
+
+// the three trees have slightly different interfaces
+template <class Tree>
+static void put(Tree& tree, uint64_t key)
+{
+    tree.insert(std::make_pair(key, key));
+}
+
+static void put(std::map<uint64_t, uint64_t>& tree, uint64_t key)
+{
+    tree[key] = key;
+}
+
+template <class Tree>
+static uint64_t findAll(const Tree& tree, const std::vector<uint64_t>& keys)
+{
+    std::vector<typename Tree::iterator> found;
+    tree.findBatch(keys, found);
+    uint64_t hits = 0;
+    for(size_t i = 0; i < found.size(); ++i){
+        hits += found[i] != tree.end();
+    }
+    return hits;
+}
+
+static uint64_t findAll(const std::map<uint64_t, uint64_t>& tree, const std::vector<uint64_t>& keys)
+{
+    uint64_t hits = 0;
+    for(size_t i = 0; i < keys.size(); ++i){
+        hits += tree.find(keys[i]) != tree.end();
+    }
+    return hits;
+}
+
+template <class Tree>
+static void erase(Tree& tree, uint64_t key)
+{
+    tree.remove(key);
+}
+
+static void erase(std::map<uint64_t, uint64_t>& tree, uint64_t key)
+{
+    tree.erase(key);
+}
+
+template <class Tree>
+static void run(const char* name, const std::string& distribution, const std::vector<uint64_t>& keys)
+{
+    uint64_t sink = 0;
+    Tree* tree = new Tree;
+
+    uint64_t allocsBefore = allocations;
+    uint64_t bytesBefore = allocatedBytes;
+    Stopwatch clock;
+    for(size_t i = 0; i < keys.size(); ++i){
+        put(*tree, keys[i]);
+    }
+    double insertNs = clock.elapsedNs();
+    uint64_t insertAllocs = allocations - allocsBefore;
+    uint64_t insertBytes = allocatedBytes - bytesBefore;
+    long rss = residentBytes();
+
+    clock.reset();
+    for(size_t i = 0; i < keys.size(); ++i){
+        sink += tree->find(keys[i]) != tree->end();
+    }
+    double findNs = clock.elapsedNs();
+
+    clock.reset();
+    sink += findAll(*tree, keys);
+    double batchNs = clock.elapsedNs();
+
+    size_t items = 0;
+    clock.reset();
+    for(typename Tree::iterator it = tree->begin(); it != tree->end(); ++it){
+        sink += it->second;
+        items++;
+    }
+    double iterateNs = clock.elapsedNs();
+
+    clock.reset();
+    for(size_t i = 0; i < keys.size(); ++i){
+        erase(*tree, keys[i]);
+    }
+    double removeNs = clock.elapsedNs();
+
+    for(size_t i = 0; i < keys.size(); ++i){
+        put(*tree, keys[i]);
+    }
+    clock.reset();
+    tree->clear();
+    double clearNs = clock.elapsedNs();
+    delete tree;
+
+    double n = static_cast<double>(keys.size());
+    double perItem = items == 0 ? 1.0 : static_cast<double>(items);
+    std::printf("{\"bench\":\"tree\",\"tree\":\"%s\",\"distribution\":\"%s\",\"keys\":%zu,\"items\":%zu,"
+                "\"insert_ns_per_op\":%.2f,\"find_ns_per_op\":%.2f,\"find_batch_ns_per_op\":%.2f,\"iterate_ns_per_item\":%.2f,"
+                "\"remove_ns_per_op\":%.2f,\"clear_ns_per_item\":%.2f,"
+                "\"allocs_per_insert\":%.3f,\"alloc_bytes_per_item\":%.1f,\"rss_bytes\":%ld,"
+                "\"checksum\":%llu}\n",
+                name, distribution.c_str(), keys.size(), items,
+                insertNs / n, findNs / n, batchNs / n, iterateNs / perItem, removeNs / n, clearNs / perItem,
+                insertAllocs / n, insertBytes / perItem, rss,
+                static_cast<unsigned long long>(sink));
+    std::fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t maxEntries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const char* distributions[] = { "sorted", "reverse", "random", "zipf", "clustered" };
+
+    for(size_t d = 0; d < sizeof(distributions) / sizeof(distributions[0]); ++d){
+        std::string distribution = distributions[d];
+        bool degenerate = distribution == "sorted" || distribution == "reverse";
+        for(size_t n = 1000; n <= maxEntries; n *= 10){
+            std::vector<uint64_t> keys = generate(distribution, n);
+            if(!degenerate || n <= degenerateCap){
+                run<BinarySearchTree<uint64_t, uint64_t> >("BinarySearchTree", distribution, keys);
+            }
+            run<ScapegoatTree>("ScapegoatBST", distribution, keys);
+            run<AVLTree<uint64_t, uint64_t> >("AVLTree", distribution, keys);
+            run<std::map<uint64_t, uint64_t> >("std::map", distribution, keys);
+        }
+    }
+    return 0;
+}
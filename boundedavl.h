@@ -0,0 +1,473 @@
+#ifndef BOUNDEDAVL_H
+#define BOUNDEDAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* An AVLNode on the CLOCK ring of a BoundedAVLTree, with its reference
+* bit and the bytes it was charged.
+*/
+template <typename Key, typename Value>
+class BoundedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    BoundedAVLNode(const Key& key, const Value& value, BoundedAVLNode<Key, Value>* parent);
+    virtual ~BoundedAVLNode();
+
+    bool isReferenced() const;
+    void setReferenced(bool referenced);
+    size_t getCharge() const;
+    void setCharge(size_t charge);
+    BoundedAVLNode<Key, Value>* getClockNext() const;
+    void setClockNext(BoundedAVLNode<Key, Value>* next);
+    BoundedAVLNode<Key, Value>* getClockPrev() const;
+    void setClockPrev(BoundedAVLNode<Key, Value>* prev);
+
+    virtual BoundedAVLNode<Key, Value>* getParent() const override;
+    virtual BoundedAVLNode<Key, Value>* getLeft() const override;
+    virtual BoundedAVLNode<Key, Value>* getRight() const override;
+
+protected:
+    // sits in the tail padding after AVLNode's balance, so it is free
+    bool referenced_;
+    size_t charge_;
+    BoundedAVLNode<Key, Value>* clockNext_;
+    BoundedAVLNode<Key, Value>* clockPrev_;
+};
+
+/*
+  ----------------------------------------------------
+  Begin implementations for the BoundedAVLNode class.
+  ----------------------------------------------------
+*/
+
+template<class Key, class Value>
+BoundedAVLNode<Key, Value>::BoundedAVLNode(const Key& key, const Value& value, BoundedAVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent),
+    referenced_(false),
+    charge_(0),
+    clockNext_(this),
+    clockPrev_(this)
+{
+
+}
+
+template<class Key, class Value>
+BoundedAVLNode<Key, Value>::~BoundedAVLNode()
+{
+
+}
+
+template<class Key, class Value>
+bool BoundedAVLNode<Key, Value>::isReferenced() const
+{
+    return referenced_;
+}
+
+template<class Key, class Value>
+void BoundedAVLNode<Key, Value>::setReferenced(bool referenced)
+{
+    referenced_ = referenced;
+}
+
+template<class Key, class Value>
+size_t BoundedAVLNode<Key, Value>::getCharge() const
+{
+    return charge_;
+}
+
+template<class Key, class Value>
+void BoundedAVLNode<Key, Value>::setCharge(size_t charge)
+{
+    charge_ = charge;
+}
+
+template<class Key, class Value>
+BoundedAVLNode<Key, Value>* BoundedAVLNode<Key, Value>::getClockNext() const
+{
+    return clockNext_;
+}
+
+template<class Key, class Value>
+void BoundedAVLNode<Key, Value>::setClockNext(BoundedAVLNode<Key, Value>* next)
+{
+    clockNext_ = next;
+}
+
+template<class Key, class Value>
+BoundedAVLNode<Key, Value>* BoundedAVLNode<Key, Value>::getClockPrev() const
+{
+    return clockPrev_;
+}
+
+template<class Key, class Value>
+void BoundedAVLNode<Key, Value>::setClockPrev(BoundedAVLNode<Key, Value>* prev)
+{
+    clockPrev_ = prev;
+}
+
+template<class Key, class Value>
+BoundedAVLNode<Key, Value>* BoundedAVLNode<Key, Value>::getParent() const
+{
+    return static_cast<BoundedAVLNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+BoundedAVLNode<Key, Value>* BoundedAVLNode<Key, Value>::getLeft() const
+{
+    return static_cast<BoundedAVLNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+BoundedAVLNode<Key, Value>* BoundedAVLNode<Key, Value>::getRight() const
+{
+    return static_cast<BoundedAVLNode<Key, Value>*>(this->right_);
+}
+
+/*
+  --------------------------------------------------
+  End implementations for the BoundedAVLNode class.
+  --------------------------------------------------
+*/
+
+/**
+* Default payload hook for BoundedAVLTree: keys and values own no memory
+* outside the node. Trees holding strings, vectors and the like pass a
+* sizer whose payloadBytes() returns the heap memory an entry owns.
+*/
+template <typename Key, typename Value>
+struct InlinePayloadSizer
+{
+    static size_t payloadBytes(const Key&, const Value&) { return 0; }
+};
+
+/**
+* An AVLTree used as a cache with a hard memory budget. Every entry is
+* charged the size of its node plus Sizer::payloadBytes(key, value), and
+* whenever the total goes over maxBytes, entries are evicted until it
+* fits again; an entry too large for the budget on its own is evicted
+* right away.
+*
+* Victims are picked with CLOCK, an approximation of LRU: the nodes sit
+* on a circular list in insertion order, find(), findBatch() and
+* operator[] set a reference bit in the node, and the clock hand walks the ring clearing
+* set bits until it reaches an unreferenced node. Every bit the hand
+* clears was set by an earlier lookup, so picking a victim is O(1)
+* amortized; unlinking it from the tree is the usual O(log n) remove.
+* Ordered iteration does not count as a reference, so scans do not
+* flush the cache. Lookups write the reference bit, so concurrent
+* readers need the same locking as writers.
+*/
+template <class Key, class Value, class Sizer = InlinePayloadSizer<Key, Value> >
+class BoundedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename AVLTree<Key, Value>::iterator iterator;
+
+    explicit BoundedAVLTree(size_t maxBytes);
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual iterator insert(iterator hint, const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    virtual void clear();
+    virtual void load(std::istream& is);
+
+    iterator find(const Key& key) const;
+    void findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    size_t size() const;
+    size_t bytes() const;
+    size_t maxBytes() const;
+    void setMaxBytes(size_t maxBytes);
+    uint64_t evictions() const;
+
+protected:
+    typedef BoundedAVLNode<Key, Value> NodeType;
+
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent) override;
+
+    static size_t chargeFor(const Key& key, const Value& value);
+    NodeType* touch(const Key& key) const;
+    void ringInsert(NodeType* node);
+    void ringErase(NodeType* node);
+    void evictOverflow();
+
+    size_t maxBytes_;
+    size_t bytes_;
+    uint64_t evictions_;
+    // next node the clock hand examines, NULL when the tree is empty;
+    // new nodes join just behind it
+    NodeType* hand_;
+};
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the BoundedAVLTree class.
+  ---------------------------------------------------
+*/
+
+template<class Key, class Value, class Sizer>
+BoundedAVLTree<Key, Value, Sizer>::BoundedAVLTree(size_t maxBytes) :
+    maxBytes_(maxBytes),
+    bytes_(0),
+    evictions_(0),
+    hand_(nullptr)
+{
+
+}
+
+/**
+* Inserts or overwrites an entry and evicts until the tree fits its
+* budget again. Overwriting counts as a reference.
+*/
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::insert(const std::pair<const Key, Value>& new_item)
+{
+    NodeType* node = static_cast<NodeType*>(this->internalFind(new_item.first));
+    if(node != nullptr){
+        node->setValue(new_item.second);
+        size_t charge = chargeFor(new_item.first, new_item.second);
+        bytes_ = bytes_ - node->getCharge() + charge;
+        node->setCharge(charge);
+        node->setReferenced(true);
+    }
+    else{
+        // createNode() charges the node and puts it on the ring
+        AVLTree<Key, Value>::insert(new_item);
+    }
+    evictOverflow();
+}
+
+/**
+* Hinted insert, see AVLTree, charged and evicted like insert(item).
+* Returns end() if the entry itself had to be evicted.
+*/
+template<class Key, class Value, class Sizer>
+typename BoundedAVLTree<Key, Value, Sizer>::iterator
+BoundedAVLTree<Key, Value, Sizer>::insert(iterator hint, const std::pair<const Key, Value>& new_item)
+{
+    size_t before = this->size_;
+    NodeType* node = static_cast<NodeType*>(this->iteratorNode(AVLTree<Key, Value>::insert(hint, new_item)));
+    if(this->size_ == before){
+        size_t charge = chargeFor(new_item.first, new_item.second);
+        bytes_ = bytes_ - node->getCharge() + charge;
+        node->setCharge(charge);
+        node->setReferenced(true);
+    }
+    evictOverflow();
+    return this->makeIterator(this->internalFind(new_item.first));
+}
+
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::remove(const Key& key)
+{
+    NodeType* node = static_cast<NodeType*>(this->internalFind(key));
+    if(node == nullptr){
+        return;
+    }
+    ringErase(node);
+    AVLTree<Key, Value>::remove(key);
+}
+
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::clear()
+{
+    AVLTree<Key, Value>::clear();
+    hand_ = nullptr;
+    bytes_ = 0;
+}
+
+/**
+* Loads a snapshot, then evicts (in key order, as nothing has been
+* referenced yet) until it fits the budget.
+*/
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::load(std::istream& is)
+{
+    clear();
+    BinarySearchTree<Key, Value>::load(is);
+    evictOverflow();
+}
+
+template<class Key, class Value, class Sizer>
+typename BoundedAVLTree<Key, Value, Sizer>::iterator BoundedAVLTree<Key, Value, Sizer>::find(const Key& key) const
+{
+    return this->makeIterator(touch(key));
+}
+
+/**
+* AVLTree::findBatch, marking every node found referenced as find() does.
+*/
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    AVLTree<Key, Value>::findBatch(keys, out);
+    for(size_t i = 0; i < out.size(); ++i){
+        NodeType* node = static_cast<NodeType*>(this->iteratorNode(out[i]));
+        if(node != nullptr){
+            node->setReferenced(true);
+        }
+    }
+}
+
+template<class Key, class Value, class Sizer>
+Value& BoundedAVLTree<Key, Value, Sizer>::operator[](const Key& key)
+{
+    NodeType* node = touch(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value, class Sizer>
+Value const & BoundedAVLTree<Key, Value, Sizer>::operator[](const Key& key) const
+{
+    NodeType* node = touch(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value, class Sizer>
+size_t BoundedAVLTree<Key, Value, Sizer>::size() const
+{
+    return this->size_;
+}
+
+/**
+* Bytes currently charged: nodes plus their payloads.
+*/
+template<class Key, class Value, class Sizer>
+size_t BoundedAVLTree<Key, Value, Sizer>::bytes() const
+{
+    return bytes_;
+}
+
+template<class Key, class Value, class Sizer>
+size_t BoundedAVLTree<Key, Value, Sizer>::maxBytes() const
+{
+    return maxBytes_;
+}
+
+/**
+* Changes the budget; shrinking it evicts straight away.
+*/
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::setMaxBytes(size_t maxBytes)
+{
+    maxBytes_ = maxBytes;
+    evictOverflow();
+}
+
+/**
+* Number of entries evicted to stay within budget so far.
+*/
+template<class Key, class Value, class Sizer>
+uint64_t BoundedAVLTree<Key, Value, Sizer>::evictions() const
+{
+    return evictions_;
+}
+
+template<class Key, class Value, class Sizer>
+Node<Key, Value>* BoundedAVLTree<Key, Value, Sizer>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    NodeType* node = new NodeType(key, value, static_cast<NodeType*>(parent));
+    node->setCharge(chargeFor(key, value));
+    ringInsert(node);
+    return node;
+}
+
+template<class Key, class Value, class Sizer>
+size_t BoundedAVLTree<Key, Value, Sizer>::chargeFor(const Key& key, const Value& value)
+{
+    return sizeof(NodeType) + Sizer::payloadBytes(key, value);
+}
+
+/**
+* Looks key up and marks its node referenced.
+*/
+template<class Key, class Value, class Sizer>
+typename BoundedAVLTree<Key, Value, Sizer>::NodeType* BoundedAVLTree<Key, Value, Sizer>::touch(const Key& key) const
+{
+    NodeType* node = static_cast<NodeType*>(this->internalFind(key));
+    if(node != nullptr){
+        node->setReferenced(true);
+    }
+    return node;
+}
+
+/**
+* Adds node to the ring just behind the hand, so that it is the last one
+* the hand reaches, and charges it to the budget.
+*/
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::ringInsert(NodeType* node)
+{
+    if(hand_ == nullptr){
+        node->setClockNext(node);
+        node->setClockPrev(node);
+        hand_ = node;
+    }
+    else{
+        NodeType* prev = hand_->getClockPrev();
+        node->setClockPrev(prev);
+        node->setClockNext(hand_);
+        prev->setClockNext(node);
+        hand_->setClockPrev(node);
+    }
+    bytes_ += node->getCharge();
+}
+
+/**
+* Takes node off the ring and out of the budget, ahead of its removal
+* from the tree.
+*/
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::ringErase(NodeType* node)
+{
+    if(node->getClockNext() == node){
+        hand_ = nullptr;
+    }
+    else{
+        if(hand_ == node){
+            hand_ = node->getClockNext();
+        }
+        node->getClockPrev()->setClockNext(node->getClockNext());
+        node->getClockNext()->setClockPrev(node->getClockPrev());
+    }
+    node->setClockNext(node);
+    node->setClockPrev(node);
+    bytes_ -= node->getCharge();
+}
+
+/**
+* Runs the clock until the tree fits its budget.
+*/
+template<class Key, class Value, class Sizer>
+void BoundedAVLTree<Key, Value, Sizer>::evictOverflow()
+{
+    while(bytes_ > maxBytes_ && hand_ != nullptr){
+        // give referenced nodes a second chance
+        while(hand_->isReferenced()){
+            hand_->setReferenced(false);
+            hand_ = hand_->getClockNext();
+        }
+        NodeType* victim = hand_;
+        ringErase(victim);
+        AVLTree<Key, Value>::remove(victim->getKey());
+        evictions_++;
+    }
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the BoundedAVLTree class.
+  -------------------------------------------------
+*/
+
+#endif
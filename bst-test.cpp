@@ -1,7 +1,20 @@
 #include <iostream>
 #include <map>
+#include <sstream>
+#include <thread>
 #include "bst.h"
 #include "avlbst.h"
+#include "augmentedavl.h"
+#include "intervaltree.h"
+#include "lazyavl.h"
+#include "ttlavl.h"
+#include "boundedavl.h"
+#include "splitavl.h"
+#include "stringavl.h"
+#include "statictree.h"
+#include "skiplist.h"
+#include "compactavl.h"
+#include "wavlbst.h"
 
 using namespace std;
 
@@ -44,5 +57,151 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    // Snapshot round trip
+    std::stringstream snapshot;
+    at.insert(std::make_pair('c',3));
+    at.save(snapshot);
+    AVLTree<char,int> loaded;
+    loaded.load(snapshot);
+    cout << "\nReloaded AVLTree contents:" << endl;
+    for(AVLTree<char,int>::iterator it = loaded.begin(); it != loaded.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // WAVL Tree Tests
+    WAVLTree<char,int> wt;
+    wt.insert(std::make_pair('a',1));
+    wt.insert(std::make_pair('b',2));
+    wt.insert(std::make_pair('c',3));
+    wt.remove('a');
+    cout << "\nWAVLTree contents:" << endl;
+    for(WAVLTree<char,int>::iterator it = wt.begin(); it != wt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Compact AVL Tree Tests
+    CompactAVLTree<char,int> ct;
+    ct.insert(std::make_pair('a',1));
+    ct.insert(std::make_pair('b',2));
+
+    cout << "\nCompactAVLTree contents:" << endl;
+    for(CompactAVLTree<char,int>::iterator it = ct.begin(); it != ct.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    if(ct.find('b') != ct.end()) {
+        cout << "Found b" << endl;
+    }
+    else {
+        cout << "Did not find b" << endl;
+    }
+    cout << "Erasing b" << endl;
+    ct.remove('b');
+
+    // Augmented AVL Tree Tests
+    AugmentedAVLTree<char,int,SumAggregate<char,int> > sum;
+    sum.insert(std::make_pair('a',1));
+    sum.insert(std::make_pair('b',2));
+    sum.insert(std::make_pair('c',3));
+    sum.insert(std::make_pair('d',4));
+    sum.remove('c');
+    cout << "\nSum of values from b to d: " << sum.aggregate('b','d') << endl;
+
+    // Interval Tree Tests
+    IntervalTree<int,char> it;
+    it.insert(1, 5, 'a');
+    it.insert(4, 9, 'b');
+    it.insert(7, 8, 'c');
+    std::vector<IntervalTree<int,char>::iterator> hits = it.stab(4);
+    cout << "\nIntervals containing 4:" << endl;
+    for(size_t i = 0; i < hits.size(); ++i) {
+        cout << hits[i]->first << " " << hits[i]->second << endl;
+    }
+
+    // Lazy AVL Tree Tests
+    LazyAVLTree<char,int> lt;
+    lt.insert(std::make_pair('a',1));
+    lt.insert(std::make_pair('b',2));
+    lt.insert(std::make_pair('c',3));
+    lt.remove('b');
+    cout << "\nLazyAVLTree contents:" << endl;
+    for(LazyAVLTree<char,int>::iterator it = lt.begin(); it != lt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // TTL AVL Tree Tests
+    TTLAVLTree<char,int> tt;
+    tt.insert(std::make_pair('a',1));
+    tt.insert(std::make_pair('b',2), 0);
+    tt.insert(std::make_pair('c',3), 60000);
+    cout << "\nTTLAVLTree contents:" << endl;
+    for(TTLAVLTree<char,int>::iterator it = tt.begin(); it != tt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Expired " << tt.expire() << " entries" << endl;
+
+    // Bounded AVL Tree Tests
+    BoundedAVLTree<char,int> bd(2 * sizeof(BoundedAVLNode<char,int>));
+    bd.insert(std::make_pair('a',1));
+    bd.insert(std::make_pair('b',2));
+    bd.find('a');
+    bd.insert(std::make_pair('c',3));
+    cout << "\nBoundedAVLTree contents:" << endl;
+    for(BoundedAVLTree<char,int>::iterator it = bd.begin(); it != bd.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Split AVL Tree Tests
+    SplitAVLTree<char,std::string> sp;
+    sp.insert(std::make_pair('b',std::string("two")));
+    sp.insert(std::make_pair('a',std::string("one")));
+    sp.insert(std::make_pair('c',std::string("three")));
+    sp.remove('b');
+    sp['a'] = "uno";
+    cout << "\nSplitAVLTree contents:" << endl;
+    for(SplitAVLTree<char,std::string>::iterator it = sp.begin(); it != sp.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // String AVL Tree Tests
+    StringAVLTree<int> st;
+    st.insert(std::make_pair(std::string("/usr/share/doc/readme"),1));
+    st.insert(std::make_pair(std::string("/usr/share/doc/license"),2));
+    st.insert(std::make_pair(std::string("/usr/bin"),3));
+    st.remove(std::string("/usr/bin"));
+    cout << "\nStringAVLTree contents:" << endl;
+    for(StringAVLTree<int>::iterator it = st.begin(); it != st.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "/usr/share/doc/readme -> " << st[std::string("/usr/share/doc/readme")] << endl;
+
+    // Static Tree Tests
+    static constexpr std::pair<const int, const char*> names[] = {
+        { 1, "EPERM" }, { 2, "ENOENT" }, { 3, "ESRCH" }, { 4, "EINTR" }, { 5, "EIO" } };
+    static constexpr StaticTree<int, const char*, 5> sn = makeStaticTree(names);
+    static_assert(sn[4][1] == 'I', "StaticTree lookups run at compile time");
+    cout << "\nStaticTree contents:" << endl;
+    for(StaticTree<int, const char*, 5>::iterator it = sn.begin(); it != sn.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "lower_bound(0) = " << sn.lower_bound(0)->second << endl;
+
+    // Lock-Free Skip List Tests
+    LockFreeSkipList<int,int> sl;
+    std::thread evens([&sl]() { for(int i = 0; i < 10; i += 2) sl.insert(std::make_pair(i, i * i)); });
+    std::thread odds([&sl]() { for(int i = 1; i < 10; i += 2) sl.insert(std::make_pair(i, i * i)); });
+    evens.join();
+    odds.join();
+    sl.remove(4);
+    sl.insert(std::make_pair(9, -9));
+    cout << "\nLockFreeSkipList contents:" << endl;
+    for(LockFreeSkipList<int,int>::iterator it = sl.begin(); it != sl.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+#ifdef BST_STATS
+    cout << "\nTree statistics:" << endl;
+    treeStatsSnapshot().print(cout);
+#endif
+
     return 0;
 }
@@ -4,7 +4,49 @@
 #include <iostream>
 #include <exception>
 #include <cstdlib>
+#include <cmath>
+#include <stdexcept>
 #include <utility>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "bst_serialize.h"
+#include "tree_stats.h"
+#include "lookup_cache.h"
+#include "tree_shape.h"
+#include "tree_export.h"
+
+#if defined(__GNUC__)
+#define BST_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define BST_PREFETCH(addr) ((void)0)
+#endif
+
+/**
+* Whether descents over Key run without branching on comparisons. True
+* for arithmetic keys: each comparison is a single instruction, and the
+* direction taken from a random key is a coin flip the branch predictor
+* gets wrong half of the time, so the descent instead always runs to the
+* bottom picking children with conditional moves, and checks for a match
+* once at the end. Other keys keep the early exit on equality, which
+* saves comparisons that cost more than a mispredict. Specialize for a
+* key type to opt it in or out.
+*/
+template <typename Key>
+struct BranchlessDescent : std::integral_constant<bool, std::is_arithmetic<Key>::value>
+{
+};
+
+/**
+* pick ? a : b, computed with masks: compilers are free to turn a plain
+* ?: back into a branch, and do so inside descent loops.
+*/
+template <typename T>
+T* branchlessSelect(bool pick, T* a, T* b)
+{
+    uintptr_t mask = static_cast<uintptr_t>(0) - static_cast<uintptr_t>(pick);
+    return reinterpret_cast<T*>((reinterpret_cast<uintptr_t>(a) & mask) | (reinterpret_cast<uintptr_t>(b) & ~mask));
+}
 
 /**
  * A templated class for a Node in a search tree.
@@ -29,6 +71,7 @@ public:
     virtual Node<Key, Value>* getParent() const;
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
+    Node<Key, Value>* getChild(bool right) const;
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
@@ -144,6 +187,18 @@ Node<Key, Value>* Node<Key, Value>::getRight() const
     return right_;
 }
 
+/**
+* The right child if right is set, else the left one. Not virtual (the
+* overrides of getLeft() and getRight() only narrow the pointer type), so
+* descents can pick a child with a conditional move instead of a branch
+* and an indirect call.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getChild(bool right) const
+{
+    return branchlessSelect(right, right_, left_);
+}
+
 /**
 * A setter for setting the parent of a node.
 */
@@ -197,10 +252,16 @@ public:
     virtual ~BinarySearchTree(); //TODO
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
-    void clear(); //TODO
+    virtual void clear(); //TODO
     bool isBalanced() const; //TODO
+    TreeShape shape(unsigned threads = 1) const;
+    void exportTree(std::ostream& os, const TreeExportOptions& options = TreeExportOptions()) const;
+    void exportSubtree(std::ostream& os, const Key& key, const TreeExportOptions& options = TreeExportOptions()) const;
     void print() const;
     bool empty() const;
+    void save(std::ostream& os) const;
+    virtual void load(std::istream& is);
+    void enableLookupCache(size_t slots);
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
@@ -231,12 +292,14 @@ public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    void findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
 protected:
     // Mandatory helper functions
     Node<Key, Value>* internalFind(const Key& k) const; // TODO
+    Node<Key, Value>* descend(const Key& key, Node<Key, Value>*& parent, size_t& depth) const;
     Node<Key, Value> *getSmallestNode() const;  // TODO
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
     // Note:  static means these functions don't have a "this" pointer
@@ -245,6 +308,8 @@ protected:
     // Provided helper functions
     virtual void printRoot (Node<Key, Value> *r) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
+    virtual void rotateLeft(Node<Key,Value>* node);
+    virtual void rotateRight(Node<Key,Value>* node);
 
 
     // Add helper functions here
@@ -252,10 +317,47 @@ protected:
 	  bool balanceHelper(Node<Key, Value>* node) const; 
     static Node<Key, Value>* successor(Node<Key, Value>* current);
 
+    // Node creation hooks, overridden by trees with their own node types
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void finishBuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight);
+
+    // Liveness hooks for save(), overridden by trees that hold entries
+    // they no longer report: save() takes one stamp, writes liveCount()
+    // as the record count and skips the nodes isLive() rejects
+    virtual uint64_t liveStamp() const;
+    virtual size_t liveCount(uint64_t stamp) const;
+    virtual bool isLive(const Node<Key, Value>* node, uint64_t stamp) const;
+    void loadSnapshot(std::istream& is);
+    Node<Key, Value>* buildFromStream(std::istream& is, uint64_t count, Node<Key, Value>* parent, int& height);
+    static void destroySubtree(Node<Key, Value>* root);
+
+    // Access to iterator internals for derived trees
+    static iterator makeIterator(Node<Key, Value>* node);
+    static Node<Key, Value>* iteratorNode(const iterator& it);
+
+    // must be called before a node is freed, see LookupCache
+    void uncache(Node<Key, Value>* node);
+
+    // scapegoat mode, public in ScapegoatBST; subclasses with their own
+    // insert and remove must not turn it on
+    void enableScapegoat(double alpha);
+    static size_t subtreeSize(Node<Key, Value>* root);
+    void rebuildSubtree(Node<Key, Value>* root, size_t count);
+    static void relinkParents(Node<Key, Value>* root);
+    void rebuildAfterInsert(Node<Key, Value>* added);
+
 
 
 protected:
     Node<Key, Value>* root_;
+    // optional hot-key cache in front of internalFind, NULL when disabled
+    LookupCache<Key, Value>* cache_;
+    // scapegoat mode, see enableScapegoat(); alpha is 0 when disabled
+    double scapegoatAlpha_;
+    double scapegoatLogBase_;
+    // number of nodes, kept by every tree built on this one
+    size_t size_;
+    size_t maxSize_;
     // You should not need other data members
 };
 
@@ -389,6 +491,11 @@ BinarySearchTree<Key, Value>::BinarySearchTree()
 {
     // TODO
     root_ = nullptr;
+    cache_ = nullptr;
+    scapegoatAlpha_ = 0;
+    scapegoatLogBase_ = 0;
+    size_ = 0;
+    maxSize_ = 0;
 }
 
 template<typename Key, typename Value>
@@ -396,7 +503,7 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
 {
     // TODO
     this->clear();
-
+    delete cache_;
 }
 
 /**
@@ -445,11 +552,65 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::find(const Key & k) const
 {
+    BST_STAT_TIMER(TREE_FIND);
     Node<Key, Value> *curr = internalFind(k);
     BinarySearchTree<Key, Value>::iterator it(curr);
     return it;
 }
 
+/**
+* Looks up every key in keys; out[i] becomes find(keys[i]). Descents run
+* in lockstep groups: each pass moves every unfinished lookup of the group
+* down one level and prefetches the child it lands on, so by the time the
+* pass comes back to a lookup its node is usually in cache and the misses
+* of the whole group overlap instead of being paid one after another.
+*/
+template<class Key, class Value>
+void BinarySearchTree<Key, Value>::findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    static const size_t group = 16;
+    out.assign(keys.size(), end());
+    Node<Key, Value>* cursor[group];
+    for(size_t base = 0; base < keys.size(); base += group){
+        size_t count = std::min(group, keys.size() - base);
+        size_t active = 0;
+        for(size_t i = 0; i < count; ++i){
+            Node<Key, Value>* cached = (cache_ != nullptr) ? cache_->lookup(keys[base + i]) : nullptr;
+            if(cached != nullptr){
+                out[base + i] = iterator(cached);
+                cursor[i] = nullptr;
+            }
+            else{
+                cursor[i] = root_;
+                active += (root_ != nullptr);
+            }
+        }
+        while(active > 0){
+            for(size_t i = 0; i < count; ++i){
+                Node<Key, Value>* node = cursor[i];
+                if(node == nullptr){
+                    continue;
+                }
+                const Key& key = keys[base + i];
+                if(node->getKey() == key){
+                    out[base + i] = iterator(node);
+                    cursor[i] = nullptr;
+                    active--;
+                    continue;
+                }
+                node = (node->getKey() < key) ? node->getRight() : node->getLeft();
+                if(node == nullptr){
+                    active--;
+                }
+                else{
+                    BST_PREFETCH(node);
+                }
+                cursor[i] = node;
+            }
+        }
+    }
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
@@ -478,33 +639,25 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 template<class Key, class Value>
 void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
 {
+    BST_STAT_TIMER(TREE_INSERT);
     // if tree is empty, insert node at top
     if(this->empty()){
         Node<Key, Value>* initialNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, NULL);
         root_ = initialNode;
+        size_++;
+        maxSize_ = std::max(maxSize_, size_);
     }
-    // if key already exists in tree, override current value
-    else if(internalFind(keyValuePair.first) != nullptr) {
-        Node<Key, Value>* changedNode = internalFind(keyValuePair.first);
-        changedNode->setValue(keyValuePair.second);
-    }
-
     // walk down tree until find place to insert
     else{
-        Node<Key, Value>* temp = this->root_;
-        // parent of temp
+        // parent of the new node
         Node<Key, Value>* tempParent = nullptr;
-        // while loop to loop through until temp becomes nullptr
-        while(temp != nullptr){
-            // if greater than root_, move right
-            tempParent = temp;
-            if(temp->getKey() < keyValuePair.first){
-                temp = temp->getRight();
-            }
-            // else move left
-            else if(temp->getKey() > keyValuePair.first){
-                temp = temp->getLeft();
-            }
+        // depth of the new node, in edges
+        size_t depth = 0;
+        Node<Key, Value>* existing = descend(keyValuePair.first, tempParent, depth);
+        // if key already exists in tree, override current value
+        if(existing != nullptr){
+            existing->setValue(keyValuePair.second);
+            return;
         }
         
         Node<Key, Value>* addedNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, tempParent);
@@ -516,7 +669,14 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
         else if(tempParent->getKey() > keyValuePair.first){
             tempParent->setLeft(addedNode);
         }
+        size_++;
+        maxSize_ = std::max(maxSize_, size_);
 
+        // in scapegoat mode, a node deeper than log base 1/alpha of the
+        // size means some ancestor is out of weight balance
+        if(scapegoatAlpha_ > 0 && depth > std::log(static_cast<double>(size_)) / scapegoatLogBase_){
+            rebuildAfterInsert(addedNode);
+        }
     }
 }
 
@@ -529,11 +689,14 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::remove(const Key& key)
 {
+    BST_STAT_TIMER(TREE_REMOVE);
     // curr is node to be deleted
     Node<Key, Value> *curr = internalFind(key);
     if(curr == nullptr){
         return;
     }
+    uncache(curr);
+    size_--;
     // node has two children
     if(curr->getLeft() != nullptr && curr->getRight() != nullptr){  
         // find predecessor, swap two nodes
@@ -548,7 +711,6 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         if(curr->getParent() == nullptr){
             delete curr;
             root_ = nullptr;
-            return;
         }
         // else, node is not root node
         else{
@@ -558,7 +720,6 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
                 curr->getParent()->setLeft(nullptr);
                 // delete curr
                 delete curr;
-                return;
             }
             // else, node is right node, set parent's right node to nullptr
             else{
@@ -566,8 +727,6 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
                 curr->getParent()->setRight(nullptr);
                 // delete node
                 delete curr;
-                return;
-
             }
         }
     }
@@ -588,7 +747,6 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
             temp->setParent(nullptr);
             delete curr;
             root_ = temp;
-            return;
         }
         // else, node is non root node
         else{
@@ -602,9 +760,17 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
                 curr->getParent()->setRight(temp);
             }
             delete curr;
-            return;
         }   
     }
+
+    // in scapegoat mode, rebuild the whole tree once it has shrunk below
+    // alpha times its size at the last full rebuild
+    if(scapegoatAlpha_ > 0 && size_ < scapegoatAlpha_ * maxSize_){
+        if(root_ != nullptr){
+            rebuildSubtree(root_, size_);
+        }
+        maxSize_ = size_;
+    }
 }
 
 
@@ -617,8 +783,8 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* cu
     // if left child doesnt exist, walk up ancestor chain until a right child is found, then that parent is the pred
     if(temp->getLeft() == nullptr){
         Node<Key, Value>* par_curr = temp->getParent();
-        // loop until par_curr is the parent of a right node. 
-        while(par_curr->getRight() != temp){
+        // loop until par_curr is the parent of a right node (NULL if current is the smallest)
+        while(par_curr != nullptr && par_curr->getRight() != temp){
             temp = par_curr;
             par_curr = par_curr->getParent();
         }
@@ -638,13 +804,15 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* cu
 template<class Key, class Value>
 Node<Key, Value>* BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current){
     // next biggest value in the tree
-    // if right child doesnt exist, walk up ancestor chain until a left child is found, then that parent is the pred
+    // if right child doesnt exist, walk up ancestor chain until current is a left child, then that parent is the succ
     if(current->getRight() == nullptr){
-        // loop until current is the parent of a left node
-        current = current->getParent(); 
-        while(current->getParent() != nullptr && current->getParent()->getRight() == current){
-            current = current->getParent();
+        Node<Key, Value>* parent = current->getParent();
+        // loop until current is the left child of parent (NULL if current is the largest)
+        while(parent != nullptr && parent->getRight() == current){
+            current = parent;
+            parent = parent->getParent();
         }
+        current = parent;
     }
     // right child exists, find left most node
     else if(current->getRight() != nullptr){
@@ -673,6 +841,385 @@ void BinarySearchTree<Key, Value>::clear()
 }
 
 
+/**
+* Writes the tree to os in the binary snapshot format described in
+* bst_serialize.h. Items are streamed in key order straight from the
+* nodes, so no copy of the tree is made. Only the entries the liveness
+* hooks accept are written, and the tree is left as it was.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::save(std::ostream& os) const
+{
+    uint64_t stamp = liveStamp();
+    uint64_t count = liveCount(stamp);
+    uint32_t version = BST_SNAPSHOT_VERSION;
+    uint32_t reserved = 0;
+    snapshotWrite(os, "BSTSNAP", 8);
+    snapshotWrite(os, &version, sizeof(version));
+    snapshotWrite(os, &reserved, sizeof(reserved));
+    snapshotWrite(os, &count, sizeof(count));
+    for(Node<Key, Value>* node = getSmallestNode(); node != nullptr; node = successor(node)){
+        if(isLive(node, stamp)){
+            SnapshotCodec<Key>::write(os, node->getKey());
+            SnapshotCodec<Value>::write(os, node->getValue());
+        }
+    }
+    if(!os){
+        throw std::runtime_error("Failed to write tree snapshot");
+    }
+}
+
+// by default every node is live
+template<typename Key, typename Value>
+uint64_t BinarySearchTree<Key, Value>::liveStamp() const
+{
+    return 0;
+}
+
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::liveCount(uint64_t stamp) const
+{
+    return size_;
+}
+
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::isLive(const Node<Key, Value>* node, uint64_t stamp) const
+{
+    return true;
+}
+
+/**
+* Replaces the contents of the tree with a snapshot written by save().
+* Since records arrive in key order, the tree is built directly in
+* perfectly balanced shape in O(n), reading one record at a time, so
+* memory use beyond the nodes themselves is O(log n).
+* Throws std::runtime_error on a malformed or truncated snapshot, in
+* which case the tree is left empty.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::load(std::istream& is)
+{
+    clear();
+    loadSnapshot(is);
+}
+
+/**
+* Reads a snapshot into the tree, which must already be empty. This is
+* load() without the clear(), for subclasses that empty the tree their
+* own way.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::loadSnapshot(std::istream& is)
+{
+    char magic[8];
+    uint32_t version = 0;
+    uint32_t reserved = 0;
+    uint64_t count = 0;
+    snapshotRead(is, magic, sizeof(magic));
+    snapshotRead(is, &version, sizeof(version));
+    snapshotRead(is, &reserved, sizeof(reserved));
+    snapshotRead(is, &count, sizeof(count));
+    if(std::string(magic, 8) != std::string("BSTSNAP", 8) || version != BST_SNAPSHOT_VERSION){
+        throw std::runtime_error("Not a tree snapshot");
+    }
+    int height = 0;
+    root_ = buildFromStream(is, count, nullptr, height);
+    size_ = count;
+    maxSize_ = count;
+}
+
+/**
+* Builds a balanced subtree out of the next count records of is and
+* returns its root. The left subtree is never larger than the right,
+* so height is only ever grown on the right.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::buildFromStream(std::istream& is, uint64_t count, Node<Key, Value>* parent, int& height)
+{
+    if(count == 0){
+        height = 0;
+        return nullptr;
+    }
+    uint64_t leftCount = (count - 1) / 2;
+    int leftHeight = 0;
+    int rightHeight = 0;
+    Node<Key, Value>* left = buildFromStream(is, leftCount, nullptr, leftHeight);
+    Node<Key, Value>* node = nullptr;
+    try{
+        Key key = SnapshotCodec<Key>::read(is);
+        Value value = SnapshotCodec<Value>::read(is);
+        node = createNode(key, value, parent);
+    }
+    catch(...){
+        destroySubtree(left);
+        throw;
+    }
+    node->setLeft(left);
+    if(left != nullptr){
+        left->setParent(node);
+    }
+    try{
+        node->setRight(buildFromStream(is, count - 1 - leftCount, node, rightHeight));
+    }
+    catch(...){
+        destroySubtree(node);
+        throw;
+    }
+    finishBuiltNode(node, leftHeight, rightHeight);
+    height = 1 + std::max(leftHeight, rightHeight);
+    return node;
+}
+
+/**
+* Frees every node under root without any rebalancing.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::destroySubtree(Node<Key, Value>* root)
+{
+    if(root == nullptr){
+        return;
+    }
+    destroySubtree(root->getLeft());
+    destroySubtree(root->getRight());
+    delete root;
+}
+
+/**
+* Wraps a node in an iterator; the iterator constructor is only visible
+* to BinarySearchTree itself.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::makeIterator(Node<Key, Value>* node)
+{
+    return iterator(node);
+}
+
+/**
+* Returns the node an iterator points at (NULL for end()).
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::iteratorNode(const iterator& it)
+{
+    return it.current_;
+}
+
+/**
+* Puts a direct-mapped cache of the given number of slots (rounded up to
+* a power of two) in front of every lookup, so that repeated lookups of
+* hot keys skip the descent. 0 removes the cache. Key must have a
+* std::hash specialization. While the cache is enabled lookups write to
+* it, so concurrent readers need the same locking as writers.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableLookupCache(size_t slots)
+{
+    delete cache_;
+    cache_ = nullptr;
+    if(slots > 0){
+        cache_ = new LookupCache<Key, Value>(slots);
+    }
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::uncache(Node<Key, Value>* node)
+{
+    if(cache_ != nullptr){
+        cache_->forget(node);
+    }
+}
+
+/**
+* Turns on scapegoat mode: insert and remove keep track of the tree size,
+* and whenever an insert lands deeper than log base 1/alpha of the size,
+* the subtree rooted at the lowest ancestor that is out of alpha weight
+* balance (one child holding more than alpha of its nodes) is rebuilt
+* into perfect balance. A full rebuild also runs once removes have shrunk
+* the tree below alpha times its size at the last one. Lookups and
+* updates then cost amortized O(log n) with no per-node balance field.
+*
+* alpha must lie in [0.5, 1); smaller values rebuild more often and keep
+* the tree shallower. 0 turns the mode off. The current tree is rebuilt
+* straight away, so a tree that has already degenerated is repaired.
+* Only BinarySearchTree's own insert and remove take part, which is why
+* this is protected: ScapegoatBST exposes it, while AVLTree and the other
+* trees that override them keep their own balancing and never turn it on.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableScapegoat(double alpha)
+{
+    if(alpha != 0 && (alpha < 0.5 || alpha >= 1)){
+        throw std::invalid_argument("Scapegoat alpha must be in [0.5, 1)");
+    }
+    scapegoatAlpha_ = alpha;
+    scapegoatLogBase_ = alpha == 0 ? 0 : -std::log(alpha);
+    if(alpha == 0){
+        return;
+    }
+    size_ = 0;
+    for(iterator it = begin(); it != end(); ++it){
+        size_++;
+    }
+    maxSize_ = size_;
+    if(root_ != nullptr){
+        rebuildSubtree(root_, size_);
+    }
+}
+
+/**
+* Number of nodes under root.
+*/
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::subtreeSize(Node<Key, Value>* root)
+{
+    if(root == nullptr){
+        return 0;
+    }
+    return 1 + subtreeSize(root->getLeft()) + subtreeSize(root->getRight());
+}
+
+/**
+* Rebuilds the count nodes under root into a perfectly balanced subtree
+* in place, with the Day-Stout-Warren algorithm: rotations first flatten
+* the subtree into a right-leaning vine, then repeated left-rotation
+* passes fold the vine back into a tree whose levels are all full except
+* the last. O(count) time and no allocation. Nodes keep their identity,
+* so iterators and cached nodes stay valid.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebuildSubtree(Node<Key, Value>* root, size_t count)
+{
+    Node<Key, Value>* parent = root->getParent();
+    bool leftChild = parent != nullptr && parent->getLeft() == root;
+
+    // flatten into a vine along right links; head is the vine's first
+    // node and tail the last one already free of left children
+    Node<Key, Value>* head = root;
+    Node<Key, Value>* tail = nullptr;
+    Node<Key, Value>* rest = root;
+    while(rest != nullptr){
+        Node<Key, Value>* left = rest->getLeft();
+        if(left == nullptr){
+            tail = rest;
+            rest = rest->getRight();
+        }
+        else{
+            rest->setLeft(left->getRight());
+            left->setRight(rest);
+            rest = left;
+            if(tail == nullptr){
+                head = left;
+            }
+            else{
+                tail->setRight(left);
+            }
+        }
+    }
+
+    // fold the vine: the first pass places the leaves of the incomplete
+    // bottom level, then each pass halves the length of the spine
+    size_t full = 1;
+    while(full * 2 + 1 <= count){
+        full = full * 2 + 1;
+    }
+    size_t folds = count - full;
+    size_t spine = full;
+    while(true){
+        Node<Key, Value>* scanner = nullptr;
+        for(size_t i = 0; i < folds; ++i){
+            Node<Key, Value>* child = scanner == nullptr ? head : scanner->getRight();
+            Node<Key, Value>* next = child->getRight();
+            if(scanner == nullptr){
+                head = next;
+            }
+            else{
+                scanner->setRight(next);
+            }
+            child->setRight(next->getLeft());
+            next->setLeft(child);
+            scanner = next;
+        }
+        if(spine <= 1){
+            break;
+        }
+        spine /= 2;
+        folds = spine;
+    }
+
+    // rotations above only moved left and right links
+    head->setParent(parent);
+    relinkParents(head);
+    if(parent == nullptr){
+        root_ = head;
+    }
+    else if(leftChild){
+        parent->setLeft(head);
+    }
+    else{
+        parent->setRight(head);
+    }
+}
+
+/**
+* Points the parent link of every node under root at its actual parent.
+* Only used on freshly rebuilt subtrees, so the recursion is O(log n) deep.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::relinkParents(Node<Key, Value>* root)
+{
+    if(root->getLeft() != nullptr){
+        root->getLeft()->setParent(root);
+        relinkParents(root->getLeft());
+    }
+    if(root->getRight() != nullptr){
+        root->getRight()->setParent(root);
+        relinkParents(root->getRight());
+    }
+}
+
+/**
+* Walks up from a node inserted too deep to the first ancestor that is
+* out of alpha weight balance and rebuilds its subtree. Sizes are counted
+* on the way up, which is paid for by the nodes the rebuild touches.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebuildAfterInsert(Node<Key, Value>* added)
+{
+    Node<Key, Value>* child = added;
+    size_t childSize = 1;
+    while(child->getParent() != nullptr){
+        Node<Key, Value>* parent = child->getParent();
+        Node<Key, Value>* sibling = parent->getLeft() == child ? parent->getRight() : parent->getLeft();
+        size_t parentSize = childSize + 1 + subtreeSize(sibling);
+        if(childSize > scapegoatAlpha_ * parentSize){
+            rebuildSubtree(parent, parentSize);
+            return;
+        }
+        child = parent;
+        childSize = parentSize;
+    }
+    rebuildSubtree(root_, childSize);
+}
+
+/**
+* Allocates a node of the type this tree uses.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new Node<Key, Value>(key, value, parent);
+}
+
+/**
+* Called by buildFromStream once both subtrees of node are linked, so
+* that trees can fill in per-node bookkeeping such as AVL balances.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::finishBuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+
+}
+
 /**
 * A helper function to find the smallest node in the tree.
 */
@@ -709,19 +1256,72 @@ template<typename Key, typename Value>
 Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
 {
     // TODO
+    BST_STAT_ADD(TREE_FIND_CALLS, 1);
+    if(cache_ != nullptr){
+        Node<Key, Value>* cached = cache_->lookup(key);
+        if(cached != nullptr){
+            BST_STAT_ADD(TREE_CACHE_HITS, 1);
+            return cached;
+        }
+        BST_STAT_ADD(TREE_CACHE_MISSES, 1);
+    }
+    Node<Key, Value>* parent;
+    size_t depth;
+    Node<Key, Value>* found = descend(key, parent, depth);
+    BST_STAT_ADD(TREE_FIND_PATH, depth);
+    if(found != nullptr && cache_ != nullptr){
+        cache_->store(key, found);
+    }
+    return found;
+}
+
+/**
+* Walks down from the root towards key. Returns the node holding key, or
+* NULL with parent set to the last node passed, the one a new node for
+* key hangs off. depth is the number of nodes visited.
+* See BranchlessDescent for the two flavours of the walk.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::descend(const Key& key, Node<Key, Value>*& parent, size_t& depth) const
+{
     Node<Key, Value>* temp = this->root_;
+    parent = nullptr;
+    depth = 0;
+    if(BranchlessDescent<Key>::value){
+        // the last node whose key is not smaller than key; if any node
+        // holds key, it is this one
+        Node<Key, Value>* candidate = nullptr;
+        while(temp != nullptr){
+            BST_STAT_ADD(TREE_COMPARISONS, 1);
+            bool right = temp->getKey() < key;
+            candidate = branchlessSelect(right, candidate, temp);
+            parent = temp;
+            depth++;
+            temp = temp->getChild(right);
+        }
+        BST_STAT_ADD(TREE_COMPARISONS, 1);
+        if(candidate != nullptr && !(key < candidate->getKey())){
+            return candidate;
+        }
+        return nullptr;
+    }
     // while temp is not nullptr
     while(temp != nullptr){
+        depth++;
         // if key is leaf node, then value was not found, return nullptr
         if(temp->getKey() == key){
+            BST_STAT_ADD(TREE_COMPARISONS, 1);
             return temp;
         }
+        parent = temp;
         // if key is greater than value at temp, go right 
         if(key > temp->getKey()){
+            BST_STAT_ADD(TREE_COMPARISONS, 2);
             temp = temp->getRight();
         }
         // else if, go left
         else if(key < temp->getKey()){
+            BST_STAT_ADD(TREE_COMPARISONS, 3);
             temp = temp->getLeft();
         }
     }
@@ -739,6 +1339,42 @@ bool BinarySearchTree<Key, Value>::isBalanced() const
 
 }
 
+/**
+* Node count, leaf depths and height of the tree in one iterative pass,
+* see tree_shape.h. threads > 1 splits the walk over subtrees.
+*/
+template<typename Key, typename Value>
+TreeShape BinarySearchTree<Key, Value>::shape(unsigned threads) const
+{
+    return treeShape<GetterLinks>(root_, threads);
+}
+
+/**
+* Streams the whole tree to os as DOT or JSON lines in O(n) time and
+* constant memory, see tree_export.h. Unlike print(), there is no limit
+* on the depth or size of the tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::exportTree(std::ostream& os, const TreeExportOptions& options) const
+{
+    exportTreeNodes<Node<Key, Value> >(os, root_, options);
+}
+
+/**
+* Like exportTree(), but only the subtree rooted at key; depths are
+* counted from that node. Throws std::out_of_range if key is not in the
+* tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::exportSubtree(std::ostream& os, const Key& key, const TreeExportOptions& options) const
+{
+    Node<Key, Value>* focus = internalFind(key);
+    if(focus == nullptr){
+        throw std::out_of_range("Invalid key");
+    }
+    exportTreeNodes<Node<Key, Value> >(os, focus, options);
+}
+
 template<typename Key, typename Value>
 bool BinarySearchTree<Key, Value>::balanceHelper(Node<Key, Value>* node) const {
     if(node == nullptr){
@@ -779,6 +1415,7 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
     }
+    BST_STAT_ADD(TREE_NODE_SWAPS, 1);
     Node<Key, Value>* n1p = n1->getParent();
     Node<Key, Value>* n1r = n1->getRight();
     Node<Key, Value>* n1lt = n1->getLeft();
@@ -857,6 +1494,130 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 
 }
 
+/**
+* Rotations shared by the balanced trees built on BinarySearchTree.
+* They only relink nodes; balance bookkeeping is left to the caller.
+*/
+
+// rotate right
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rotateRight(Node<Key,Value>* node){
+    BST_STAT_ADD(TREE_ROTATE_RIGHT, 1);
+    Node<Key,Value>* parent = node->getParent();
+    Node<Key,Value>* leftChild = node->getLeft();
+
+    bool isLeftNode;
+    
+
+    // check for right child existence 
+    Node<Key,Value>* rightChild = nullptr;
+    if(leftChild->getRight() != nullptr){
+        // store right child
+        rightChild = leftChild->getRight();
+        leftChild->setRight(nullptr);
+    }
+
+    // if node is root, rotate accordingly
+    if(parent == nullptr){
+
+        this->root_ = leftChild;
+        node->setParent(leftChild);
+        leftChild->setRight(node);
+        leftChild->setParent(nullptr);
+    }
+
+    // else,rotate accordingly
+    else{
+        if(parent->getLeft() == node){
+            isLeftNode = true;
+        }
+        else{
+            isLeftNode = false;
+        }
+
+        // if node is right child
+        if(isLeftNode){
+            parent->setLeft(leftChild);
+        }
+        // else, node is left child
+        else{
+            parent->setRight(leftChild);
+        }
+        leftChild->setParent(parent);
+        node->setParent(leftChild);
+        leftChild->setRight(node);
+    }
+
+    // if right child doesnt exist
+    if(rightChild == nullptr){
+        node->setLeft(nullptr);
+    }
+    // if left child exists
+    else{
+        node->setLeft(rightChild);
+        rightChild->setParent(node);
+    }
+}
+
+// rotate left
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rotateLeft(Node<Key,Value>* node){
+    BST_STAT_ADD(TREE_ROTATE_LEFT, 1);
+    Node<Key,Value>* parent = node->getParent();
+    Node<Key,Value>* rightChild = node->getRight();
+
+    bool isRightNode;
+    
+
+
+    // check for left child existence 
+    Node<Key,Value>* leftChild = nullptr;
+    
+    if(rightChild->getLeft() != nullptr){
+        // store left child
+        leftChild = rightChild->getLeft();
+        rightChild->setLeft(nullptr);
+    }
+    // if node is root, rotate accordingly
+    if(parent == nullptr){
+        this->root_ = rightChild;
+        node->setParent(rightChild);
+        rightChild->setLeft(node);
+        rightChild->setParent(nullptr);
+    }
+    // else, rotate accordingly
+    else{
+        if(parent->getRight() == node){
+            isRightNode = true;
+        }
+        else{
+            isRightNode = false;
+        }
+        // if node is right child
+        if(isRightNode){
+            parent->setRight(rightChild);
+        }
+        // else, node is left child
+        else{
+            parent->setLeft(rightChild);
+        }
+        rightChild->setParent(parent);
+        node->setParent(rightChild);
+        rightChild->setLeft(node);
+    }
+
+    // if left child doesnt exist
+    if(leftChild == nullptr){
+        node->setRight(nullptr);
+    }
+    // if right child exists
+    else{
+        node->setRight(leftChild);
+        leftChild->setParent(node);
+    }
+}
+
+
 /**
  * Lastly, we are providing you with a print function,
    BinarySearchTree::printRoot().
@@ -877,4 +1638,27 @@ End implementations for the BinarySearchTree class.
 ---------------------------------------------------
 */
 
+/**
+* A BinarySearchTree kept in scapegoat mode: no balance data in the
+* nodes, and depth at most log base 1/alpha of the size plus one right
+* after every insert. See BinarySearchTree::enableScapegoat().
+*/
+template <typename Key, typename Value>
+class ScapegoatBST : public BinarySearchTree<Key, Value>
+{
+public:
+    explicit ScapegoatBST(double alpha = 0.7);
+
+    using BinarySearchTree<Key, Value>::enableScapegoat;
+};
+
+template<typename Key, typename Value>
+ScapegoatBST<Key, Value>::ScapegoatBST(double alpha)
+{
+    if(alpha == 0){
+        throw std::invalid_argument("Scapegoat alpha must be in [0.5, 1)");
+    }
+    this->enableScapegoat(alpha);
+}
+
 #endif
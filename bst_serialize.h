@@ -0,0 +1,97 @@
+#ifndef BST_SERIALIZE_H
+#define BST_SERIALIZE_H
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+
+// Binary snapshot format used by BinarySearchTree::save()/load()
+// Version 1
+//
+//   header:  "BSTSNAP" '\0'   8 bytes
+//            version          uint32
+//            reserved         uint32
+//            record count     uint64
+//   records: one per item, in key order
+//            key length       uint32, then that many key bytes
+//            value length     uint32, then that many value bytes
+//
+// Integers are written in host byte order.
+
+#define BST_SNAPSHOT_VERSION 1
+
+/**
+* Reads exactly len bytes or throws, so a truncated snapshot can never be
+* mistaken for a shorter one.
+*/
+inline void snapshotRead(std::istream& is, void* dest, size_t len)
+{
+    is.read(static_cast<char*>(dest), static_cast<std::streamsize>(len));
+    if(static_cast<size_t>(is.gcount()) != len){
+        throw std::runtime_error("Truncated tree snapshot");
+    }
+}
+
+inline void snapshotWrite(std::ostream& os, const void* src, size_t len)
+{
+    os.write(static_cast<const char*>(src), static_cast<std::streamsize>(len));
+}
+
+/**
+* Writes and reads one length-prefixed field of a snapshot record.
+* The primary template handles trivially copyable types by copying
+* their bytes straight from/to the object, with no intermediate buffer.
+* Specialize SnapshotCodec for any other key or value type.
+*/
+template <typename T, bool Trivial = std::is_trivially_copyable<T>::value>
+struct SnapshotCodec;
+
+template <typename T>
+struct SnapshotCodec<T, true>
+{
+    static void write(std::ostream& os, const T& item)
+    {
+        uint32_t len = sizeof(T);
+        snapshotWrite(os, &len, sizeof(len));
+        snapshotWrite(os, &item, sizeof(T));
+    }
+
+    static T read(std::istream& is)
+    {
+        uint32_t len = 0;
+        snapshotRead(is, &len, sizeof(len));
+        if(len != sizeof(T)){
+            throw std::runtime_error("Tree snapshot field has the wrong size");
+        }
+        // raw storage, so T needs no default constructor
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type item;
+        snapshotRead(is, &item, sizeof(T));
+        return *reinterpret_cast<T*>(&item);
+    }
+};
+
+template <>
+struct SnapshotCodec<std::string, false>
+{
+    static void write(std::ostream& os, const std::string& item)
+    {
+        uint32_t len = static_cast<uint32_t>(item.size());
+        snapshotWrite(os, &len, sizeof(len));
+        snapshotWrite(os, item.data(), item.size());
+    }
+
+    static std::string read(std::istream& is)
+    {
+        uint32_t len = 0;
+        snapshotRead(is, &len, sizeof(len));
+        std::string item(len, '\0');
+        if(len > 0){
+            snapshotRead(is, &item[0], len);
+        }
+        return item;
+    }
+};
+
+#endif
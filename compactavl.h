@@ -0,0 +1,1135 @@
+#ifndef COMPACTAVL_H
+#define COMPACTAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <vector>
+#include "avl_rebalance.h"
+#include "lookup_task.h"
+
+/**
+* A node for the compact AVL tree. Unlike Node/AVLNode in bst.h and avlbst.h,
+* a CompactAVLNode has no virtual functions and links to its parent and children
+* with 32-bit indices into the tree's node arena instead of pointers. On 64-bit
+* builds this cuts the link overhead from 24 bytes (plus the vtable pointer) to
+* 12 bytes, and since no node stores an address the whole arena can be moved
+* or copied as a block.
+*/
+template <typename Key, typename Value>
+class CompactAVLNode
+{
+public:
+    // Index used in place of a null pointer.
+    static const uint32_t npos = 0xFFFFFFFFu;
+
+    CompactAVLNode(const Key& key, const Value& value, uint32_t parent);
+
+    const std::pair<const Key, Value>& getItem() const;
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Value& getValue();
+    void setValue(const Value& value);
+
+    uint32_t getParent() const;
+    uint32_t getLeft() const;
+    uint32_t getRight() const;
+    void setParent(uint32_t parent);
+    void setLeft(uint32_t left);
+    void setRight(uint32_t right);
+
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+
+protected:
+    std::pair<const Key, Value> item_;
+    uint32_t parent_;
+    uint32_t left_;
+    uint32_t right_;
+    int8_t balance_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the CompactAVLNode class.
+  -------------------------------------------------
+*/
+
+template<typename Key, typename Value>
+const uint32_t CompactAVLNode<Key, Value>::npos;
+
+/**
+* Explicit constructor for a node. New nodes are always leaves.
+*/
+template<typename Key, typename Value>
+CompactAVLNode<Key, Value>::CompactAVLNode(const Key& key, const Value& value, uint32_t parent) :
+    item_(key, value),
+    parent_(parent),
+    left_(npos),
+    right_(npos),
+    balance_(0)
+{
+
+}
+
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& CompactAVLNode<Key, Value>::getItem() const
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& CompactAVLNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+const Key& CompactAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+template<typename Key, typename Value>
+const Value& CompactAVLNode<Key, Value>::getValue() const
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+Value& CompactAVLNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+template<typename Key, typename Value>
+void CompactAVLNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+template<typename Key, typename Value>
+uint32_t CompactAVLNode<Key, Value>::getParent() const
+{
+    return parent_;
+}
+
+template<typename Key, typename Value>
+uint32_t CompactAVLNode<Key, Value>::getLeft() const
+{
+    return left_;
+}
+
+template<typename Key, typename Value>
+uint32_t CompactAVLNode<Key, Value>::getRight() const
+{
+    return right_;
+}
+
+template<typename Key, typename Value>
+void CompactAVLNode<Key, Value>::setParent(uint32_t parent)
+{
+    parent_ = parent;
+}
+
+template<typename Key, typename Value>
+void CompactAVLNode<Key, Value>::setLeft(uint32_t left)
+{
+    left_ = left;
+}
+
+template<typename Key, typename Value>
+void CompactAVLNode<Key, Value>::setRight(uint32_t right)
+{
+    right_ = right;
+}
+
+template<typename Key, typename Value>
+int8_t CompactAVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+template<typename Key, typename Value>
+void CompactAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the CompactAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A contiguous, growable block of nodes addressed by 32-bit index.
+* Slots [0, size()) are always live, so erasing a slot moves the last
+* node into the hole and reports where it came from; the owner is
+* responsible for repointing links at the moved node.
+*
+* The arena also records the index of the tree's root. This is the
+* interface CompactAVLTree expects of its Arena parameter; see
+* MappedArena in mappedavl.h for a file-backed implementation.
+*/
+template <typename T>
+class NodeArena
+{
+public:
+    NodeArena();
+    ~NodeArena();
+
+    uint32_t size() const;
+    uint32_t capacity() const;
+    void reserve(uint32_t capacity);
+    void clear();
+
+    uint32_t getRoot() const;
+    void setRoot(uint32_t root);
+
+    T& operator[](uint32_t index);
+    const T& operator[](uint32_t index) const;
+
+    template<typename... Args>
+    uint32_t emplace(Args&&... args);
+    uint32_t erase(uint32_t index);
+    void permute(const std::vector<uint32_t>& order);
+
+private:
+    NodeArena(const NodeArena&);
+    NodeArena& operator=(const NodeArena&);
+
+    T* data_;
+    uint32_t size_;
+    uint32_t capacity_;
+    uint32_t root_;
+};
+
+/*
+  -------------------------------------------
+  Begin implementations for the NodeArena class.
+  -------------------------------------------
+*/
+
+template<typename T>
+NodeArena<T>::NodeArena() :
+    data_(nullptr),
+    size_(0),
+    capacity_(0),
+    root_(0xFFFFFFFFu)
+{
+
+}
+
+template<typename T>
+NodeArena<T>::~NodeArena()
+{
+    clear();
+    ::operator delete(data_);
+}
+
+template<typename T>
+uint32_t NodeArena<T>::size() const
+{
+    return size_;
+}
+
+template<typename T>
+uint32_t NodeArena<T>::capacity() const
+{
+    return capacity_;
+}
+
+/**
+* Grows the arena to hold at least capacity nodes. Nodes are moved
+* one at a time rather than memcpy'd so that keys and values which
+* point into themselves (e.g. small std::strings) stay valid.
+*/
+template<typename T>
+void NodeArena<T>::reserve(uint32_t capacity)
+{
+    if(capacity <= capacity_){
+        return;
+    }
+    T* grown = static_cast<T*>(::operator new(sizeof(T) * static_cast<size_t>(capacity)));
+    for(uint32_t i = 0; i < size_; ++i){
+        new (grown + i) T(std::move(data_[i]));
+        data_[i].~T();
+    }
+    ::operator delete(data_);
+    data_ = grown;
+    capacity_ = capacity;
+}
+
+template<typename T>
+void NodeArena<T>::clear()
+{
+    for(uint32_t i = 0; i < size_; ++i){
+        data_[i].~T();
+    }
+    size_ = 0;
+    root_ = 0xFFFFFFFFu;
+}
+
+template<typename T>
+uint32_t NodeArena<T>::getRoot() const
+{
+    return root_;
+}
+
+template<typename T>
+void NodeArena<T>::setRoot(uint32_t root)
+{
+    root_ = root;
+}
+
+template<typename T>
+T& NodeArena<T>::operator[](uint32_t index)
+{
+    return data_[index];
+}
+
+template<typename T>
+const T& NodeArena<T>::operator[](uint32_t index) const
+{
+    return data_[index];
+}
+
+/**
+* Constructs a new node at the end of the arena and returns its index.
+*/
+template<typename T>
+template<typename... Args>
+uint32_t NodeArena<T>::emplace(Args&&... args)
+{
+    // the all-ones index is reserved to mean "no node"
+    if(size_ == 0xFFFFFFFEu){
+        throw std::length_error("NodeArena is full");
+    }
+    if(size_ == capacity_){
+        uint32_t grown = capacity_ < 8 ? 8 : capacity_ + capacity_ / 2;
+        if(grown < capacity_ || grown > 0xFFFFFFFEu){
+            grown = 0xFFFFFFFEu;
+        }
+        reserve(grown);
+    }
+    new (data_ + size_) T(std::forward<Args>(args)...);
+    return size_++;
+}
+
+/**
+* Destroys the node at index and fills the hole with the last node.
+* Returns the index the moved node used to live at, which equals
+* index when the erased node was the last one.
+*/
+template<typename T>
+uint32_t NodeArena<T>::erase(uint32_t index)
+{
+    uint32_t last = size_ - 1;
+    data_[index].~T();
+    if(index != last){
+        new (data_ + index) T(std::move(data_[last]));
+        data_[last].~T();
+    }
+    size_--;
+    return last;
+}
+
+/**
+* Rearranges the nodes so that slot i holds what was in slot order[i].
+* order must be a permutation of [0, size()).
+*/
+template<typename T>
+void NodeArena<T>::permute(const std::vector<uint32_t>& order)
+{
+    if(size_ == 0){
+        return;
+    }
+    T* arranged = static_cast<T*>(::operator new(sizeof(T) * static_cast<size_t>(capacity_)));
+    for(uint32_t i = 0; i < size_; ++i){
+        new (arranged + i) T(std::move(data_[order[i]]));
+    }
+    for(uint32_t i = 0; i < size_; ++i){
+        data_[i].~T();
+    }
+    ::operator delete(data_);
+    data_ = arranged;
+}
+
+/*
+  -----------------------------------------
+  End implementations for the NodeArena class.
+  -----------------------------------------
+*/
+
+/**
+* An AVL tree with the same public interface as AVLTree, but whose nodes
+* live contiguously in an arena (a NodeArena by default) and link to each
+* other by 32-bit index. Holds at most 2^32 - 2 entries. Rebalancing is
+* the one AVLTree uses (avl_rebalance.h), applied to indices.
+*
+* Because remove() keeps the arena dense by moving the last node into the
+* freed slot, any mutation invalidates outstanding iterators.
+*/
+template <typename Key, typename Value, typename Arena = NodeArena<CompactAVLNode<Key, Value> > >
+class CompactAVLTree
+{
+public:
+    typedef CompactAVLNode<Key, Value> NodeType;
+    static const uint32_t npos = NodeType::npos;
+
+    CompactAVLTree();
+    virtual ~CompactAVLTree();
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+    size_t size() const;
+    void reserve(size_t n);
+    void relayout();
+
+public:
+    /**
+    * An iterator over the tree in key order. Stores the tree and a node
+    * index rather than a node pointer, since the arena may reallocate.
+    * Items are read-only and read through the const arena, so iterating
+    * never counts as a change (see MappedArena); use insert() or
+    * operator[] to update a value.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        const std::pair<const Key,Value>& operator*() const;
+        const std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class CompactAVLTree<Key, Value, Arena>;
+        iterator(const CompactAVLTree<Key, Value, Arena>* tree, uint32_t index);
+        const CompactAVLTree<Key, Value, Arena>* tree_;
+        uint32_t current_;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+#if defined(__cpp_impl_coroutine)
+    template <class Pager>
+    LookupTask<iterator> findAsync(Key key, LookupScheduler& scheduler, Pager& pager) const;
+    LookupTask<iterator> findAsync(Key key, LookupScheduler& scheduler) const;
+#endif
+
+protected:
+    NodeType& node(uint32_t index);
+    const NodeType& node(uint32_t index) const;
+
+    uint32_t internalFind(const Key& key) const;
+    uint32_t getSmallestNode() const;
+    uint32_t predecessor(uint32_t current) const;
+    uint32_t successor(uint32_t current) const;
+
+    struct Links;
+    void insertFix(uint32_t parent, uint32_t child);
+    void removeFix(uint32_t current, int diff);
+    void rotateLeft(uint32_t current);
+    void rotateRight(uint32_t current);
+    void replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild);
+    void nodeSwap(uint32_t n1, uint32_t n2);
+    void releaseNode(uint32_t index);
+    void vanEmdeBoasOrder(uint32_t root, int height, std::vector<uint32_t>& order) const;
+    void collectAtDepth(uint32_t root, int depth, std::vector<uint32_t>& out) const;
+    int getHeight(uint32_t root) const;
+    bool balanceHelper(uint32_t root, int& height) const;
+
+protected:
+    Arena nodes_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the CompactAVLTree::iterator class.
+--------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Arena>
+const uint32_t CompactAVLTree<Key, Value, Arena>::npos;
+
+template<class Key, class Value, class Arena>
+CompactAVLTree<Key, Value, Arena>::iterator::iterator(const CompactAVLTree<Key, Value, Arena>* tree, uint32_t index) :
+    tree_(tree),
+    current_(index)
+{
+
+}
+
+template<class Key, class Value, class Arena>
+CompactAVLTree<Key, Value, Arena>::iterator::iterator() :
+    tree_(nullptr),
+    current_(npos)
+{
+
+}
+
+template<class Key, class Value, class Arena>
+const std::pair<const Key,Value>&
+CompactAVLTree<Key, Value, Arena>::iterator::operator*() const
+{
+    return tree_->node(current_).getItem();
+}
+
+template<class Key, class Value, class Arena>
+const std::pair<const Key,Value>*
+CompactAVLTree<Key, Value, Arena>::iterator::operator->() const
+{
+    return &(tree_->node(current_).getItem());
+}
+
+/**
+* Two end iterators compare equal regardless of which tree produced them,
+* matching the NULL end iterator of BinarySearchTree.
+*/
+template<class Key, class Value, class Arena>
+bool
+CompactAVLTree<Key, Value, Arena>::iterator::operator==(const iterator& rhs) const
+{
+    if(current_ == npos || rhs.current_ == npos){
+        return current_ == rhs.current_;
+    }
+    return tree_ == rhs.tree_ && current_ == rhs.current_;
+}
+
+template<class Key, class Value, class Arena>
+bool
+CompactAVLTree<Key, Value, Arena>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances the iterator's location using an in-order sequencing
+*/
+template<class Key, class Value, class Arena>
+typename CompactAVLTree<Key, Value, Arena>::iterator&
+CompactAVLTree<Key, Value, Arena>::iterator::operator++()
+{
+    current_ = tree_->successor(current_);
+    return *this;
+}
+
+/*
+------------------------------------------------------------
+End implementations for the CompactAVLTree::iterator class.
+------------------------------------------------------------
+*/
+
+/*
+---------------------------------------------------
+Begin implementations for the CompactAVLTree class.
+---------------------------------------------------
+*/
+
+template<class Key, class Value, class Arena>
+CompactAVLTree<Key, Value, Arena>::CompactAVLTree()
+{
+
+}
+
+template<class Key, class Value, class Arena>
+CompactAVLTree<Key, Value, Arena>::~CompactAVLTree()
+{
+
+}
+
+template<class Key, class Value, class Arena>
+bool CompactAVLTree<Key, Value, Arena>::empty() const
+{
+    return nodes_.getRoot() == npos;
+}
+
+template<class Key, class Value, class Arena>
+size_t CompactAVLTree<Key, Value, Arena>::size() const
+{
+    return nodes_.size();
+}
+
+/**
+* Preallocates room for n entries so bulk inserts do not regrow the arena.
+*/
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::reserve(size_t n)
+{
+    if(n > 0xFFFFFFFEu){
+        throw std::length_error("CompactAVLTree holds at most 2^32 - 2 entries");
+    }
+    nodes_.reserve(static_cast<uint32_t>(n));
+}
+
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::clear()
+{
+    nodes_.clear();
+}
+
+template<class Key, class Value, class Arena>
+typename CompactAVLTree<Key, Value, Arena>::NodeType&
+CompactAVLTree<Key, Value, Arena>::node(uint32_t index)
+{
+    return nodes_[index];
+}
+
+template<class Key, class Value, class Arena>
+const typename CompactAVLTree<Key, Value, Arena>::NodeType&
+CompactAVLTree<Key, Value, Arena>::node(uint32_t index) const
+{
+    return nodes_[index];
+}
+
+template<class Key, class Value, class Arena>
+typename CompactAVLTree<Key, Value, Arena>::iterator
+CompactAVLTree<Key, Value, Arena>::begin() const
+{
+    return iterator(this, getSmallestNode());
+}
+
+template<class Key, class Value, class Arena>
+typename CompactAVLTree<Key, Value, Arena>::iterator
+CompactAVLTree<Key, Value, Arena>::end() const
+{
+    return iterator(this, npos);
+}
+
+template<class Key, class Value, class Arena>
+typename CompactAVLTree<Key, Value, Arena>::iterator
+CompactAVLTree<Key, Value, Arena>::find(const Key& key) const
+{
+    return iterator(this, internalFind(key));
+}
+
+#if defined(__cpp_impl_coroutine)
+/**
+* find() as a coroutine (see lookup_task.h): before reading each node it
+* asks pager whether the node is resident, and if not has it fetched and
+* lets the other lookups on scheduler run until it has arrived.
+*/
+template<class Key, class Value, class Arena>
+template<class Pager>
+LookupTask<typename CompactAVLTree<Key, Value, Arena>::iterator>
+CompactAVLTree<Key, Value, Arena>::findAsync(Key key, LookupScheduler& scheduler, Pager& pager) const
+{
+    uint32_t temp = nodes_.getRoot();
+    while(temp != npos){
+        const NodeType* n = &node(temp);
+        if(!pager.resident(n, sizeof(NodeType))){
+            pager.fetch(n, sizeof(NodeType));
+            do{
+                co_await scheduler.yield();
+            } while(!pager.arrived(n, sizeof(NodeType)));
+        }
+        if(key < n->getKey()){
+            temp = n->getLeft();
+        }
+        else if(n->getKey() < key){
+            temp = n->getRight();
+        }
+        else{
+            break;
+        }
+    }
+    co_return iterator(this, temp);
+}
+
+// in-memory trees: prefetch every node and switch
+template<class Key, class Value, class Arena>
+LookupTask<typename CompactAVLTree<Key, Value, Arena>::iterator>
+CompactAVLTree<Key, Value, Arena>::findAsync(Key key, LookupScheduler& scheduler) const
+{
+    static PrefetchPager pager;
+    return findAsync(std::move(key), scheduler, pager);
+}
+#endif
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Arena>
+Value& CompactAVLTree<Key, Value, Arena>::operator[](const Key& key)
+{
+    uint32_t curr = internalFind(key);
+    if(curr == npos) throw std::out_of_range("Invalid key");
+    return node(curr).getValue();
+}
+
+template<class Key, class Value, class Arena>
+Value const & CompactAVLTree<Key, Value, Arena>::operator[](const Key& key) const
+{
+    uint32_t curr = internalFind(key);
+    if(curr == npos) throw std::out_of_range("Invalid key");
+    return node(curr).getValue();
+}
+
+/*
+ * If key is already in the tree, the current value is
+ * overwritten with the new value.
+ */
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::insert(const std::pair<const Key, Value>& new_item)
+{
+    // if tree is empty, insert node at top
+    if(nodes_.getRoot() == npos){
+        nodes_.setRoot(nodes_.emplace(new_item.first, new_item.second, npos));
+        return;
+    }
+    // single descent: either find the key or the parent of the new leaf
+    uint32_t temp = nodes_.getRoot();
+    uint32_t tempParent = npos;
+    while(temp != npos){
+        tempParent = temp;
+        if(new_item.first < node(temp).getKey()){
+            temp = node(temp).getLeft();
+        }
+        else if(node(temp).getKey() < new_item.first){
+            temp = node(temp).getRight();
+        }
+        else{
+            node(temp).setValue(new_item.second);
+            return;
+        }
+    }
+    // emplace may grow the arena, so only hold indices across it
+    uint32_t added = nodes_.emplace(new_item.first, new_item.second, tempParent);
+    if(new_item.first < node(tempParent).getKey()){
+        node(tempParent).setLeft(added);
+    }
+    else{
+        node(tempParent).setRight(added);
+    }
+    insertFix(tempParent, added);
+}
+
+/**
+* Adapts the arena nodes of this tree to the shared AVL rebalancing in
+* avl_rebalance.h.
+*/
+template<class Key, class Value, class Arena>
+struct CompactAVLTree<Key, Value, Arena>::Links
+{
+    typedef uint32_t Handle;
+
+    CompactAVLTree<Key, Value, Arena>* tree;
+
+    Handle null() const { return npos; }
+    Handle parent(Handle n) const { return tree->node(n).getParent(); }
+    Handle left(Handle n) const { return tree->node(n).getLeft(); }
+    Handle right(Handle n) const { return tree->node(n).getRight(); }
+    int balance(Handle n) const { return tree->node(n).getBalance(); }
+    void setBalance(Handle n, int balance) { tree->node(n).setBalance(static_cast<int8_t>(balance)); }
+    void rotateLeft(Handle n) { tree->rotateLeft(n); }
+    void rotateRight(Handle n) { tree->rotateRight(n); }
+};
+
+// child, a child of parent, is a subtree that just grew by one level
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::insertFix(uint32_t parent, uint32_t child)
+{
+    Links links = { this };
+    avlInsertFix(links, parent, child);
+}
+
+
+/*
+ * If a node has 2 children it is swapped with its
+ * predecessor and then removed.
+ */
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::remove(const Key& key)
+{
+    uint32_t removed = internalFind(key);
+    if(removed == npos){
+        return;
+    }
+    // if two children exist, swap with pred
+    if(node(removed).getLeft() != npos && node(removed).getRight() != npos){
+        nodeSwap(predecessor(removed), removed);
+    }
+
+    uint32_t parent = node(removed).getParent();
+    int diff = 0;
+    if(parent != npos){
+        diff = (node(parent).getLeft() == removed) ? 1 : -1;
+    }
+
+    // splice out removed, promoting its only child (if any)
+    uint32_t child = node(removed).getLeft() != npos ? node(removed).getLeft() : node(removed).getRight();
+    if(child != npos){
+        node(child).setParent(parent);
+    }
+    replaceChild(parent, removed, child);
+
+    removeFix(parent, diff);
+    releaseNode(removed);
+}
+
+// a subtree of current just shrank by one level, changing its balance by diff
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::removeFix(uint32_t current, int diff)
+{
+    Links links = { this };
+    avlRemoveFix(links, current, diff);
+}
+
+
+/**
+* Points parent's link to oldChild at newChild instead, or makes
+* newChild the root when parent is npos.
+*/
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild)
+{
+    if(parent == npos){
+        nodes_.setRoot(newChild);
+    }
+    else if(node(parent).getLeft() == oldChild){
+        node(parent).setLeft(newChild);
+    }
+    else{
+        node(parent).setRight(newChild);
+    }
+}
+
+// rotate left
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::rotateLeft(uint32_t current)
+{
+    NodeType& n = node(current);
+    uint32_t rightChild = n.getRight();
+    NodeType& r = node(rightChild);
+    uint32_t inner = r.getLeft();
+
+    replaceChild(n.getParent(), current, rightChild);
+    r.setParent(n.getParent());
+    r.setLeft(current);
+    n.setParent(rightChild);
+    n.setRight(inner);
+    if(inner != npos){
+        node(inner).setParent(current);
+    }
+}
+
+// rotate right
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::rotateRight(uint32_t current)
+{
+    NodeType& n = node(current);
+    uint32_t leftChild = n.getLeft();
+    NodeType& l = node(leftChild);
+    uint32_t inner = l.getRight();
+
+    replaceChild(n.getParent(), current, leftChild);
+    l.setParent(n.getParent());
+    l.setRight(current);
+    n.setParent(leftChild);
+    n.setLeft(inner);
+    if(inner != npos){
+        node(inner).setParent(current);
+    }
+}
+
+/**
+* Swaps the tree positions (links and balance) of two nodes, leaving
+* each node's item in its own slot.
+*/
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::nodeSwap(uint32_t n1, uint32_t n2)
+{
+    if(n1 == n2 || n1 == npos || n2 == npos){
+        return;
+    }
+    NodeType& a = node(n1);
+    NodeType& b = node(n2);
+    uint32_t ap = a.getParent(), al = a.getLeft(), ar = a.getRight();
+    uint32_t bp = b.getParent(), bl = b.getLeft(), br = b.getRight();
+    bool aIsLeft = (ap != npos && node(ap).getLeft() == n1);
+    bool bIsLeft = (bp != npos && node(bp).getLeft() == n2);
+
+    // exchange link fields, then patch up the case where they were adjacent
+    a.setParent(bp); a.setLeft(bl); a.setRight(br);
+    b.setParent(ap); b.setLeft(al); b.setRight(ar);
+    if(ar == n2){
+        b.setRight(n1);
+        a.setParent(n2);
+    }
+    else if(br == n1){
+        a.setRight(n2);
+        b.setParent(n1);
+    }
+    else if(al == n2){
+        b.setLeft(n1);
+        a.setParent(n2);
+    }
+    else if(bl == n1){
+        a.setLeft(n2);
+        b.setParent(n1);
+    }
+
+    // repoint neighbours
+    if(ap != npos && ap != n2){
+        if(aIsLeft) node(ap).setLeft(n2);
+        else node(ap).setRight(n2);
+    }
+    if(al != npos && al != n2) node(al).setParent(n2);
+    if(ar != npos && ar != n2) node(ar).setParent(n2);
+    if(bp != npos && bp != n1){
+        if(bIsLeft) node(bp).setLeft(n1);
+        else node(bp).setRight(n1);
+    }
+    if(bl != npos && bl != n1) node(bl).setParent(n1);
+    if(br != npos && br != n1) node(br).setParent(n1);
+
+    if(nodes_.getRoot() == n1){
+        nodes_.setRoot(n2);
+    }
+    else if(nodes_.getRoot() == n2){
+        nodes_.setRoot(n1);
+    }
+
+    int8_t tempB = a.getBalance();
+    a.setBalance(b.getBalance());
+    b.setBalance(tempB);
+}
+
+/**
+* Frees the slot of an already unlinked node. The arena fills the hole
+* with its last node, so links to that node are repointed here.
+*/
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::releaseNode(uint32_t index)
+{
+    uint32_t moved = nodes_.erase(index);
+    if(moved == index){
+        return;
+    }
+    NodeType& n = node(index);
+    replaceChild(n.getParent(), moved, index);
+    if(n.getLeft() != npos){
+        node(n.getLeft()).setParent(index);
+    }
+    if(n.getRight() != npos){
+        node(n.getRight()).setParent(index);
+    }
+}
+
+/**
+* Moves every node to the slot given by a van Emde Boas layout of the
+* current tree shape: the top half of the tree's levels is laid out
+* recursively first, followed by each of the subtrees hanging below it,
+* also laid out recursively. Every root-to-leaf path then crosses
+* O(log_B n) cache lines or pages for any block size B, instead of
+* roughly one per level when nodes sit in insertion order.
+*
+* Keys, links and balances are unchanged, only slot numbers move, so
+* this takes O(n log log n) time and invalidates iterators. Worth
+* calling after a bulk load or a long burst of random inserts.
+*/
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::relayout()
+{
+    uint32_t count = nodes_.size();
+    if(count == 0){
+        return;
+    }
+    // order[new slot] = old slot
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    vanEmdeBoasOrder(nodes_.getRoot(), getHeight(nodes_.getRoot()), order);
+
+    std::vector<uint32_t> moved(count);
+    for(uint32_t i = 0; i < count; ++i){
+        moved[order[i]] = i;
+    }
+    // rewrite links in place, then move the nodes themselves
+    for(uint32_t i = 0; i < count; ++i){
+        NodeType& n = node(i);
+        if(n.getParent() != npos) n.setParent(moved[n.getParent()]);
+        if(n.getLeft() != npos) n.setLeft(moved[n.getLeft()]);
+        if(n.getRight() != npos) n.setRight(moved[n.getRight()]);
+    }
+    nodes_.setRoot(moved[nodes_.getRoot()]);
+    nodes_.permute(order);
+}
+
+/**
+* Appends the nodes of the subtree at root, cut off after height levels,
+* to order in van Emde Boas order.
+*/
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::vanEmdeBoasOrder(uint32_t root, int height, std::vector<uint32_t>& order) const
+{
+    if(root == npos || height <= 0){
+        return;
+    }
+    if(height == 1){
+        order.push_back(root);
+        return;
+    }
+    int top = height / 2;
+    vanEmdeBoasOrder(root, top, order);
+    std::vector<uint32_t> bottoms;
+    collectAtDepth(root, top, bottoms);
+    for(size_t i = 0; i < bottoms.size(); ++i){
+        vanEmdeBoasOrder(bottoms[i], height - top, order);
+    }
+}
+
+/**
+* Appends the nodes exactly depth levels below root, left to right.
+*/
+template<class Key, class Value, class Arena>
+void CompactAVLTree<Key, Value, Arena>::collectAtDepth(uint32_t root, int depth, std::vector<uint32_t>& out) const
+{
+    if(root == npos){
+        return;
+    }
+    if(depth == 0){
+        out.push_back(root);
+        return;
+    }
+    collectAtDepth(node(root).getLeft(), depth - 1, out);
+    collectAtDepth(node(root).getRight(), depth - 1, out);
+}
+
+/**
+* Helper function to find a node with given key and return its index,
+* or npos if no item with that key exists
+*/
+template<class Key, class Value, class Arena>
+uint32_t CompactAVLTree<Key, Value, Arena>::internalFind(const Key& key) const
+{
+    uint32_t temp = nodes_.getRoot();
+    while(temp != npos){
+        const NodeType& n = node(temp);
+        if(key < n.getKey()){
+            temp = n.getLeft();
+        }
+        else if(n.getKey() < key){
+            temp = n.getRight();
+        }
+        else{
+            return temp;
+        }
+    }
+    return npos;
+}
+
+template<class Key, class Value, class Arena>
+uint32_t CompactAVLTree<Key, Value, Arena>::getSmallestNode() const
+{
+    uint32_t temp = nodes_.getRoot();
+    if(temp == npos){
+        return npos;
+    }
+    while(node(temp).getLeft() != npos){
+        temp = node(temp).getLeft();
+    }
+    return temp;
+}
+
+template<class Key, class Value, class Arena>
+uint32_t CompactAVLTree<Key, Value, Arena>::predecessor(uint32_t current) const
+{
+    // left child exists, find right most node
+    if(node(current).getLeft() != npos){
+        current = node(current).getLeft();
+        while(node(current).getRight() != npos){
+            current = node(current).getRight();
+        }
+        return current;
+    }
+    // walk up until we arrive from a right child
+    uint32_t parent = node(current).getParent();
+    while(parent != npos && node(parent).getLeft() == current){
+        current = parent;
+        parent = node(parent).getParent();
+    }
+    return parent;
+}
+
+template<class Key, class Value, class Arena>
+uint32_t CompactAVLTree<Key, Value, Arena>::successor(uint32_t current) const
+{
+    // right child exists, find left most node
+    if(node(current).getRight() != npos){
+        current = node(current).getRight();
+        while(node(current).getLeft() != npos){
+            current = node(current).getLeft();
+        }
+        return current;
+    }
+    // walk up until we arrive from a left child
+    uint32_t parent = node(current).getParent();
+    while(parent != npos && node(parent).getRight() == current){
+        current = parent;
+        parent = node(parent).getParent();
+    }
+    return parent;
+}
+
+// helper function to find height of tree
+template<class Key, class Value, class Arena>
+int CompactAVLTree<Key, Value, Arena>::getHeight(uint32_t root) const
+{
+    if(root == npos){
+        return 0;
+    }
+    return 1 + std::max(getHeight(node(root).getLeft()), getHeight(node(root).getRight()));
+}
+
+/**
+ * Return true iff the tree is balanced and every stored balance is correct.
+ */
+template<class Key, class Value, class Arena>
+bool CompactAVLTree<Key, Value, Arena>::isBalanced() const
+{
+    int height = 0;
+    return balanceHelper(nodes_.getRoot(), height);
+}
+
+template<class Key, class Value, class Arena>
+bool CompactAVLTree<Key, Value, Arena>::balanceHelper(uint32_t root, int& height) const
+{
+    if(root == npos){
+        height = 0;
+        return true;
+    }
+    int left = 0;
+    int right = 0;
+    if(!balanceHelper(node(root).getLeft(), left) || !balanceHelper(node(root).getRight(), right)){
+        return false;
+    }
+    height = 1 + std::max(left, right);
+    return (right - left) == node(root).getBalance() && right - left <= 1 && right - left >= -1;
+}
+
+/*
+-------------------------------------------------
+End implementations for the CompactAVLTree class.
+-------------------------------------------------
+*/
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef RECCHECK
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
 #include <algorithm>
+#include "tree_shape.h"
 
 #endif
 
@@ -11,28 +12,16 @@ using namespace std;
 // You may add any prototypes of helper functions here
 
 
+// a single iterative pass over the tree, so the cost is linear and deep
+// trees cannot overflow the call stack
 bool equalPaths(Node * root)
 {
-    if(root == nullptr) return true;
-    if(root->left != nullptr && root->right != nullptr){
-        return (treeLength(root->right) == treeLength(root->left)) && equalPaths(root->left) && equalPaths(root->right);
-    }
-    else if(root->left == nullptr){
-        return (equalPaths(root->right));
-    }
-    else if(root->right == nullptr){
-        return (equalPaths(root->left));
-    }
+    return treeShape<FieldLinks>(root).equalLeafDepths();
 }
 
 
 // find tree length from root to a given node
 int treeLength(Node* node){
-    if(node == nullptr){
-        return 0;
-    }
-    else{
-        return 1 + max(treeLength(node->left), treeLength(node->right));
-    }
+    return static_cast<int>(treeShape<FieldLinks>(node).height());
 }
 
@@ -0,0 +1,208 @@
+#ifndef INTERVALTREE_H
+#define INTERVALTREE_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "augmentedavl.h"
+
+/**
+* The closed interval [lo, hi], ordered by lo and then hi.
+*/
+template <typename Point>
+struct Interval
+{
+    Interval(const Point& lo, const Point& hi) : lo(lo), hi(hi) {}
+
+    bool operator<(const Interval& other) const
+    {
+        return lo < other.lo || (!(other.lo < lo) && hi < other.hi);
+    }
+    bool operator>(const Interval& other) const
+    {
+        return other < *this;
+    }
+    bool operator==(const Interval& other) const
+    {
+        return lo == other.lo && hi == other.hi;
+    }
+
+    Point lo;
+    Point hi;
+};
+
+template <typename Point>
+std::ostream& operator<<(std::ostream& os, const Interval<Point>& interval)
+{
+    return os << '[' << interval.lo << ", " << interval.hi << ']';
+}
+
+/**
+* Aggregate used by IntervalTree: the largest right endpoint in a subtree.
+*/
+template <typename Point, typename Value>
+struct MaxEndpointAggregate
+{
+    typedef Point type;
+    static type identity() { return std::numeric_limits<Point>::lowest(); }
+    static type lift(const Interval<Point>& interval, const Value&) { return interval.hi; }
+    static type combine(const type& a, const type& b) { return std::max(a, b); }
+};
+
+/**
+* A map from closed intervals [lo, hi] to values. Intervals are the keys of
+* an AVLTree, and every node caches the largest
+* hi in its subtree, which lets queries skip any subtree that ends before
+* the query starts. Rotations, balancing and the summary repairs all come
+* from AVLTree and AugmentedAVLTree.
+*
+* Inserting an interval that is already present replaces its value.
+* Point must be an arithmetic type.
+*/
+template <class Point, class Value>
+class IntervalTree : public AugmentedAVLTree<Interval<Point>, Value, MaxEndpointAggregate<Point, Value> >
+{
+public:
+    typedef Interval<Point> Key;
+    typedef AugmentedAVLTree<Key, Value, MaxEndpointAggregate<Point, Value> > Base;
+    typedef typename Base::iterator iterator;
+
+    using Base::insert;
+    using Base::remove;
+    void insert(const Point& lo, const Point& hi, const Value& value);
+    void remove(const Point& lo, const Point& hi);
+
+    std::vector<iterator> stab(const Point& point) const;
+    std::vector<iterator> overlapping(const Point& lo, const Point& hi) const;
+    std::vector<std::vector<iterator> > stab(const std::vector<Point>& points) const;
+
+protected:
+    typedef typename Base::NodeType NodeType;
+
+    static void collectOverlapping(NodeType* node, const Point& lo, const Point& hi, std::vector<iterator>& out);
+    static void collectBatch(NodeType* node, const std::vector<Point>& points, const std::vector<size_t>& order,
+                             size_t first, size_t last, std::vector<std::vector<iterator> >& out);
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the IntervalTree class.
+  -------------------------------------------------
+*/
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::insert(const Point& lo, const Point& hi, const Value& value)
+{
+    this->insert(std::make_pair(Key(lo, hi), value));
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::remove(const Point& lo, const Point& hi)
+{
+    this->remove(Key(lo, hi));
+}
+
+/**
+* Every interval containing point, in key order.
+*/
+template<class Point, class Value>
+std::vector<typename IntervalTree<Point, Value>::iterator>
+IntervalTree<Point, Value>::stab(const Point& point) const
+{
+    return overlapping(point, point);
+}
+
+/**
+* Every interval sharing at least one point with [lo, hi], in key order.
+* Each reported interval costs O(log n), and a query with no results
+* costs O(log n).
+*/
+template<class Point, class Value>
+std::vector<typename IntervalTree<Point, Value>::iterator>
+IntervalTree<Point, Value>::overlapping(const Point& lo, const Point& hi) const
+{
+    std::vector<iterator> out;
+    collectOverlapping(static_cast<NodeType*>(this->root_), lo, hi, out);
+    return out;
+}
+
+/**
+* Stabs the tree with many points at once; result i holds the intervals
+* containing points[i]. The points are sorted and pushed down the tree
+* together, so each node is visited at most once for the whole batch
+* instead of once per point, and each subtree only sees the points that
+* can still hit it.
+*/
+template<class Point, class Value>
+std::vector<std::vector<typename IntervalTree<Point, Value>::iterator> >
+IntervalTree<Point, Value>::stab(const std::vector<Point>& points) const
+{
+    std::vector<std::vector<iterator> > out(points.size());
+    std::vector<size_t> order(points.size());
+    for(size_t i = 0; i < order.size(); ++i){
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&points](size_t a, size_t b) { return points[a] < points[b]; });
+    collectBatch(static_cast<NodeType*>(this->root_), points, order, 0, order.size(), out);
+    return out;
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::collectOverlapping(NodeType* node, const Point& lo, const Point& hi, std::vector<iterator>& out)
+{
+    // nothing below ends at or after lo
+    if(node == nullptr || node->getSummary() < lo){
+        return;
+    }
+    collectOverlapping(node->getLeft(), lo, hi, out);
+    // this node and everything to its right starts after hi
+    if(hi < node->getKey().lo){
+        return;
+    }
+    if(!(node->getKey().hi < lo)){
+        out.push_back(Base::makeIterator(node));
+    }
+    collectOverlapping(node->getRight(), lo, hi, out);
+}
+
+/**
+* order[first, last) are the indices of the points, sorted by value, that
+* may still hit an interval in node's subtree.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::collectBatch(NodeType* node, const std::vector<Point>& points, const std::vector<size_t>& order,
+                                              size_t first, size_t last, std::vector<std::vector<iterator> >& out)
+{
+    if(node == nullptr){
+        return;
+    }
+    // points past the largest endpoint below cannot hit anything here
+    last = std::upper_bound(order.begin() + first, order.begin() + last, node->getSummary(),
+                            [&points](const Point& p, size_t i) { return p < points[i]; }) - order.begin();
+    if(first == last){
+        return;
+    }
+    collectBatch(node->getLeft(), points, order, first, last, out);
+
+    const Key& interval = node->getKey();
+    size_t start = std::lower_bound(order.begin() + first, order.begin() + last, interval.lo,
+                                    [&points](size_t i, const Point& p) { return points[i] < p; }) - order.begin();
+    for(size_t i = start; i < last && !(interval.hi < points[order[i]]); ++i){
+        out[order[i]].push_back(Base::makeIterator(node));
+    }
+    // intervals to the right start at or after this one
+    collectBatch(node->getRight(), points, order, start, last, out);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the IntervalTree class.
+  -----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,551 @@
+#ifndef LAZYAVL_H
+#define LAZYAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* An AVLNode that can be marked dead instead of being unlinked.
+*/
+template <typename Key, typename Value>
+class LazyAVLNode : public AVLNode<Key, Value>
+{
+public:
+    LazyAVLNode(const Key& key, const Value& value, LazyAVLNode<Key, Value>* parent);
+    virtual ~LazyAVLNode();
+
+    bool isDead() const;
+    void setDead(bool dead);
+    bool isQueued() const;
+    void setQueued(bool queued);
+
+    virtual LazyAVLNode<Key, Value>* getParent() const override;
+    virtual LazyAVLNode<Key, Value>* getLeft() const override;
+    virtual LazyAVLNode<Key, Value>* getRight() const override;
+
+protected:
+    bool dead_;
+    // listed in LazyAVLTree::removed_
+    bool queued_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the LazyAVLNode class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+LazyAVLNode<Key, Value>::LazyAVLNode(const Key& key, const Value& value, LazyAVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), dead_(false), queued_(false)
+{
+
+}
+
+template<class Key, class Value>
+LazyAVLNode<Key, Value>::~LazyAVLNode()
+{
+
+}
+
+template<class Key, class Value>
+bool LazyAVLNode<Key, Value>::isDead() const
+{
+    return dead_;
+}
+
+template<class Key, class Value>
+void LazyAVLNode<Key, Value>::setDead(bool dead)
+{
+    dead_ = dead;
+}
+
+template<class Key, class Value>
+bool LazyAVLNode<Key, Value>::isQueued() const
+{
+    return queued_;
+}
+
+template<class Key, class Value>
+void LazyAVLNode<Key, Value>::setQueued(bool queued)
+{
+    queued_ = queued;
+}
+
+template<class Key, class Value>
+LazyAVLNode<Key, Value>* LazyAVLNode<Key, Value>::getParent() const
+{
+    return static_cast<LazyAVLNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+LazyAVLNode<Key, Value>* LazyAVLNode<Key, Value>::getLeft() const
+{
+    return static_cast<LazyAVLNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+LazyAVLNode<Key, Value>* LazyAVLNode<Key, Value>::getRight() const
+{
+    return static_cast<LazyAVLNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the LazyAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVLTree whose remove() only marks the node dead (a tombstone): one
+* descent, no nodeSwap, no rotations. find(), operator[], iteration and
+* empty() skip tombstones, and re-inserting a dead key revives its node.
+*
+* Tombstones are cleared once they exceed maxDeadRatio of all nodes:
+*
+*   COMPACT_REBUILD      one O(n) pass drops every tombstone and relinks
+*                        the survivors into a perfectly balanced tree,
+*                        reusing their nodes; O(1) amortized per remove
+*   COMPACT_INCREMENTAL  every insert/remove also unlinks up to
+*                        purgeBatch tombstones with the normal AVL remove,
+*                        so no single operation pays for the whole backlog;
+*                        the queue of tombstones to unlink never holds more
+*                        than 2 * tombstones() + purgeBatch nodes, however
+*                        often keys are removed and revived
+*
+* compact() runs a full rebuild on demand, e.g. from an idle period. The
+* tree does no locking of its own, so the compaction work is done by the
+* calling thread rather than a background one.
+*/
+template <class Key, class Value>
+class LazyAVLTree : public AVLTree<Key, Value>
+{
+public:
+    enum CompactionMode { COMPACT_REBUILD, COMPACT_INCREMENTAL };
+
+    /**
+    * An iterator that steps over tombstones.
+    */
+    class iterator : public AVLTree<Key, Value>::iterator
+    {
+    public:
+        iterator();
+        explicit iterator(const typename AVLTree<Key, Value>::iterator& it);
+        iterator& operator++();
+
+    private:
+        void skipDead();
+    };
+
+    explicit LazyAVLTree(double maxDeadRatio = 0.25, CompactionMode mode = COMPACT_REBUILD, size_t purgeBatch = 2);
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual typename AVLTree<Key, Value>::iterator insert(typename AVLTree<Key, Value>::iterator hint,
+                                                          const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    virtual void clear();
+    void compact();
+    virtual void load(std::istream& is);
+
+    bool empty() const;
+    size_t size() const;
+    size_t tombstones() const;
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    void findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent) override;
+    virtual size_t liveCount(uint64_t stamp) const override;
+    virtual bool isLive(const Node<Key, Value>* node, uint64_t stamp) const override;
+
+    void maintain();
+    void purge(size_t budget);
+    void dropRevived();
+    LazyAVLNode<Key, Value>* liveNode(const Key& key) const;
+    static LazyAVLNode<Key, Value>* relink(std::vector<LazyAVLNode<Key, Value>*>& nodes, size_t lo, size_t hi,
+                                           LazyAVLNode<Key, Value>* parent, int& height);
+
+    double maxDeadRatio_;
+    CompactionMode mode_;
+    size_t purgeBatch_;
+    size_t live_;
+    size_t dead_;
+    // nodes removed since the last compaction, each at most once, consumed
+    // by purge(); entries whose node has since been revived are stale
+    std::vector<LazyAVLNode<Key, Value>*> removed_;
+};
+
+/*
+  ----------------------------------------------------------
+  Begin implementations for the LazyAVLTree::iterator class.
+  ----------------------------------------------------------
+*/
+
+template<class Key, class Value>
+LazyAVLTree<Key, Value>::iterator::iterator()
+{
+
+}
+
+template<class Key, class Value>
+LazyAVLTree<Key, Value>::iterator::iterator(const typename AVLTree<Key, Value>::iterator& it) :
+    AVLTree<Key, Value>::iterator(it)
+{
+    skipDead();
+}
+
+template<class Key, class Value>
+typename LazyAVLTree<Key, Value>::iterator&
+LazyAVLTree<Key, Value>::iterator::operator++()
+{
+    AVLTree<Key, Value>::iterator::operator++();
+    skipDead();
+    return *this;
+}
+
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::iterator::skipDead()
+{
+    while(this->current_ != nullptr && static_cast<LazyAVLNode<Key, Value>*>(this->current_)->isDead()){
+        AVLTree<Key, Value>::iterator::operator++();
+    }
+}
+
+/*
+  --------------------------------------------------------
+  End implementations for the LazyAVLTree::iterator class.
+  --------------------------------------------------------
+*/
+
+/*
+  ------------------------------------------------
+  Begin implementations for the LazyAVLTree class.
+  ------------------------------------------------
+*/
+
+template<class Key, class Value>
+LazyAVLTree<Key, Value>::LazyAVLTree(double maxDeadRatio, CompactionMode mode, size_t purgeBatch) :
+    maxDeadRatio_(maxDeadRatio),
+    mode_(mode),
+    purgeBatch_(purgeBatch),
+    live_(0),
+    dead_(0)
+{
+
+}
+
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    LazyAVLNode<Key, Value>* node = static_cast<LazyAVLNode<Key, Value>*>(this->internalFind(new_item.first));
+    if(node != nullptr){
+        node->setValue(new_item.second);
+        if(node->isDead()){
+            node->setDead(false);
+            dead_--;
+            live_++;
+        }
+    }
+    else{
+        AVLTree<Key, Value>::insert(new_item);
+        live_++;
+    }
+    maintain();
+}
+
+/**
+* Hinted insert, see AVLTree. The hint may be a tombstone; a dead key is
+* revived just as by insert(item).
+*/
+template<class Key, class Value>
+typename AVLTree<Key, Value>::iterator
+LazyAVLTree<Key, Value>::insert(typename AVLTree<Key, Value>::iterator hint, const std::pair<const Key, Value>& new_item)
+{
+    size_t before = this->size_;
+    typename AVLTree<Key, Value>::iterator it = AVLTree<Key, Value>::insert(hint, new_item);
+    LazyAVLNode<Key, Value>* node = static_cast<LazyAVLNode<Key, Value>*>(this->iteratorNode(it));
+    if(this->size_ != before){
+        live_++;
+    }
+    else if(node->isDead()){
+        node->setDead(false);
+        dead_--;
+        live_++;
+    }
+    // compaction only frees tombstones, so node stays valid
+    maintain();
+    return it;
+}
+
+/**
+* Marks key dead. The node stays linked until the next compaction.
+*/
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::remove(const Key& key)
+{
+    LazyAVLNode<Key, Value>* node = liveNode(key);
+    if(node == nullptr){
+        return;
+    }
+    node->setDead(true);
+    live_--;
+    dead_++;
+    if(mode_ == COMPACT_INCREMENTAL && !node->isQueued()){
+        node->setQueued(true);
+        removed_.push_back(node);
+    }
+    maintain();
+}
+
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::clear()
+{
+    AVLTree<Key, Value>::clear();
+    live_ = 0;
+    dead_ = 0;
+    removed_.clear();
+}
+
+/**
+* Drops every tombstone and rebuilds the survivors into a perfectly
+* balanced tree in O(n), reusing their nodes.
+*/
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::compact()
+{
+    removed_.clear();
+    if(dead_ == 0){
+        return;
+    }
+    std::vector<LazyAVLNode<Key, Value>*> nodes;
+    nodes.reserve(live_ + dead_);
+    for(Node<Key, Value>* n = this->getSmallestNode(); n != nullptr; n = this->successor(n)){
+        nodes.push_back(static_cast<LazyAVLNode<Key, Value>*>(n));
+    }
+    // dead nodes are freed only after the walk, which climbs through them
+    size_t kept = 0;
+    for(size_t i = 0; i < nodes.size(); ++i){
+        if(nodes[i]->isDead()){
+            this->uncache(nodes[i]);
+            delete nodes[i];
+        }
+        else{
+            nodes[i]->setQueued(false);
+            nodes[kept++] = nodes[i];
+        }
+    }
+    nodes.resize(kept);
+    int height = 0;
+    this->root_ = relink(nodes, 0, nodes.size(), nullptr, height);
+    this->rightmost_ = nodes.empty() ? nullptr : nodes.back();
+    this->size_ = kept;
+    dead_ = 0;
+}
+
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::load(std::istream& is)
+{
+    clear();
+    BinarySearchTree<Key, Value>::load(is);
+    for(typename AVLTree<Key, Value>::iterator it = AVLTree<Key, Value>::begin(); it != AVLTree<Key, Value>::end(); ++it){
+        live_++;
+    }
+}
+
+template<class Key, class Value>
+bool LazyAVLTree<Key, Value>::empty() const
+{
+    return live_ == 0;
+}
+
+template<class Key, class Value>
+size_t LazyAVLTree<Key, Value>::size() const
+{
+    return live_;
+}
+
+template<class Key, class Value>
+size_t LazyAVLTree<Key, Value>::tombstones() const
+{
+    return dead_;
+}
+
+template<class Key, class Value>
+typename LazyAVLTree<Key, Value>::iterator LazyAVLTree<Key, Value>::begin() const
+{
+    return iterator(AVLTree<Key, Value>::begin());
+}
+
+template<class Key, class Value>
+typename LazyAVLTree<Key, Value>::iterator LazyAVLTree<Key, Value>::end() const
+{
+    return iterator(AVLTree<Key, Value>::end());
+}
+
+template<class Key, class Value>
+typename LazyAVLTree<Key, Value>::iterator LazyAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(this->makeIterator(liveNode(key)));
+}
+
+/**
+* Batched find(); tombstones come back as end().
+*/
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    std::vector<typename AVLTree<Key, Value>::iterator> found;
+    AVLTree<Key, Value>::findBatch(keys, found);
+    out.resize(found.size());
+    for(size_t i = 0; i < found.size(); ++i){
+        LazyAVLNode<Key, Value>* node = static_cast<LazyAVLNode<Key, Value>*>(this->iteratorNode(found[i]));
+        out[i] = iterator(this->makeIterator((node == nullptr || node->isDead()) ? nullptr : node));
+    }
+}
+
+template<class Key, class Value>
+Value& LazyAVLTree<Key, Value>::operator[](const Key& key)
+{
+    LazyAVLNode<Key, Value>* node = liveNode(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value>
+Value const & LazyAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    LazyAVLNode<Key, Value>* node = liveNode(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value>
+Node<Key, Value>* LazyAVLTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new LazyAVLNode<Key, Value>(key, value, static_cast<LazyAVLNode<Key, Value>*>(parent));
+}
+
+// snapshots leave tombstones out
+template<class Key, class Value>
+size_t LazyAVLTree<Key, Value>::liveCount(uint64_t stamp) const
+{
+    return live_;
+}
+
+template<class Key, class Value>
+bool LazyAVLTree<Key, Value>::isLive(const Node<Key, Value>* node, uint64_t stamp) const
+{
+    return !static_cast<const LazyAVLNode<Key, Value>*>(node)->isDead();
+}
+
+/**
+* Starts compaction once tombstones make up more than maxDeadRatio of
+* the nodes.
+*/
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::maintain()
+{
+    if(removed_.size() > 2 * dead_ + purgeBatch_){
+        dropRevived();
+    }
+    if(dead_ == 0 || dead_ <= maxDeadRatio_ * (live_ + dead_)){
+        return;
+    }
+    if(mode_ == COMPACT_REBUILD){
+        compact();
+    }
+    else{
+        purge(purgeBatch_);
+    }
+}
+
+/**
+* Takes up to budget nodes off the queue and physically removes those
+* that are still tombstones with AVLTree::remove. Stale entries count
+* against the budget too, so a call does bounded work.
+*/
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::purge(size_t budget)
+{
+    while(budget > 0 && !removed_.empty()){
+        LazyAVLNode<Key, Value>* node = removed_.back();
+        removed_.pop_back();
+        node->setQueued(false);
+        budget--;
+        if(node->isDead()){
+            Key key = node->getKey();
+            AVLTree<Key, Value>::remove(key);
+            dead_--;
+        }
+    }
+}
+
+/**
+* Drops the queue entries of revived nodes. Called once they outnumber
+* the tombstones, so at least half the queue goes and the O(queue) pass
+* is O(1) amortized per revive.
+*/
+template<class Key, class Value>
+void LazyAVLTree<Key, Value>::dropRevived()
+{
+    size_t kept = 0;
+    for(size_t i = 0; i < removed_.size(); ++i){
+        if(removed_[i]->isDead()){
+            removed_[kept++] = removed_[i];
+        }
+        else{
+            removed_[i]->setQueued(false);
+        }
+    }
+    removed_.resize(kept);
+}
+
+/**
+* The node holding key, or NULL if key is absent or dead.
+*/
+template<class Key, class Value>
+LazyAVLNode<Key, Value>* LazyAVLTree<Key, Value>::liveNode(const Key& key) const
+{
+    LazyAVLNode<Key, Value>* node = static_cast<LazyAVLNode<Key, Value>*>(this->internalFind(key));
+    return (node == nullptr || node->isDead()) ? nullptr : node;
+}
+
+/**
+* Links nodes[lo, hi) into a perfectly balanced subtree under parent and
+* sets the AVL balances on the way back up.
+*/
+template<class Key, class Value>
+LazyAVLNode<Key, Value>* LazyAVLTree<Key, Value>::relink(std::vector<LazyAVLNode<Key, Value>*>& nodes, size_t lo, size_t hi,
+                                                         LazyAVLNode<Key, Value>* parent, int& height)
+{
+    if(lo >= hi){
+        height = 0;
+        return nullptr;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    LazyAVLNode<Key, Value>* node = nodes[mid];
+    int leftHeight = 0;
+    int rightHeight = 0;
+    node->setParent(parent);
+    node->setLeft(relink(nodes, lo, mid, node, leftHeight));
+    node->setRight(relink(nodes, mid + 1, hi, node, rightHeight));
+    node->setBalance(static_cast<int8_t>(rightHeight - leftHeight));
+    height = 1 + std::max(leftHeight, rightHeight);
+    return node;
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the LazyAVLTree class.
+  ----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef LOOKUP_CACHE_H
+#define LOOKUP_CACHE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+template <typename Key, typename Value>
+class Node;
+
+/**
+* A direct-mapped cache from key to the node holding it, consulted by
+* BinarySearchTree::internalFind before descending. Each slot keeps the
+* key's hash next to the node pointer, so a slot owned by another key is
+* rejected without touching that node; slots are 16 bytes and the table
+* is cache line aligned, so a probe is a single line.
+*
+* Rotations and nodeSwap move nodes around without changing which node
+* holds a key, so entries only go stale when a node is freed; the trees
+* call forget() before deleting one.
+*/
+template <typename Key, typename Value>
+class LookupCache
+{
+public:
+    explicit LookupCache(size_t slots);
+    ~LookupCache();
+
+    Node<Key, Value>* lookup(const Key& key) const;
+    void store(const Key& key, Node<Key, Value>* node);
+    void forget(Node<Key, Value>* node);
+    void flush();
+    size_t slots() const;
+
+private:
+    LookupCache(const LookupCache&);
+    LookupCache& operator=(const LookupCache&);
+
+    struct Slot
+    {
+        uint64_t hash;
+        Node<Key, Value>* node;
+    };
+
+    static uint64_t hashKey(const Key& key);
+    size_t index(uint64_t hash) const;
+
+    Slot* slots_;
+    size_t count_;
+    int shift_;
+    // bound in the constructor, so trees over keys without std::hash
+    // still compile as long as they never enable the cache
+    uint64_t (*hash_)(const Key&);
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the LookupCache class.
+  -----------------------------------------------
+*/
+
+/**
+* Allocates slots entries, rounded up to a power of two (at least 4, one
+* cache line).
+*/
+template<typename Key, typename Value>
+LookupCache<Key, Value>::LookupCache(size_t slots) :
+    slots_(nullptr),
+    count_(4),
+    shift_(62),
+    hash_(&LookupCache<Key, Value>::hashKey)
+{
+    while(count_ < slots){
+        count_ <<= 1;
+        shift_--;
+    }
+    void* raw = nullptr;
+    if(posix_memalign(&raw, 64, count_ * sizeof(Slot)) != 0){
+        throw std::bad_alloc();
+    }
+    slots_ = static_cast<Slot*>(raw);
+    flush();
+}
+
+template<typename Key, typename Value>
+LookupCache<Key, Value>::~LookupCache()
+{
+    std::free(slots_);
+}
+
+/**
+* Returns the cached node for key, or NULL on a miss.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* LookupCache<Key, Value>::lookup(const Key& key) const
+{
+    uint64_t hash = hash_(key);
+    const Slot& slot = slots_[index(hash)];
+    if(slot.node != nullptr && slot.hash == hash && slot.node->getKey() == key){
+        return slot.node;
+    }
+    return nullptr;
+}
+
+template<typename Key, typename Value>
+void LookupCache<Key, Value>::store(const Key& key, Node<Key, Value>* node)
+{
+    uint64_t hash = hash_(key);
+    Slot& slot = slots_[index(hash)];
+    slot.hash = hash;
+    slot.node = node;
+}
+
+/**
+* Drops node from the cache if it is cached.
+*/
+template<typename Key, typename Value>
+void LookupCache<Key, Value>::forget(Node<Key, Value>* node)
+{
+    Slot& slot = slots_[index(hash_(node->getKey()))];
+    if(slot.node == node){
+        slot.node = nullptr;
+    }
+}
+
+template<typename Key, typename Value>
+void LookupCache<Key, Value>::flush()
+{
+    for(size_t i = 0; i < count_; ++i){
+        slots_[i].hash = 0;
+        slots_[i].node = nullptr;
+    }
+}
+
+template<typename Key, typename Value>
+size_t LookupCache<Key, Value>::slots() const
+{
+    return count_;
+}
+
+// std::hash is the identity for integers on common libraries, so the
+// result is spread with a Fibonacci multiply before it picks a slot
+template<typename Key, typename Value>
+uint64_t LookupCache<Key, Value>::hashKey(const Key& key)
+{
+    return static_cast<uint64_t>(std::hash<Key>()(key)) * 0x9E3779B97F4A7C15ULL;
+}
+
+template<typename Key, typename Value>
+size_t LookupCache<Key, Value>::index(uint64_t hash) const
+{
+    return static_cast<size_t>(hash >> shift_);
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the LookupCache class.
+  ---------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef LOOKUP_TASK_H
+#define LOOKUP_TASK_H
+
+// Coroutine lookups
+//
+// With C++20 coroutines (build with -std=c++20), CompactAVLTree and
+// MappedAVLTree offer findAsync(), a descent that can step aside whenever
+// the next node is likely cold, so that one thread keeps many lookups in
+// flight and their memory or I/O stalls overlap instead of adding up:
+//
+//   LookupScheduler scheduler;
+//   std::vector<LookupTask<Tree::iterator> > lookups;
+//   for(...) lookups.push_back(tree.findAsync(key, scheduler, pager));
+//   for(...) scheduler.spawn(lookups[i]);
+//   scheduler.run();                  // lookups[i].result() once done
+//
+// or, from inside another coroutine, it = co_await tree.findAsync(...).
+//
+// Before reading a node the descent asks its Pager, which decides what
+// "cold" means:
+//
+//   bool resident(const void* addr, size_t size)  reading now won't stall
+//   void fetch(const void* addr, size_t size)     start bringing it in
+//   bool arrived(const void* addr, size_t size)   the fetch has landed
+//
+// A cold node is fetched and the lookup yields to the scheduler until
+// arrived() says so; meanwhile the other lookups run. A pager that can
+// drop a page again before the waiting lookup reads it must fetch it
+// again from arrived(), or that lookup would wait forever. PrefetchPager
+// (memory: always prefetch and switch) and MincorePager (mmap'd files:
+// mincore() and MADV_WILLNEED) are provided; a test can plug in a
+// simulated pager.
+//
+// Everything is single threaded and cooperative: the scheduler resumes
+// lookups in FIFO order on the thread that calls run(). The tree must not
+// be modified, and the tasks, scheduler and pager must stay alive, until
+// every lookup has finished. Without coroutine support this header is
+// empty and the trees are unchanged.
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <unistd.h>
+#include <sys/mman.h>
+
+class LookupScheduler;
+
+/**
+* The result of a coroutine lookup: a lazily started coroutine producing
+* a T (not void). It runs when spawned on a LookupScheduler or when
+* awaited; awaiting resumes the awaiting coroutine once it finished and
+* hands it the result.
+*/
+template <typename T>
+class LookupTask
+{
+public:
+    struct promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    // resumes whoever awaited the task, if anyone
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(Handle handle) noexcept
+        {
+            std::coroutine_handle<> next = handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct promise_type
+    {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        LookupTask get_return_object() { return LookupTask(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return std::suspend_always(); }
+        FinalAwaiter final_suspend() const noexcept { return FinalAwaiter(); }
+        void return_value(T result) { value.emplace(std::move(result)); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    LookupTask(LookupTask&& other) noexcept : handle_(std::exchange(other.handle_, Handle())) {}
+    LookupTask& operator=(LookupTask&& other) noexcept;
+    ~LookupTask();
+
+    bool done() const;
+    T& result();
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    T await_resume();
+
+private:
+    friend class LookupScheduler;
+    explicit LookupTask(Handle handle) : handle_(handle) {}
+    LookupTask(const LookupTask&) = delete;
+    LookupTask& operator=(const LookupTask&) = delete;
+
+    Handle handle_;
+};
+
+/**
+* Runs coroutine lookups round robin on the calling thread.
+*/
+class LookupScheduler
+{
+public:
+    /**
+    * What a lookup awaits to let the others run; it is queued again
+    * behind them.
+    */
+    struct Yield
+    {
+        LookupScheduler* scheduler;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { scheduler->post(handle); }
+        void await_resume() const noexcept {}
+    };
+
+    template <typename T>
+    void spawn(LookupTask<T>& task);
+    void post(std::coroutine_handle<> handle);
+    Yield yield();
+    void run();
+
+private:
+    std::deque<std::coroutine_handle<> > ready_;
+};
+
+/**
+* Pager for data in memory: every node is treated as cold, prefetched,
+* and read after the other lookups had a turn, by which time the cache
+* line has usually arrived.
+*/
+struct PrefetchPager
+{
+    bool resident(const void*, size_t) const { return false; }
+    void fetch(const void* addr, size_t) const
+    {
+#if defined(__GNUC__)
+        __builtin_prefetch(addr);
+#else
+        (void)addr;
+#endif
+    }
+    bool arrived(const void*, size_t) const { return true; }
+};
+
+/**
+* Pager for mmap'd trees (MappedAVLTree): a node is resident when its
+* pages are in the page cache, per mincore(), and fetching asks the
+* kernel to read them ahead with MADV_WILLNEED, so the lookup waits for
+* the I/O without blocking the thread on a page fault.
+*/
+class MincorePager
+{
+public:
+    MincorePager() : pageSize_(static_cast<uintptr_t>(sysconf(_SC_PAGESIZE))) {}
+
+    bool resident(const void* addr, size_t size) const;
+    void fetch(const void* addr, size_t size) const;
+    bool arrived(const void* addr, size_t size) const;
+
+private:
+    uintptr_t pageSize_;
+};
+
+/*
+  ----------------------------------------------
+  Begin implementations for the LookupTask class.
+  ----------------------------------------------
+*/
+
+template<typename T>
+LookupTask<T>& LookupTask<T>::operator=(LookupTask&& other) noexcept
+{
+    if(this != &other){
+        if(handle_){
+            handle_.destroy();
+        }
+        handle_ = std::exchange(other.handle_, Handle());
+    }
+    return *this;
+}
+
+template<typename T>
+LookupTask<T>::~LookupTask()
+{
+    if(handle_){
+        handle_.destroy();
+    }
+}
+
+template<typename T>
+bool LookupTask<T>::done() const
+{
+    return !handle_ || handle_.done();
+}
+
+/**
+* The value the lookup returned; rethrows if it threw. Only valid once
+* done().
+*/
+template<typename T>
+T& LookupTask<T>::result()
+{
+    if(handle_.promise().error){
+        std::rethrow_exception(handle_.promise().error);
+    }
+    return *handle_.promise().value;
+}
+
+// starts the task right away, in place of the awaiting coroutine
+template<typename T>
+std::coroutine_handle<> LookupTask<T>::await_suspend(std::coroutine_handle<> awaiting) noexcept
+{
+    handle_.promise().continuation = awaiting;
+    return handle_;
+}
+
+template<typename T>
+T LookupTask<T>::await_resume()
+{
+    return std::move(result());
+}
+
+/*
+  --------------------------------------------
+  End implementations for the LookupTask class.
+  --------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the LookupScheduler class.
+  ---------------------------------------------------
+*/
+
+template<typename T>
+void LookupScheduler::spawn(LookupTask<T>& task)
+{
+    post(task.handle_);
+}
+
+inline void LookupScheduler::post(std::coroutine_handle<> handle)
+{
+    ready_.push_back(handle);
+}
+
+inline LookupScheduler::Yield LookupScheduler::yield()
+{
+    Yield awaiter = { this };
+    return awaiter;
+}
+
+/**
+* Resumes queued lookups until none is left, i.e. every spawned one
+* finished.
+*/
+inline void LookupScheduler::run()
+{
+    while(!ready_.empty()){
+        std::coroutine_handle<> handle = ready_.front();
+        ready_.pop_front();
+        handle.resume();
+    }
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the LookupScheduler class.
+  -------------------------------------------------
+*/
+
+/*
+  ------------------------------------------------
+  Begin implementations for the MincorePager class.
+  ------------------------------------------------
+*/
+
+inline bool MincorePager::resident(const void* addr, size_t size) const
+{
+    uintptr_t first = reinterpret_cast<uintptr_t>(addr) & ~(pageSize_ - 1);
+    uintptr_t last = (reinterpret_cast<uintptr_t>(addr) + size - 1) & ~(pageSize_ - 1);
+    // a node spans at most two pages
+    unsigned char pages[2] = { 0, 0 };
+    if(mincore(reinterpret_cast<void*>(first), last - first + pageSize_, pages) != 0){
+        // not a mapping mincore knows about; reading it won't wait for I/O
+        return true;
+    }
+    return (pages[0] & 1) && (first == last || (pages[1] & 1));
+}
+
+inline void MincorePager::fetch(const void* addr, size_t size) const
+{
+    uintptr_t first = reinterpret_cast<uintptr_t>(addr) & ~(pageSize_ - 1);
+    uintptr_t last = (reinterpret_cast<uintptr_t>(addr) + size - 1) & ~(pageSize_ - 1);
+    madvise(reinterpret_cast<void*>(first), last - first + pageSize_, MADV_WILLNEED);
+}
+
+// the pages may have been reclaimed again before we got to them
+inline bool MincorePager::arrived(const void* addr, size_t size) const
+{
+    if(resident(addr, size)){
+        return true;
+    }
+    fetch(addr, size);
+    return false;
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the MincorePager class.
+  ----------------------------------------------
+*/
+
+#endif
+
+#endif
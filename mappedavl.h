@@ -0,0 +1,490 @@
+#ifndef MAPPEDAVL_H
+#define MAPPEDAVL_H
+
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "compactavl.h"
+
+/**
+* The first bytes of a MappedArena file. Nodes follow at dataOffset so the
+* node array starts on a cache line boundary.
+*/
+struct MappedArenaHeader
+{
+    // set in flags from the first change after a sync() until the next one
+    static const uint32_t dirty = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeSize;
+    uint64_t size;
+    uint64_t capacity;
+    uint32_t root;
+    uint32_t flags;
+};
+
+/**
+* A NodeArena whose slots live in a file mapped with mmap(MAP_SHARED).
+* Since CompactAVLTree links nodes by index, every link is effectively a
+* file offset (dataOffset + index * sizeof(T)), and the tree can be used
+* as soon as the file is mapped: opening an index of any size is O(1) and
+* pages are faulted in as lookups touch them.
+*
+* Nodes are stored as raw bytes, so T must be built from trivially copyable
+* keys and values (no std::string, no pointers into the heap).
+*
+* The header is marked dirty before the first change after opening or
+* syncing (including any non-const operator[], which may write through the
+* node it returns) and marked clean again by sync() and close(), after the
+* nodes are on disk. A crash in between leaves a half-rotated tree, so
+* open() refuses a dirty file: only the state as of the last sync() or
+* close() can be reopened.
+*/
+template <typename T>
+class MappedArena
+{
+public:
+    static const size_t dataOffset = 64;
+    static const uint32_t formatVersion = 1;
+
+    MappedArena();
+    ~MappedArena();
+
+    void open(const std::string& path);
+    void close();
+    void sync();
+    bool isOpen() const;
+
+    uint32_t size() const;
+    uint32_t capacity() const;
+    void reserve(uint32_t capacity);
+    void clear();
+
+    uint32_t getRoot() const;
+    void setRoot(uint32_t root);
+
+    T& operator[](uint32_t index);
+    const T& operator[](uint32_t index) const;
+
+    template<typename... Args>
+    uint32_t emplace(Args&&... args);
+    uint32_t erase(uint32_t index);
+    void permute(const std::vector<uint32_t>& order);
+
+private:
+    MappedArena(const MappedArena&);
+    MappedArena& operator=(const MappedArena&);
+
+    void map(size_t length);
+    void markDirty();
+    MappedArenaHeader* header() const;
+    T* data() const;
+    void fail(const char* what) const;
+    void release();
+    void reject(const std::string& path, const char* why);
+
+    int fd_;
+    char* base_;
+    size_t length_;
+    // mirrors the dirty flag of the header, to skip re-marking it
+    bool dirty_;
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the MappedArena class.
+  ---------------------------------------------
+*/
+
+template<typename T>
+const size_t MappedArena<T>::dataOffset;
+
+template<typename T>
+const uint32_t MappedArena<T>::formatVersion;
+
+template<typename T>
+MappedArena<T>::MappedArena() :
+    fd_(-1),
+    base_(nullptr),
+    length_(0),
+    dirty_(false)
+{
+
+}
+
+/**
+* Closes the file like close(). Errors cannot be reported from here, so a
+* failed sync leaves the file marked dirty; call close() to see them.
+*/
+template<typename T>
+MappedArena<T>::~MappedArena()
+{
+    try{
+        close();
+    }
+    catch(const std::exception&){
+        // the header still says dirty, so the next open() refuses the file
+    }
+}
+
+/**
+* Maps the arena file at path, creating an empty one if it does not exist.
+* Throws std::runtime_error if the file exists but was written by an
+* incompatible node layout, if its header is inconsistent with the file,
+* or if it was changed and never synced or closed (e.g. the process
+* crashed), in which case the nodes may be half updated.
+*/
+template<typename T>
+void MappedArena<T>::open(const std::string& path)
+{
+    close();
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd_ < 0){
+        fail("open");
+    }
+    struct stat st;
+    if(::fstat(fd_, &st) != 0){
+        fail("fstat");
+    }
+
+    // new file: write a header describing an empty tree
+    if(st.st_size == 0){
+        if(::ftruncate(fd_, dataOffset) != 0){
+            fail("ftruncate");
+        }
+        map(dataOffset);
+        MappedArenaHeader* h = header();
+        std::memcpy(h->magic, "AVLMMAP", 8);
+        h->version = formatVersion;
+        h->nodeSize = sizeof(T);
+        h->size = 0;
+        h->capacity = 0;
+        h->root = 0xFFFFFFFFu;
+        h->flags = 0;
+        return;
+    }
+
+    if(static_cast<size_t>(st.st_size) < dataOffset){
+        reject(path, "is not an arena file");
+    }
+    map(static_cast<size_t>(st.st_size));
+    MappedArenaHeader* h = header();
+    if(std::memcmp(h->magic, "AVLMMAP", 8) != 0 || h->version != formatVersion
+       || h->nodeSize != sizeof(T)){
+        reject(path, "has an incompatible layout");
+    }
+    // every index the tree may follow must land inside the mapping
+    if(h->capacity > 0xFFFFFFFEu || h->size > h->capacity
+       || h->capacity * sizeof(T) > length_ - dataOffset
+       || (h->root != 0xFFFFFFFFu && h->root >= h->size)
+       || (h->root == 0xFFFFFFFFu && h->size != 0)){
+        reject(path, "has a corrupt header");
+    }
+    if(h->flags & MappedArenaHeader::dirty){
+        reject(path, "was modified and not synced; it may be inconsistent");
+    }
+}
+
+/**
+* Syncs any changes (see sync()) and unmaps the file.
+*/
+template<typename T>
+void MappedArena<T>::close()
+{
+    try{
+        sync();
+    }
+    catch(...){
+        release();
+        throw;
+    }
+    release();
+}
+
+/**
+* Flushes every dirty page of the mapping to disk, then marks the header
+* clean and flushes it too, so the clean flag never reaches the disk
+* before the nodes it vouches for.
+*/
+template<typename T>
+void MappedArena<T>::sync()
+{
+    if(base_ == nullptr || !dirty_){
+        return;
+    }
+    if(::msync(base_, length_, MS_SYNC) != 0){
+        fail("msync");
+    }
+    header()->flags &= ~MappedArenaHeader::dirty;
+    if(::msync(base_, dataOffset, MS_SYNC) != 0){
+        fail("msync");
+    }
+    dirty_ = false;
+}
+
+template<typename T>
+bool MappedArena<T>::isOpen() const
+{
+    return base_ != nullptr;
+}
+
+template<typename T>
+uint32_t MappedArena<T>::size() const
+{
+    return base_ == nullptr ? 0 : static_cast<uint32_t>(header()->size);
+}
+
+template<typename T>
+uint32_t MappedArena<T>::capacity() const
+{
+    return base_ == nullptr ? 0 : static_cast<uint32_t>(header()->capacity);
+}
+
+/**
+* Grows the file and remaps it. Nodes are addressed by index, so the
+* mapping moving to a new address does not invalidate any links.
+*/
+template<typename T>
+void MappedArena<T>::reserve(uint32_t capacity)
+{
+    if(base_ == nullptr){
+        throw std::logic_error("MappedArena: reserve() before open()");
+    }
+    if(capacity <= header()->capacity){
+        return;
+    }
+    markDirty();
+    size_t length = dataOffset + static_cast<size_t>(capacity) * sizeof(T);
+    if(::ftruncate(fd_, static_cast<off_t>(length)) != 0){
+        fail("ftruncate");
+    }
+    ::munmap(base_, length_);
+    base_ = nullptr;
+    map(length);
+    header()->capacity = capacity;
+}
+
+/**
+* Empties the tree. The file keeps its size so that refilling it does not
+* need to grow the mapping again.
+*/
+template<typename T>
+void MappedArena<T>::clear()
+{
+    if(base_ != nullptr){
+        markDirty();
+        header()->size = 0;
+        header()->root = 0xFFFFFFFFu;
+    }
+}
+
+template<typename T>
+uint32_t MappedArena<T>::getRoot() const
+{
+    return base_ == nullptr ? 0xFFFFFFFFu : header()->root;
+}
+
+template<typename T>
+void MappedArena<T>::setRoot(uint32_t root)
+{
+    markDirty();
+    header()->root = root;
+}
+
+template<typename T>
+T& MappedArena<T>::operator[](uint32_t index)
+{
+    markDirty();
+    return data()[index];
+}
+
+template<typename T>
+const T& MappedArena<T>::operator[](uint32_t index) const
+{
+    return data()[index];
+}
+
+template<typename T>
+template<typename... Args>
+uint32_t MappedArena<T>::emplace(Args&&... args)
+{
+    uint32_t size = this->size();
+    if(size == 0xFFFFFFFEu){
+        throw std::length_error("MappedArena is full");
+    }
+    if(size == capacity()){
+        uint32_t current = capacity();
+        uint32_t grown = current < 1024 ? 1024 : current + current / 2;
+        if(grown < current || grown > 0xFFFFFFFEu){
+            grown = 0xFFFFFFFEu;
+        }
+        reserve(grown);
+    }
+    markDirty();
+    new (data() + size) T(std::forward<Args>(args)...);
+    header()->size = size + 1;
+    return size;
+}
+
+/**
+* Same contract as NodeArena::erase: the last node fills the hole and its
+* old index is returned.
+*/
+template<typename T>
+uint32_t MappedArena<T>::erase(uint32_t index)
+{
+    markDirty();
+    uint32_t last = size() - 1;
+    if(index != last){
+        std::memcpy(static_cast<void*>(data() + index), data() + last, sizeof(T));
+    }
+    header()->size = last;
+    return last;
+}
+
+/**
+* Same contract as NodeArena::permute. Works in place by following the
+* cycles of the permutation, so no second copy of the file is needed.
+*/
+template<typename T>
+void MappedArena<T>::permute(const std::vector<uint32_t>& order)
+{
+    markDirty();
+    uint32_t count = size();
+    std::vector<bool> done(count, false);
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type held;
+    for(uint32_t start = 0; start < count; ++start){
+        if(done[start] || order[start] == start){
+            continue;
+        }
+        // slot start is overwritten first, so set its node aside
+        std::memcpy(&held, data() + start, sizeof(T));
+        uint32_t slot = start;
+        while(order[slot] != start){
+            std::memcpy(static_cast<void*>(data() + slot), data() + order[slot], sizeof(T));
+            done[slot] = true;
+            slot = order[slot];
+        }
+        std::memcpy(static_cast<void*>(data() + slot), &held, sizeof(T));
+        done[slot] = true;
+    }
+}
+
+template<typename T>
+void MappedArena<T>::map(size_t length)
+{
+    void* base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if(base == MAP_FAILED){
+        fail("mmap");
+    }
+    base_ = static_cast<char*>(base);
+    length_ = length;
+}
+
+/**
+* Sets the dirty flag before the first change since the last sync, and
+* makes sure it is on disk before any changed node can be.
+*/
+template<typename T>
+void MappedArena<T>::markDirty()
+{
+    if(dirty_){
+        return;
+    }
+    header()->flags |= MappedArenaHeader::dirty;
+    if(::msync(base_, dataOffset, MS_SYNC) != 0){
+        fail("msync");
+    }
+    dirty_ = true;
+}
+
+template<typename T>
+MappedArenaHeader* MappedArena<T>::header() const
+{
+    return reinterpret_cast<MappedArenaHeader*>(base_);
+}
+
+template<typename T>
+T* MappedArena<T>::data() const
+{
+    return reinterpret_cast<T*>(base_ + dataOffset);
+}
+
+template<typename T>
+void MappedArena<T>::fail(const char* what) const
+{
+    throw std::runtime_error(std::string("MappedArena: ") + what + ": " + std::strerror(errno));
+}
+
+// unmaps and closes the file as it is
+template<typename T>
+void MappedArena<T>::release()
+{
+    if(base_ != nullptr){
+        ::munmap(base_, length_);
+        base_ = nullptr;
+        length_ = 0;
+    }
+    if(fd_ >= 0){
+        ::close(fd_);
+        fd_ = -1;
+    }
+    dirty_ = false;
+}
+
+// leaves the file untouched and reports why it was not opened
+template<typename T>
+void MappedArena<T>::reject(const std::string& path, const char* why)
+{
+    release();
+    throw std::runtime_error("MappedArena: " + path + " " + why);
+}
+
+/*
+  -------------------------------------------
+  End implementations for the MappedArena class.
+  -------------------------------------------
+*/
+
+/**
+* A CompactAVLTree persisted in a memory-mapped file. Constructing one over
+* an existing file reopens the tree in O(1) without deserializing anything;
+* the same rotation and balance code as CompactAVLTree runs directly over
+* the file-backed nodes. Call sync() to make changes durable; the file can
+* only be reopened as of the last sync() or clean close (see MappedArena).
+*/
+template <typename Key, typename Value>
+class MappedAVLTree : public CompactAVLTree<Key, Value, MappedArena<CompactAVLNode<Key, Value> > >
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "MappedAVLTree stores raw node bytes; Key and Value must be trivially copyable");
+public:
+    explicit MappedAVLTree(const std::string& path);
+    void sync();
+};
+
+template<class Key, class Value>
+MappedAVLTree<Key, Value>::MappedAVLTree(const std::string& path)
+{
+    this->nodes_.open(path);
+}
+
+/**
+* Flushes all changes made so far with msync.
+*/
+template<class Key, class Value>
+void MappedAVLTree<Key, Value>::sync()
+{
+    this->nodes_.sync();
+}
+
+#endif
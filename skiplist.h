@@ -0,0 +1,836 @@
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <atomic>
+
+/**
+* A lock-free ordered map with the insert/remove/find/iterator interface
+* of BinarySearchTree, for write-heavy ingest from many threads: where a
+* balanced tree has to lock around rotations that reach up to its root,
+* a skip list changes only the links next to the key, each with a single
+* compare-and-swap, so writers to different keys do not wait on each
+* other.
+*
+* Every node is on level 0 and, with probability 1/2 per level, on the
+* levels above, each a sorted linked list that skips more of the one
+* below. A node is removed by marking the low bit of its links, top
+* level first; level 0 decides who removed it, and any thread that walks
+* past a marked link unlinks it (Harris, Herlihy and Shavit).
+*
+* insert(), remove(), find(), operator[], begin(), end() and the
+* iterators may be called from any number of threads at once. Searches
+* are linearizable; iteration is weakly consistent: it sees every entry
+* present for the whole walk and may or may not see entries added or
+* removed meanwhile. The items are immutable once published (insert() on
+* an existing key swaps in a new item), so a reader never sees a value
+* half written; writing through an iterator is the caller's to
+* synchronize.
+*
+* Removed nodes and replaced items are freed with epoch-based
+* reclamation. Every call pins the calling thread to the current epoch
+* for its duration, and retires what it unlinks into the list of that
+* epoch. The epoch advances once every pinned thread has seen it, and
+* advancing frees whatever was retired two epochs before, which no
+* pinned thread can still reach. So at any time the memory held beyond
+* the live entries is what was retired during the last three epochs,
+* plus up to advanceEvery retirements per thread that have not tried to
+* advance yet. A thread that stays pinned holds the epoch back, and
+* retired memory grows until it unpins.
+*
+* An iterator or a reference from operator[] stays valid until its entry
+* is removed or overwritten, by any thread, and reclaimed. To use one
+* while other threads may do that, including to walk the list with
+* ++, hold a Guard for as long as the iterator or reference is used; it
+* pins the thread the same way a call does. clear() and the destructor
+* must not run concurrently with anything else.
+*/
+template <typename Key, typename Value>
+class LockFreeSkipList
+{
+public:
+    typedef std::pair<const Key, Value> Item;
+
+    LockFreeSkipList();
+    ~LockFreeSkipList();
+    void insert(const std::pair<const Key, Value>& new_item);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+
+protected:
+    struct Node;
+    struct ThreadRecord;
+    typedef std::atomic<uintptr_t> Link;
+
+public:
+    /**
+    * Pins the calling thread while it lives, so that nothing it can reach
+    * in the list is freed; see the class comment. Guards may nest.
+    */
+    class Guard
+    {
+    public:
+        explicit Guard(const LockFreeSkipList& list);
+        ~Guard();
+
+    private:
+        Guard(const Guard&);
+        Guard& operator=(const Guard&);
+
+        const LockFreeSkipList& list_;
+        ThreadRecord* record_;
+    };
+
+    /**
+    * An iterator over the list in key order, skipping removed entries.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class LockFreeSkipList<Key, Value>;
+        explicit iterator(Node* current);
+        Node* current_;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    static const unsigned maxHeight = 32;
+    // retirements by one thread between attempts to advance the epoch
+    static const unsigned advanceEvery = 64;
+    static const uint64_t unpinned = UINT64_MAX;
+
+    /**
+    * An item and the link that puts it on a retire list once replaced.
+    */
+    struct Entry
+    {
+        explicit Entry(const Item& item);
+
+        Item item;
+        Entry* retiredNext;
+    };
+
+    /**
+    * A node and, right behind it, its height links; the key is a copy of
+    * the item's so that searches never follow the entry pointer.
+    */
+    struct Node
+    {
+        Node(const Key& key, Entry* entry, unsigned height);
+
+        Link* next() { return reinterpret_cast<Link*>(this + 1); }
+
+        const Key key;
+        std::atomic<Entry*> entry;
+        const unsigned height;
+        // the inserter raising the node and its remover; whichever is done
+        // with it last retires it, so it is never linked again once retired
+        std::atomic<unsigned> owners;
+        // links the node into a retire list once removed
+        Node* retiredNext;
+    };
+
+    /**
+    * One pin on the list. A pin claims a free record and frees it again
+    * when it ends, so there are only ever as many records as pins were
+    * held at once; they are kept until the list is destroyed.
+    */
+    struct ThreadRecord
+    {
+        ThreadRecord();
+
+        // the epoch the holder is pinned to, or unpinned
+        std::atomic<uint64_t> epoch;
+        std::atomic<bool> inUse;
+        ThreadRecord* next;
+    };
+
+    static Node* pointer(uintptr_t link) { return reinterpret_cast<Node*>(link & ~uintptr_t(1)); }
+    static bool marked(uintptr_t link) { return (link & 1) != 0; }
+    static uintptr_t linkTo(Node* node) { return reinterpret_cast<uintptr_t>(node); }
+
+    static Node* createNode(const Key& key, Entry* entry, unsigned height);
+    static void destroyNode(Node* node);
+    static unsigned randomHeight();
+
+    Node* search(const Key& key) const;
+    bool locate(const Key& key, Link** preds, Node** succs);
+    void release(Node* node);
+    void retire(Node* node);
+    void retire(Entry* entry);
+    void raise(Node* node, Link** preds, Node** succs);
+    ThreadRecord* claimRecord() const;
+    ThreadRecord* pin() const;
+    void unpin(ThreadRecord* rec) const;
+    void retired();
+    void tryAdvance();
+    void freeRetired(unsigned index);
+
+private:
+    LockFreeSkipList(const LockFreeSkipList&);
+    LockFreeSkipList& operator=(const LockFreeSkipList&);
+
+protected:
+    Link head_[maxHeight];
+    // levels in use; searches start at the highest
+    std::atomic<unsigned> height_;
+    std::atomic<uint64_t> epoch_;
+    // what was retired in each epoch, by epoch % 3
+    std::atomic<Node*> retiredNodes_[3];
+    std::atomic<Entry*> retiredEntries_[3];
+    mutable std::atomic<ThreadRecord*> records_;
+    // tells this list's records apart in the threads' caches
+    const uint64_t id_;
+    static std::atomic<uint64_t> nextId_;
+};
+
+/*
+  ------------------------------------------------------------
+  Begin implementations for the LockFreeSkipList::iterator class.
+  ------------------------------------------------------------
+*/
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::iterator::iterator() :
+    current_(nullptr)
+{
+
+}
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::iterator::iterator(Node* current) :
+    current_(current)
+{
+
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value>& LockFreeSkipList<Key, Value>::iterator::operator*() const
+{
+    return current_->entry.load()->item;
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value>* LockFreeSkipList<Key, Value>::iterator::operator->() const
+{
+    return &current_->entry.load()->item;
+}
+
+template<class Key, class Value>
+bool LockFreeSkipList<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value>
+bool LockFreeSkipList<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+// the next node on level 0 that is not being removed
+template<class Key, class Value>
+typename LockFreeSkipList<Key, Value>::iterator& LockFreeSkipList<Key, Value>::iterator::operator++()
+{
+    do{
+        current_ = pointer(current_->next()[0].load());
+    } while(current_ != nullptr && marked(current_->next()[0].load()));
+    return *this;
+}
+
+/*
+  ----------------------------------------------------------
+  End implementations for the LockFreeSkipList::iterator class.
+  ----------------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the LockFreeSkipList class.
+  ---------------------------------------------------
+*/
+
+template<class Key, class Value>
+const unsigned LockFreeSkipList<Key, Value>::maxHeight;
+
+template<class Key, class Value>
+const unsigned LockFreeSkipList<Key, Value>::advanceEvery;
+
+template<class Key, class Value>
+const uint64_t LockFreeSkipList<Key, Value>::unpinned;
+
+template<class Key, class Value>
+std::atomic<uint64_t> LockFreeSkipList<Key, Value>::nextId_(1);
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::Guard::Guard(const LockFreeSkipList& list) :
+    list_(list),
+    record_(list.pin())
+{
+
+}
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::Guard::~Guard()
+{
+    list_.unpin(record_);
+}
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::Entry::Entry(const Item& item) :
+    item(item),
+    retiredNext(nullptr)
+{
+
+}
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::Node::Node(const Key& key, Entry* entry, unsigned height) :
+    key(key),
+    entry(entry),
+    height(height),
+    owners(2),
+    retiredNext(nullptr)
+{
+    for(unsigned i = 0; i < height; ++i){
+        new (next() + i) Link(0);
+    }
+}
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::ThreadRecord::ThreadRecord() :
+    epoch(unpinned),
+    inUse(false),
+    next(nullptr)
+{
+
+}
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::LockFreeSkipList() :
+    height_(1),
+    epoch_(0),
+    records_(nullptr),
+    id_(nextId_++)
+{
+    for(unsigned i = 0; i < maxHeight; ++i){
+        head_[i].store(0);
+    }
+    for(unsigned i = 0; i < 3; ++i){
+        retiredNodes_[i].store(nullptr);
+        retiredEntries_[i].store(nullptr);
+    }
+}
+
+template<class Key, class Value>
+LockFreeSkipList<Key, Value>::~LockFreeSkipList()
+{
+    clear();
+    ThreadRecord* rec = records_.load();
+    while(rec != nullptr){
+        ThreadRecord* next = rec->next;
+        delete rec;
+        rec = next;
+    }
+}
+
+template<class Key, class Value>
+typename LockFreeSkipList<Key, Value>::Node*
+LockFreeSkipList<Key, Value>::createNode(const Key& key, Entry* entry, unsigned height)
+{
+    void* memory = ::operator new(sizeof(Node) + height * sizeof(Link));
+    try{
+        return new (memory) Node(key, entry, height);
+    }
+    catch(...){
+        ::operator delete(memory);
+        throw;
+    }
+}
+
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::destroyNode(Node* node)
+{
+    delete node->entry.load();
+    node->~Node();
+    ::operator delete(node);
+}
+
+/**
+* 1 plus the number of heads in a row of a per-thread coin.
+*/
+template<class Key, class Value>
+unsigned LockFreeSkipList<Key, Value>::randomHeight()
+{
+    static thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(&state);
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    uint64_t bits = state;
+    unsigned height = 1;
+    while(height < maxHeight && (bits & 1)){
+        height++;
+        bits >>= 1;
+    }
+    return height;
+}
+
+/**
+* Finds the node holding key, or nullptr, without unlinking anything; a
+* marked node is stepped over as if it were already gone.
+*/
+template<class Key, class Value>
+typename LockFreeSkipList<Key, Value>::Node* LockFreeSkipList<Key, Value>::search(const Key& key) const
+{
+    const Link* pred = head_;
+    Node* curr = nullptr;
+    for(int level = static_cast<int>(height_.load()) - 1; level >= 0; --level){
+        curr = pointer(pred[level].load());
+        while(curr != nullptr){
+            uintptr_t succ = curr->next()[level].load();
+            if(marked(succ)){
+                curr = pointer(succ);
+            }
+            else if(curr->key < key){
+                pred = curr->next();
+                curr = pointer(succ);
+            }
+            else{
+                break;
+            }
+        }
+    }
+    if(curr != nullptr && !(key < curr->key) && !marked(curr->next()[0].load())){
+        return curr;
+    }
+    return nullptr;
+}
+
+/**
+* Fills preds[level] with the links of the last node before key on each
+* level (head_ for none) and succs[level] with the node after them,
+* unlinking the marked nodes it passes; returns whether succs[0] holds
+* key. Starts over whenever another thread changed a link under it.
+*/
+template<class Key, class Value>
+bool LockFreeSkipList<Key, Value>::locate(const Key& key, Link** preds, Node** succs)
+{
+    unsigned top = height_.load();
+    // nobody links a node above the height it published first
+    for(unsigned level = top; level < maxHeight; ++level){
+        preds[level] = head_;
+        succs[level] = nullptr;
+    }
+retry:
+    Link* pred = head_;
+    for(int level = static_cast<int>(top) - 1; level >= 0; --level){
+        Node* curr = pointer(pred[level].load());
+        while(curr != nullptr){
+            uintptr_t succ = curr->next()[level].load();
+            if(marked(succ)){
+                uintptr_t expected = linkTo(curr);
+                if(!pred[level].compare_exchange_strong(expected, linkTo(pointer(succ)))){
+                    goto retry;
+                }
+                curr = pointer(succ);
+            }
+            else if(curr->key < key){
+                pred = curr->next();
+                curr = pointer(succ);
+            }
+            else{
+                break;
+            }
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+    return succs[0] != nullptr && !(key < succs[0]->key);
+}
+
+/**
+* Called by the inserter once it stops raising node and by its remover
+* once it has unlinked it; the second call retires it.
+*/
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::release(Node* node)
+{
+    if(node->owners.fetch_sub(1) == 1){
+        retire(node);
+    }
+}
+
+/**
+* Puts an unlinked node on the retire list of the current epoch. The
+* caller is pinned, so the epoch is at most one ahead of its pin and
+* tryAdvance() cannot be freeing that list.
+*/
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::retire(Node* node)
+{
+    std::atomic<Node*>& list = retiredNodes_[epoch_.load() % 3];
+    Node* head = list.load();
+    do{
+        node->retiredNext = head;
+    } while(!list.compare_exchange_weak(head, node));
+    retired();
+}
+
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::retire(Entry* entry)
+{
+    std::atomic<Entry*>& list = retiredEntries_[epoch_.load() % 3];
+    Entry* head = list.load();
+    do{
+        entry->retiredNext = head;
+    } while(!list.compare_exchange_weak(head, entry));
+    retired();
+}
+
+/**
+* Claims a free record, trying first the one the calling thread used last
+* on this list, which no other thread normally goes for; allocates a new
+* record only when every existing one is held.
+*/
+template<class Key, class Value>
+typename LockFreeSkipList<Key, Value>::ThreadRecord* LockFreeSkipList<Key, Value>::claimRecord() const
+{
+    struct Slot
+    {
+        uint64_t list;
+        ThreadRecord* record;
+    };
+    // per thread, the last record claimed on each of the last few lists;
+    // ids are never reused, so a slot of a destroyed list never matches
+    static thread_local Slot cache[4];
+    static thread_local unsigned victim = 0;
+    Slot* slot = nullptr;
+    for(unsigned i = 0; i < 4; ++i){
+        if(cache[i].list == id_){
+            slot = &cache[i];
+            break;
+        }
+    }
+    bool expected = false;
+    if(slot != nullptr && slot->record->inUse.compare_exchange_strong(expected, true)){
+        return slot->record;
+    }
+    if(slot == nullptr){
+        slot = &cache[victim++ % 4];
+        slot->list = id_;
+    }
+    for(ThreadRecord* rec = records_.load(); rec != nullptr; rec = rec->next){
+        expected = false;
+        if(!rec->inUse.load() && rec->inUse.compare_exchange_strong(expected, true)){
+            slot->record = rec;
+            return rec;
+        }
+    }
+    ThreadRecord* rec = new ThreadRecord;
+    rec->inUse.store(true);
+    rec->next = records_.load();
+    while(!records_.compare_exchange_weak(rec->next, rec)){
+    }
+    slot->record = rec;
+    return rec;
+}
+
+/**
+* Publishes the current epoch as the one the thread is pinned to. The
+* store is sequentially consistent with every link the thread reads next.
+* Nested pins each hold their own record.
+*/
+template<class Key, class Value>
+typename LockFreeSkipList<Key, Value>::ThreadRecord* LockFreeSkipList<Key, Value>::pin() const
+{
+    ThreadRecord* rec = claimRecord();
+    rec->epoch.store(epoch_.load());
+    return rec;
+}
+
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::unpin(ThreadRecord* rec) const
+{
+    rec->epoch.store(unpinned);
+    rec->inUse.store(false);
+}
+
+/**
+* Counts the calling thread's retirements, on any list, and tries to
+* advance the epoch every advanceEvery of them.
+*/
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::retired()
+{
+    static thread_local unsigned retires = 0;
+    if(++retires % advanceEvery == 0){
+        tryAdvance();
+    }
+}
+
+/**
+* Advances the epoch if every pinned thread has seen the current one, and
+* frees what was retired two epochs before the new one. The caller is
+* pinned, so the epoch cannot move on again before it returns and that
+* list gets no new entries meanwhile.
+*/
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::tryAdvance()
+{
+    uint64_t epoch = epoch_.load();
+    for(ThreadRecord* rec = records_.load(); rec != nullptr; rec = rec->next){
+        uint64_t pinned = rec->epoch.load();
+        if(pinned != unpinned && pinned != epoch){
+            return;
+        }
+    }
+    if(epoch_.compare_exchange_strong(epoch, epoch + 1)){
+        freeRetired((epoch + 2) % 3);
+    }
+}
+
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::freeRetired(unsigned index)
+{
+    Node* node = retiredNodes_[index].exchange(nullptr);
+    while(node != nullptr){
+        Node* next = node->retiredNext;
+        destroyNode(node);
+        node = next;
+    }
+    Entry* entry = retiredEntries_[index].exchange(nullptr);
+    while(entry != nullptr){
+        Entry* next = entry->retiredNext;
+        delete entry;
+        entry = next;
+    }
+}
+
+/**
+* Inserts a new item, or replaces the item of an existing key. The node
+* is published on level 0 with one compare-and-swap, which is when it
+* becomes visible, and then raised level by level.
+*/
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    Guard guard(*this);
+    Link* preds[maxHeight];
+    Node* succs[maxHeight];
+    Entry* entry = new Entry(new_item);
+    Node* node = nullptr;
+    while(true){
+        if(locate(new_item.first, preds, succs)){
+            if(node != nullptr){
+                node->entry.store(nullptr);
+                destroyNode(node);
+            }
+            retire(succs[0]->entry.exchange(entry));
+            return;
+        }
+        if(node == nullptr){
+            try{
+                node = createNode(new_item.first, entry, randomHeight());
+            }
+            catch(...){
+                delete entry;
+                throw;
+            }
+        }
+        for(unsigned level = 0; level < node->height; ++level){
+            node->next()[level].store(linkTo(succs[level]));
+        }
+        uintptr_t expected = linkTo(succs[0]);
+        if(preds[0][0].compare_exchange_strong(expected, linkTo(node))){
+            break;
+        }
+    }
+
+    raise(node, preds, succs);
+    if(marked(node->next()[0].load())){
+        // the remover may have unlinked it before a level linked above
+        locate(new_item.first, preds, succs);
+    }
+    release(node);
+}
+
+/**
+* Links a just published node into its levels above 0, bottom up, given
+* the preds and succs its insert located. Gives up once it is removed.
+*/
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::raise(Node* node, Link** preds, Node** succs)
+{
+    unsigned height = height_.load();
+    while(height < node->height && !height_.compare_exchange_weak(height, node->height)){
+    }
+    for(unsigned level = 1; level < node->height; ++level){
+        while(true){
+            uintptr_t mine = node->next()[level].load();
+            if(marked(mine)){
+                // being removed already; no point raising it further
+                return;
+            }
+            if(pointer(mine) != succs[level] &&
+               !node->next()[level].compare_exchange_strong(mine, linkTo(succs[level]))){
+                continue;
+            }
+            uintptr_t expected = linkTo(succs[level]);
+            if(preds[level][level].compare_exchange_strong(expected, linkTo(node))){
+                break;
+            }
+            if(!locate(node->key, preds, succs) || succs[0] != node){
+                return;
+            }
+        }
+    }
+}
+
+/**
+* Marks the node of key from its top level down; the thread whose mark
+* on level 0 lands has removed it and unlinks it everywhere. It is
+* retired once its inserter has stopped raising it too.
+*/
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::remove(const Key& key)
+{
+    Guard guard(*this);
+    Link* preds[maxHeight];
+    Node* succs[maxHeight];
+    if(!locate(key, preds, succs)){
+        return;
+    }
+    Node* node = succs[0];
+    for(unsigned level = node->height - 1; level > 0; --level){
+        uintptr_t link = node->next()[level].load();
+        while(!marked(link) && !node->next()[level].compare_exchange_weak(link, link | 1)){
+        }
+    }
+    uintptr_t link = node->next()[0].load();
+    while(true){
+        if(marked(link)){
+            return;
+        }
+        if(node->next()[0].compare_exchange_weak(link, link | 1)){
+            locate(key, preds, succs);
+            release(node);
+            return;
+        }
+    }
+}
+
+/**
+* Frees every node, removed or not, and every replaced item. Not safe to
+* call while other threads use the list.
+*/
+template<class Key, class Value>
+void LockFreeSkipList<Key, Value>::clear()
+{
+    // removed nodes are freed from the retire lists, even if still linked
+    Node* curr = pointer(head_[0].load());
+    while(curr != nullptr){
+        Node* next = pointer(curr->next()[0].load());
+        if(!marked(curr->next()[0].load())){
+            destroyNode(curr);
+        }
+        curr = next;
+    }
+    for(unsigned i = 0; i < maxHeight; ++i){
+        head_[i].store(0);
+    }
+    height_.store(1);
+
+    for(unsigned i = 0; i < 3; ++i){
+        freeRetired(i);
+    }
+}
+
+template<class Key, class Value>
+bool LockFreeSkipList<Key, Value>::empty() const
+{
+    Guard guard(*this);
+    return begin() == end();
+}
+
+template<class Key, class Value>
+typename LockFreeSkipList<Key, Value>::iterator LockFreeSkipList<Key, Value>::begin() const
+{
+    Guard guard(*this);
+    Node* first = pointer(head_[0].load());
+    while(first != nullptr && marked(first->next()[0].load())){
+        first = pointer(first->next()[0].load());
+    }
+    return iterator(first);
+}
+
+template<class Key, class Value>
+typename LockFreeSkipList<Key, Value>::iterator LockFreeSkipList<Key, Value>::end() const
+{
+    return iterator(nullptr);
+}
+
+template<class Key, class Value>
+typename LockFreeSkipList<Key, Value>::iterator LockFreeSkipList<Key, Value>::find(const Key& key) const
+{
+    Guard guard(*this);
+    return iterator(search(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& LockFreeSkipList<Key, Value>::operator[](const Key& key)
+{
+    Guard guard(*this);
+    Node* node = search(key);
+    if(node == nullptr){
+        throw std::out_of_range("Invalid key");
+    }
+    return node->entry.load()->item.second;
+}
+
+template<class Key, class Value>
+Value const & LockFreeSkipList<Key, Value>::operator[](const Key& key) const
+{
+    Guard guard(*this);
+    Node* node = search(key);
+    if(node == nullptr){
+        throw std::out_of_range("Invalid key");
+    }
+    return node->entry.load()->item.second;
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the LockFreeSkipList class.
+  -------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,364 @@
+#ifndef SPLITAVL_H
+#define SPLITAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+#include "avlbst.h"
+
+/**
+* A pool of T with stable addresses. Objects are carved out of blocks of
+* slotsPerBlock slots, so items created together sit together in memory,
+* and freed slots are reused through a free list threaded through them.
+* The pool never runs destructors on its own: every create() must be
+* matched by a destroy() before the pool goes away.
+*/
+template <typename T>
+class ValueSlab
+{
+public:
+    ValueSlab();
+    ~ValueSlab();
+
+    template<typename... Args>
+    T* create(Args&&... args);
+    void destroy(T* item);
+
+private:
+    ValueSlab(const ValueSlab&);
+    ValueSlab& operator=(const ValueSlab&);
+
+    union Slot
+    {
+        Slot* next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    static const size_t slotsPerBlock = 256;
+
+    std::vector<Slot*> blocks_;
+    // slots never handed out yet, at the end of the newest block
+    size_t unused_;
+    Slot* free_;
+};
+
+/*
+  -------------------------------------------
+  Begin implementations for the ValueSlab class.
+  -------------------------------------------
+*/
+
+template<typename T>
+const size_t ValueSlab<T>::slotsPerBlock;
+
+template<typename T>
+ValueSlab<T>::ValueSlab() :
+    unused_(0),
+    free_(nullptr)
+{
+
+}
+
+template<typename T>
+ValueSlab<T>::~ValueSlab()
+{
+    for(size_t i = 0; i < blocks_.size(); ++i){
+        ::operator delete(blocks_[i]);
+    }
+}
+
+template<typename T>
+template<typename... Args>
+T* ValueSlab<T>::create(Args&&... args)
+{
+    Slot* slot = free_;
+    if(slot != nullptr){
+        free_ = slot->next;
+    }
+    else{
+        if(unused_ == 0){
+            blocks_.push_back(static_cast<Slot*>(::operator new(sizeof(Slot) * slotsPerBlock)));
+            unused_ = slotsPerBlock;
+        }
+        slot = blocks_.back() + (slotsPerBlock - unused_);
+        unused_--;
+    }
+    try{
+        return new (&slot->storage) T(std::forward<Args>(args)...);
+    }
+    catch(...){
+        slot->next = free_;
+        free_ = slot;
+        throw;
+    }
+}
+
+template<typename T>
+void ValueSlab<T>::destroy(T* item)
+{
+    item->~T();
+    Slot* slot = reinterpret_cast<Slot*>(item);
+    slot->next = free_;
+    free_ = slot;
+}
+
+/*
+  -----------------------------------------
+  End implementations for the ValueSlab class.
+  -----------------------------------------
+*/
+
+/**
+* An AVL tree with the public interface and iterator semantics of
+* AVLTree, laid out so that searches only touch keys. The search nodes
+* are those of an AVLTree<Key, Item*>: key, links, balance and one
+* pointer. The items, with the values, live apart in a ValueSlab, so a
+* descent through nodes whose values are large pulls in the same few
+* cache lines per node as one with small values, and more of the top of
+* the tree stays cached.
+*
+* Items do not move once created, so iterators and references stay
+* valid until their own entry is removed, as with AVLTree. The price is
+* a second copy of every key (one in the node, one in the item) and one
+* extra pointer hop when the value is actually read.
+*/
+template <class Key, class Value>
+class SplitAVLTree
+{
+public:
+    typedef std::pair<const Key, Value> Item;
+
+    SplitAVLTree();
+    ~SplitAVLTree();
+    void insert(const std::pair<const Key, Value>& new_item);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+
+public:
+    /**
+    * An iterator over the tree in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class SplitAVLTree<Key, Value>;
+        explicit iterator(const typename AVLTree<Key, Item*>::iterator& current);
+        typename AVLTree<Key, Item*>::iterator current_;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    void findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+private:
+    SplitAVLTree(const SplitAVLTree&);
+    SplitAVLTree& operator=(const SplitAVLTree&);
+
+protected:
+    AVLTree<Key, Item*> index_;
+    ValueSlab<Item> values_;
+};
+
+/*
+  ----------------------------------------------------------
+  Begin implementations for the SplitAVLTree::iterator class.
+  ----------------------------------------------------------
+*/
+
+template<class Key, class Value>
+SplitAVLTree<Key, Value>::iterator::iterator()
+{
+
+}
+
+template<class Key, class Value>
+SplitAVLTree<Key, Value>::iterator::iterator(const typename AVLTree<Key, Item*>::iterator& current) :
+    current_(current)
+{
+
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value>& SplitAVLTree<Key, Value>::iterator::operator*() const
+{
+    return *current_->second;
+}
+
+template<class Key, class Value>
+std::pair<const Key,Value>* SplitAVLTree<Key, Value>::iterator::operator->() const
+{
+    return current_->second;
+}
+
+template<class Key, class Value>
+bool SplitAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value>
+bool SplitAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+template<class Key, class Value>
+typename SplitAVLTree<Key, Value>::iterator& SplitAVLTree<Key, Value>::iterator::operator++()
+{
+    ++current_;
+    return *this;
+}
+
+/*
+  --------------------------------------------------------
+  End implementations for the SplitAVLTree::iterator class.
+  --------------------------------------------------------
+*/
+
+/*
+  -------------------------------------------------
+  Begin implementations for the SplitAVLTree class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+SplitAVLTree<Key, Value>::SplitAVLTree()
+{
+
+}
+
+template<class Key, class Value>
+SplitAVLTree<Key, Value>::~SplitAVLTree()
+{
+    clear();
+}
+
+/**
+* Inserts a new item, or overwrites the value of an existing key in
+* place.
+*/
+template<class Key, class Value>
+void SplitAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    typename AVLTree<Key, Item*>::iterator it = index_.find(new_item.first);
+    if(it != index_.end()){
+        it->second->second = new_item.second;
+        return;
+    }
+    Item* item = values_.create(new_item.first, new_item.second);
+    try{
+        index_.insert(std::make_pair(new_item.first, item));
+    }
+    catch(...){
+        values_.destroy(item);
+        throw;
+    }
+}
+
+template<class Key, class Value>
+void SplitAVLTree<Key, Value>::remove(const Key& key)
+{
+    typename AVLTree<Key, Item*>::iterator it = index_.find(key);
+    if(it == index_.end()){
+        return;
+    }
+    Item* item = it->second;
+    index_.remove(key);
+    values_.destroy(item);
+}
+
+template<class Key, class Value>
+void SplitAVLTree<Key, Value>::clear()
+{
+    for(typename AVLTree<Key, Item*>::iterator it = index_.begin(); it != index_.end(); ++it){
+        values_.destroy(it->second);
+    }
+    index_.clear();
+}
+
+template<class Key, class Value>
+bool SplitAVLTree<Key, Value>::isBalanced() const
+{
+    return index_.isBalanced();
+}
+
+template<class Key, class Value>
+bool SplitAVLTree<Key, Value>::empty() const
+{
+    return index_.empty();
+}
+
+template<class Key, class Value>
+typename SplitAVLTree<Key, Value>::iterator SplitAVLTree<Key, Value>::begin() const
+{
+    return iterator(index_.begin());
+}
+
+template<class Key, class Value>
+typename SplitAVLTree<Key, Value>::iterator SplitAVLTree<Key, Value>::end() const
+{
+    return iterator(index_.end());
+}
+
+template<class Key, class Value>
+typename SplitAVLTree<Key, Value>::iterator SplitAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(index_.find(key));
+}
+
+/**
+* Batched find(), see BinarySearchTree::findBatch(); only the key nodes
+* are touched until a caller dereferences a result.
+*/
+template<class Key, class Value>
+void SplitAVLTree<Key, Value>::findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    std::vector<typename AVLTree<Key, Item*>::iterator> found;
+    index_.findBatch(keys, found);
+    out.resize(found.size());
+    for(size_t i = 0; i < found.size(); ++i){
+        out[i] = iterator(found[i]);
+    }
+}
+
+template<class Key, class Value>
+Value& SplitAVLTree<Key, Value>::operator[](const Key& key)
+{
+    return index_[key]->second;
+}
+
+template<class Key, class Value>
+Value const & SplitAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    return index_[key]->second;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the SplitAVLTree class.
+  -----------------------------------------------
+*/
+
+#endif
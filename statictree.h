@@ -0,0 +1,311 @@
+#ifndef STATICTREE_H
+#define STATICTREE_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+// Compile-time search trees
+//
+// StaticTree is an immutable ordered map for tables known when the
+// program is built (error codes, enum names, config keys). It is made
+// from a sorted constexpr array and lays its entries out in Eytzinger
+// order (the root first, then each level left to right, the children of
+// position k at 2k and 2k+1) entirely at compile time, so a constexpr
+// StaticTree is constant-initialized into read-only data: no startup
+// work, no heap. Lookups walk the implicit tree without pointers, and
+// the top levels, shared by every lookup, sit together at the front.
+//
+//   constexpr std::pair<const int, const char*> errnoNames[] = {
+//       { 1, "EPERM" }, { 2, "ENOENT" }, { 3, "ESRCH" } };
+//   constexpr auto errnoTable = makeStaticTree(errnoNames);
+//   errnoTable.find(2)->second;            // "ENOENT"
+//   static_assert(errnoTable[3][0] == 'E', "");
+//
+// find(), lower_bound(), operator[] and the iterators follow
+// BinarySearchTree (lower_bound as in std::map), and find(), lower_bound()
+// and operator[] are also usable in constant expressions. Key needs a
+// constexpr operator<. The source must be sorted with unique keys; this
+// is checked at compile time for a constexpr tree and throws
+// std::invalid_argument otherwise. Every helper recurses only O(log N)
+// deep, so tables of many thousands of entries stay within the compiler's
+// constexpr and template depth limits.
+
+/*
+  -------------------------------------------------------
+  Begin implementations for the StaticTree layout helpers.
+  -------------------------------------------------------
+*/
+
+template <size_t... I>
+struct StaticTreeIndices
+{
+};
+
+template <class A, class B>
+struct StaticTreeConcat;
+
+template <size_t... I, size_t... J>
+struct StaticTreeConcat<StaticTreeIndices<I...>, StaticTreeIndices<J...> >
+{
+    typedef StaticTreeIndices<I..., (sizeof...(I) + J)...> type;
+};
+
+// 0 .. N-1, built by halving so the instantiation depth is log N
+template <size_t N>
+struct StaticTreeMakeIndices
+{
+    typedef typename StaticTreeConcat<typename StaticTreeMakeIndices<N / 2>::type,
+                                      typename StaticTreeMakeIndices<N - N / 2>::type>::type type;
+};
+
+template <>
+struct StaticTreeMakeIndices<0>
+{
+    typedef StaticTreeIndices<> type;
+};
+
+template <>
+struct StaticTreeMakeIndices<1>
+{
+    typedef StaticTreeIndices<0> type;
+};
+
+/**
+* Number of positions of an n entry Eytzinger layout in the subtree
+* whose leftmost position on the current level is first and which spans
+* width positions there (positions are 1-based).
+*/
+constexpr size_t staticTreeSubtree(size_t first, size_t width, size_t n)
+{
+    return first > n ? 0
+                     : (n - first + 1 < width ? n - first + 1 : width)
+                       + staticTreeSubtree(2 * first, 2 * width, n);
+}
+
+// entries sorted before the subtree rooted at position k
+constexpr size_t staticTreeBefore(size_t k, size_t n)
+{
+    return k == 1 ? 0
+                  : staticTreeBefore(k / 2, n)
+                    + (k % 2 == 0 ? 0 : staticTreeSubtree(k - 1, 1, n) + 1);
+}
+
+// index into the sorted source of the entry at position k
+constexpr size_t staticTreeRank(size_t k, size_t n)
+{
+    return staticTreeBefore(k, n) + staticTreeSubtree(2 * k, 1, n);
+}
+
+template <class Item>
+constexpr bool staticTreeSorted(const Item* items, size_t lo, size_t hi)
+{
+    return hi - lo < 2 ? true
+                       : staticTreeSorted(items, lo, lo + (hi - lo) / 2)
+                         && items[lo + (hi - lo) / 2 - 1].first < items[lo + (hi - lo) / 2].first
+                         && staticTreeSorted(items, lo + (hi - lo) / 2, hi);
+}
+
+/*
+  -----------------------------------------------------
+  End implementations for the StaticTree layout helpers.
+  -----------------------------------------------------
+*/
+
+/**
+* An immutable ordered map of N entries laid out at compile time; see
+* above.
+*/
+template <typename Key, typename Value, size_t N>
+class StaticTree
+{
+public:
+    typedef std::pair<const Key, Value> Item;
+
+    /**
+    * An iterator over the entries in key order.
+    */
+    class iterator
+    {
+    public:
+        constexpr iterator() : tree_(nullptr), pos_(0) {}
+
+        constexpr const Item& operator*() const { return tree_->layout_[pos_ - 1]; }
+        constexpr const Item* operator->() const { return &tree_->layout_[pos_ - 1]; }
+
+        constexpr bool operator==(const iterator& rhs) const { return pos_ == rhs.pos_; }
+        constexpr bool operator!=(const iterator& rhs) const { return pos_ != rhs.pos_; }
+
+        iterator& operator++();
+
+    private:
+        friend class StaticTree<Key, Value, N>;
+        constexpr iterator(const StaticTree<Key, Value, N>* tree, size_t pos) : tree_(tree), pos_(pos) {}
+
+        const StaticTree<Key, Value, N>* tree_;
+        // 1-based Eytzinger position, 0 for end()
+        size_t pos_;
+    };
+
+    constexpr explicit StaticTree(const Item (&sorted)[N]);
+
+    constexpr size_t size() const { return N; }
+
+    iterator begin() const;
+    constexpr iterator end() const { return iterator(this, 0); }
+    constexpr iterator find(const Key& key) const;
+    constexpr iterator lower_bound(const Key& key) const;
+    constexpr const Value& operator[](const Key& key) const;
+
+private:
+    template <size_t... I>
+    constexpr StaticTree(const Item* sorted, StaticTreeIndices<I...>);
+
+    static constexpr const Item* checked(const Item* sorted);
+    constexpr size_t descend(size_t k, const Key& key) const;
+    static constexpr size_t lastLeftTurn(size_t k);
+    constexpr iterator matchAt(size_t pos, const Key& key) const;
+    constexpr const Value& valueAt(size_t pos) const;
+
+    Item layout_[N];
+};
+
+/**
+* Makes a StaticTree of a sorted array, deducing its size.
+*/
+template <typename Key, typename Value, size_t N>
+constexpr StaticTree<Key, Value, N> makeStaticTree(const std::pair<const Key, Value> (&sorted)[N])
+{
+    return StaticTree<Key, Value, N>(sorted);
+}
+
+/*
+  -------------------------------------------------------
+  Begin implementations for the StaticTree::iterator class.
+  -------------------------------------------------------
+*/
+
+/**
+* In-order successor: the leftmost position of the right subtree if
+* there is one, otherwise the closest ancestor reached from its left.
+*/
+template<typename Key, typename Value, size_t N>
+typename StaticTree<Key, Value, N>::iterator& StaticTree<Key, Value, N>::iterator::operator++()
+{
+    if(2 * pos_ + 1 <= N){
+        pos_ = 2 * pos_ + 1;
+        while(2 * pos_ <= N){
+            pos_ = 2 * pos_;
+        }
+    }
+    else{
+        pos_ = StaticTree<Key, Value, N>::lastLeftTurn(pos_);
+    }
+    return *this;
+}
+
+/*
+  -----------------------------------------------------
+  End implementations for the StaticTree::iterator class.
+  -----------------------------------------------------
+*/
+
+/*
+  ----------------------------------------------
+  Begin implementations for the StaticTree class.
+  ----------------------------------------------
+*/
+
+template<typename Key, typename Value, size_t N>
+constexpr StaticTree<Key, Value, N>::StaticTree(const Item (&sorted)[N]) :
+    StaticTree(checked(sorted), typename StaticTreeMakeIndices<N>::type())
+{
+}
+
+template<typename Key, typename Value, size_t N>
+template <size_t... I>
+constexpr StaticTree<Key, Value, N>::StaticTree(const Item* sorted, StaticTreeIndices<I...>) :
+    layout_{ sorted[staticTreeRank(I + 1, N)]... }
+{
+}
+
+template<typename Key, typename Value, size_t N>
+constexpr const typename StaticTree<Key, Value, N>::Item* StaticTree<Key, Value, N>::checked(const Item* sorted)
+{
+    return staticTreeSorted(sorted, 0, N) ? sorted
+                                          : throw std::invalid_argument("StaticTree keys must be sorted and unique");
+}
+
+/**
+* Runs from position k to the bottom of the layout, going right past
+* keys smaller than key; the position returned has the path taken in
+* its bits.
+*/
+template<typename Key, typename Value, size_t N>
+constexpr size_t StaticTree<Key, Value, N>::descend(size_t k, const Key& key) const
+{
+    return k > N ? k : descend(2 * k + (layout_[k - 1].first < key ? 1 : 0), key);
+}
+
+/**
+* Undoes the trailing right turns of a path and the left turn before
+* them, giving the ancestor whose left subtree the path ended in (0 if
+* it only ever went right).
+*/
+template<typename Key, typename Value, size_t N>
+constexpr size_t StaticTree<Key, Value, N>::lastLeftTurn(size_t k)
+{
+    return k % 2 == 1 ? lastLeftTurn(k / 2) : k / 2;
+}
+
+// the entry at pos if it holds key, else end()
+template<typename Key, typename Value, size_t N>
+constexpr typename StaticTree<Key, Value, N>::iterator StaticTree<Key, Value, N>::matchAt(size_t pos, const Key& key) const
+{
+    return pos != 0 && !(key < layout_[pos - 1].first) ? iterator(this, pos) : end();
+}
+
+template<typename Key, typename Value, size_t N>
+constexpr const Value& StaticTree<Key, Value, N>::valueAt(size_t pos) const
+{
+    return pos != 0 ? layout_[pos - 1].second : throw std::out_of_range("Invalid key");
+}
+
+template<typename Key, typename Value, size_t N>
+typename StaticTree<Key, Value, N>::iterator StaticTree<Key, Value, N>::begin() const
+{
+    size_t pos = 1;
+    while(2 * pos <= N){
+        pos = 2 * pos;
+    }
+    return iterator(this, pos);
+}
+
+/**
+* The first entry whose key is not smaller than key, or end().
+*/
+template<typename Key, typename Value, size_t N>
+constexpr typename StaticTree<Key, Value, N>::iterator StaticTree<Key, Value, N>::lower_bound(const Key& key) const
+{
+    return iterator(this, lastLeftTurn(descend(1, key)));
+}
+
+template<typename Key, typename Value, size_t N>
+constexpr typename StaticTree<Key, Value, N>::iterator StaticTree<Key, Value, N>::find(const Key& key) const
+{
+    return matchAt(lastLeftTurn(descend(1, key)), key);
+}
+
+template<typename Key, typename Value, size_t N>
+constexpr const Value& StaticTree<Key, Value, N>::operator[](const Key& key) const
+{
+    return valueAt(find(key).pos_);
+}
+
+/*
+  --------------------------------------------
+  End implementations for the StaticTree class.
+  --------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,611 @@
+#ifndef STRINGAVL_H
+#define STRINGAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "avlbst.h"
+
+/**
+* A string key for StringAVLTree: 16 bytes, holding keys of up to
+* inlineCapacity bytes inline and pointing to the bytes of longer ones.
+* The first four bytes are always inline as well, so two keys that
+* differ early are told apart without following the pointer.
+*
+* A StringKey does not own its bytes. The ones held by a StringAVLTree
+* point into the tree's StringKeyArena; view() makes a temporary key
+* over bytes owned by the caller, e.g. a std::string to look up.
+* Keys compare bytewise, in the same order as std::string.
+*/
+class StringKey
+{
+public:
+    static const size_t inlineCapacity = 12;
+
+    StringKey();
+    static StringKey view(const char* data, size_t size);
+    static StringKey view(const std::string& s);
+
+    const char* data() const;
+    size_t size() const;
+    bool isInline() const;
+    std::string str() const;
+
+    int compareFrom(const char* data, size_t size, size_t& common) const;
+
+    bool operator<(const StringKey& rhs) const;
+    bool operator>(const StringKey& rhs) const;
+    bool operator==(const StringKey& rhs) const;
+    bool operator!=(const StringKey& rhs) const;
+
+private:
+    friend class StringKeyArena;
+
+    static const size_t headSize = 4;
+
+    const char* bytes() const;
+    void setBytes(const char* bytes);
+
+    uint32_t size_;
+    // the whole key if inline, otherwise its first headSize bytes
+    // followed by a pointer to all of it
+    char inline_[inlineCapacity];
+};
+
+inline std::ostream& operator<<(std::ostream& os, const StringKey& key);
+
+/**
+* Owns the bytes of the long keys of one tree. Keys up to maxClassed
+* bytes are carved out of large blocks in 8 byte size classes, and a
+* released chunk goes on its class's free list for the next key of that
+* size, so churn does not grow the arena. Longer keys get their own
+* allocation. Every interned key must be released before the arena is
+* destroyed.
+*/
+class StringKeyArena
+{
+public:
+    StringKeyArena();
+    ~StringKeyArena();
+
+    StringKey intern(const StringKey& key);
+    void release(const StringKey& key);
+
+private:
+    StringKeyArena(const StringKeyArena&);
+    StringKeyArena& operator=(const StringKeyArena&);
+
+    static const size_t granule = 8;
+    static const size_t maxClassed = 256;
+    static const size_t blockSize = 64 * 1024;
+
+    std::vector<char*> blocks_;
+    // bytes handed out from the newest block so far
+    size_t blockUsed_;
+    char* free_[maxClassed / granule];
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the StringKey class.
+  -----------------------------------------------
+*/
+
+inline StringKey::StringKey() :
+    size_(0)
+{
+    setBytes(nullptr);
+}
+
+inline StringKey StringKey::view(const char* data, size_t size)
+{
+    if(size > UINT32_MAX){
+        throw std::invalid_argument("String key is too long");
+    }
+    StringKey key;
+    key.size_ = static_cast<uint32_t>(size);
+    if(size <= inlineCapacity){
+        std::memcpy(key.inline_, data, size);
+    }
+    else{
+        std::memcpy(key.inline_, data, headSize);
+        key.setBytes(data);
+    }
+    return key;
+}
+
+inline StringKey StringKey::view(const std::string& s)
+{
+    return view(s.data(), s.size());
+}
+
+inline const char* StringKey::data() const
+{
+    return isInline() ? inline_ : bytes();
+}
+
+inline size_t StringKey::size() const
+{
+    return size_;
+}
+
+inline bool StringKey::isInline() const
+{
+    return size_ <= inlineCapacity;
+}
+
+inline std::string StringKey::str() const
+{
+    return std::string(data(), size_);
+}
+
+// the pointer sits after the head, 8 byte aligned within the key
+inline const char* StringKey::bytes() const
+{
+    const char* bytes;
+    std::memcpy(&bytes, inline_ + headSize, sizeof(bytes));
+    return bytes;
+}
+
+inline void StringKey::setBytes(const char* bytes)
+{
+    std::memcpy(inline_ + headSize, &bytes, sizeof(bytes));
+}
+
+/**
+* Compares the string (data, size) against this key, skipping the first
+* common bytes, which the caller already knows are equal. Returns a
+* negative number, zero or a positive number as the string sorts before,
+* equal to or after the key, and sets common to the length of the prefix
+* the two share.
+*/
+inline int StringKey::compareFrom(const char* data, size_t size, size_t& common) const
+{
+    size_t n = std::min<size_t>(size_, size);
+    size_t i = common;
+    // the inline head settles most early differences without a pointer
+    // chase
+    while(i < n && i < headSize && inline_[i] == data[i]){
+        ++i;
+    }
+    if(i < n && i < headSize){
+        common = i;
+        return static_cast<unsigned char>(data[i]) < static_cast<unsigned char>(inline_[i]) ? -1 : 1;
+    }
+    const char* mine = this->data();
+    while(i + sizeof(uint64_t) <= n){
+        uint64_t a, b;
+        std::memcpy(&a, mine + i, sizeof(a));
+        std::memcpy(&b, data + i, sizeof(b));
+        if(a != b){
+            break;
+        }
+        i += sizeof(uint64_t);
+    }
+    while(i < n && mine[i] == data[i]){
+        ++i;
+    }
+    common = i;
+    if(i < n){
+        return static_cast<unsigned char>(data[i]) < static_cast<unsigned char>(mine[i]) ? -1 : 1;
+    }
+    return size < size_ ? -1 : (size > size_ ? 1 : 0);
+}
+
+inline bool StringKey::operator<(const StringKey& rhs) const
+{
+    size_t common = 0;
+    return rhs.compareFrom(data(), size_, common) < 0;
+}
+
+inline bool StringKey::operator>(const StringKey& rhs) const
+{
+    return rhs < *this;
+}
+
+inline bool StringKey::operator==(const StringKey& rhs) const
+{
+    return size_ == rhs.size_ && std::memcmp(data(), rhs.data(), size_) == 0;
+}
+
+inline bool StringKey::operator!=(const StringKey& rhs) const
+{
+    return !(*this == rhs);
+}
+
+inline std::ostream& operator<<(std::ostream& os, const StringKey& key)
+{
+    return os.write(key.data(), key.size());
+}
+
+static_assert(sizeof(StringKey) == 16, "StringKey must stay 16 bytes");
+
+/**
+* Snapshots store a StringKey like a std::string, so a snapshot of an
+* AVLTree<std::string, V> loads into a StringAVLTree<V> and back. read()
+* returns a view of a per-thread buffer; the tree interns the bytes when
+* it creates the node. Two buffers are used in turn, so the key of a
+* record survives the read of its value.
+*/
+template <>
+struct SnapshotCodec<StringKey, true>
+{
+    static void write(std::ostream& os, const StringKey& item)
+    {
+        uint32_t len = static_cast<uint32_t>(item.size());
+        snapshotWrite(os, &len, sizeof(len));
+        snapshotWrite(os, item.data(), item.size());
+    }
+
+    static StringKey read(std::istream& is)
+    {
+        static thread_local std::string buffers[2];
+        static thread_local unsigned turn = 0;
+        std::string& buffer = buffers[turn];
+        turn ^= 1;
+        uint32_t len = 0;
+        snapshotRead(is, &len, sizeof(len));
+        buffer.resize(len);
+        if(len > 0){
+            snapshotRead(is, &buffer[0], len);
+        }
+        return StringKey::view(buffer);
+    }
+};
+
+/*
+  ---------------------------------------------
+  End implementations for the StringKey class.
+  ---------------------------------------------
+*/
+
+/*
+  ----------------------------------------------------
+  Begin implementations for the StringKeyArena class.
+  ----------------------------------------------------
+*/
+
+inline StringKeyArena::StringKeyArena() :
+    blockUsed_(blockSize)
+{
+    std::fill(free_, free_ + maxClassed / granule, static_cast<char*>(nullptr));
+}
+
+inline StringKeyArena::~StringKeyArena()
+{
+    for(size_t i = 0; i < blocks_.size(); ++i){
+        delete [] blocks_[i];
+    }
+}
+
+/**
+* Returns a copy of key whose bytes, if not inline, are owned by the
+* arena.
+*/
+inline StringKey StringKeyArena::intern(const StringKey& key)
+{
+    if(key.isInline()){
+        return key;
+    }
+    char* bytes;
+    size_t size = key.size();
+    if(size > maxClassed){
+        bytes = new char[size];
+    }
+    else{
+        size_t cls = (size - 1) / granule;
+        bytes = free_[cls];
+        if(bytes != nullptr){
+            std::memcpy(&free_[cls], bytes, sizeof(char*));
+        }
+        else{
+            size_t chunk = (cls + 1) * granule;
+            if(blockUsed_ + chunk > blockSize){
+                blocks_.push_back(new char[blockSize]);
+                blockUsed_ = 0;
+            }
+            bytes = blocks_.back() + blockUsed_;
+            blockUsed_ += chunk;
+        }
+    }
+    std::memcpy(bytes, key.data(), size);
+    StringKey owned = key;
+    owned.setBytes(bytes);
+    return owned;
+}
+
+inline void StringKeyArena::release(const StringKey& key)
+{
+    if(key.isInline()){
+        return;
+    }
+    char* bytes = const_cast<char*>(key.bytes());
+    if(key.size() > maxClassed){
+        delete [] bytes;
+        return;
+    }
+    // the free list is threaded through the first bytes of the chunks
+    size_t cls = (key.size() - 1) / granule;
+    std::memcpy(bytes, &free_[cls], sizeof(char*));
+    free_[cls] = bytes;
+}
+
+/*
+  --------------------------------------------------
+  End implementations for the StringKeyArena class.
+  --------------------------------------------------
+*/
+
+/**
+* An AVLTree keyed by strings, for long keys that share long prefixes
+* (URLs, file paths). Compared with AVLTree<std::string, Value>:
+*
+*  - keys are StringKeys: up to 12 bytes inline in the node, longer ones
+*    in a per-tree StringKeyArena instead of one heap block per key
+*  - lookups and inserts skip shared prefixes. Every key in the subtree
+*    being descended into lies between the closest ancestors passed on
+*    the left and on the right, so it shares with the searched key at
+*    least the shorter of the two prefixes already matched against those
+*    ancestors; comparisons start after it instead of at byte 0.
+*
+* insert(), remove(), find() and operator[] take std::strings as well
+* as StringKeys, and the hinted insert of AVLTree takes a StringKey
+* (e.g. StringKey::view()); iteration yields std::pair<const StringKey, Value>,
+* with StringKey::str() to get a std::string back. Keys handed to the
+* tree are copied into the arena whichever way the node is created.
+*/
+template <class Value>
+class StringAVLTree : public AVLTree<StringKey, Value>
+{
+public:
+    typedef typename AVLTree<StringKey, Value>::iterator iterator;
+
+    StringAVLTree();
+    virtual ~StringAVLTree();
+
+    using AVLTree<StringKey, Value>::insert;
+    virtual void insert(const std::pair<const StringKey, Value>& new_item);
+    void insert(const std::pair<const std::string, Value>& new_item);
+    virtual void remove(const StringKey& key);
+    void remove(const std::string& key);
+    virtual void clear();
+    virtual void load(std::istream& is);
+
+    iterator find(const StringKey& key) const;
+    iterator find(const std::string& key) const;
+    Value& operator[](const StringKey& key);
+    Value const & operator[](const StringKey& key) const;
+    Value& operator[](const std::string& key);
+    Value const & operator[](const std::string& key) const;
+
+protected:
+    virtual Node<StringKey, Value>* createNode(const StringKey& key, const Value& value, Node<StringKey, Value>* parent);
+    AVLNode<StringKey, Value>* descend(const StringKey& key, AVLNode<StringKey, Value>*& parent, int& side) const;
+    void releaseKeys(Node<StringKey, Value>* root);
+
+    StringKeyArena keys_;
+};
+
+/*
+  --------------------------------------------------
+  Begin implementations for the StringAVLTree class.
+  --------------------------------------------------
+*/
+
+template<class Value>
+StringAVLTree<Value>::StringAVLTree()
+{
+
+}
+
+template<class Value>
+StringAVLTree<Value>::~StringAVLTree()
+{
+    clear();
+}
+
+/**
+* Copies the key bytes into the arena; every node is created here, so
+* keys from insert(), load() and the hinted insert alike end up owned.
+*/
+template<class Value>
+Node<StringKey, Value>* StringAVLTree<Value>::createNode(const StringKey& key, const Value& value, Node<StringKey, Value>* parent)
+{
+    StringKey owned = keys_.intern(key);
+    try{
+        return AVLTree<StringKey, Value>::createNode(owned, value, parent);
+    }
+    catch(...){
+        keys_.release(owned);
+        throw;
+    }
+}
+
+/**
+* Prefix-skipping descent. Returns the node holding key, or NULL with
+* parent set to the last node passed and side to which of its children
+* key belongs in (negative for left).
+*/
+template<class Value>
+AVLNode<StringKey, Value>* StringAVLTree<Value>::descend(const StringKey& key, AVLNode<StringKey, Value>*& parent, int& side) const
+{
+    const char* data = key.data();
+    size_t size = key.size();
+    // prefixes matched against the closest ancestors passed going left
+    // (a larger key) and going right (a smaller key)
+    size_t aboveCommon = 0;
+    size_t belowCommon = 0;
+    AVLNode<StringKey, Value>* temp = static_cast<AVLNode<StringKey, Value>*>(this->root_);
+    parent = nullptr;
+    side = 0;
+    while(temp != nullptr){
+        BST_STAT_ADD(TREE_FIND_PATH, 1);
+        BST_STAT_ADD(TREE_COMPARISONS, 1);
+        size_t common = std::min(aboveCommon, belowCommon);
+        side = temp->getKey().compareFrom(data, size, common);
+        if(side == 0){
+            return temp;
+        }
+        parent = temp;
+        if(side < 0){
+            aboveCommon = common;
+            temp = temp->getLeft();
+        }
+        else{
+            belowCommon = common;
+            temp = temp->getRight();
+        }
+    }
+    return nullptr;
+}
+
+/**
+* Inserts or overwrites new_item with one prefix-skipping descent. A key
+* larger than every other one is still appended at the cached rightmost
+* node, as in AVLTree.
+*/
+template<class Value>
+void StringAVLTree<Value>::insert(const std::pair<const StringKey, Value>& new_item)
+{
+    BST_STAT_TIMER(TREE_INSERT);
+    if(this->empty()){
+        AVLTree<StringKey, Value>::insert(new_item);
+        return;
+    }
+    AVLNode<StringKey, Value>* largest = this->getLargestNode();
+    size_t common = 0;
+    if(largest->getKey().compareFrom(new_item.first.data(), new_item.first.size(), common) > 0){
+        this->rightmost_ = this->attachLeaf(largest, new_item, true);
+        return;
+    }
+    AVLNode<StringKey, Value>* parent;
+    int side;
+    AVLNode<StringKey, Value>* found = descend(new_item.first, parent, side);
+    if(found != nullptr){
+        found->setValue(new_item.second);
+        return;
+    }
+    this->attachLeaf(parent, new_item, side > 0);
+}
+
+template<class Value>
+void StringAVLTree<Value>::insert(const std::pair<const std::string, Value>& new_item)
+{
+    insert(std::pair<const StringKey, Value>(StringKey::view(new_item.first), new_item.second));
+}
+
+template<class Value>
+void StringAVLTree<Value>::remove(const StringKey& key)
+{
+    AVLNode<StringKey, Value>* parent;
+    int side;
+    AVLNode<StringKey, Value>* found = descend(key, parent, side);
+    if(found == nullptr){
+        return;
+    }
+    // the node, and with it the key passed in if that was the node's own,
+    // is gone once AVLTree::remove returns
+    StringKey owned = found->getKey();
+    AVLTree<StringKey, Value>::remove(owned);
+    keys_.release(owned);
+}
+
+template<class Value>
+void StringAVLTree<Value>::remove(const std::string& key)
+{
+    remove(StringKey::view(key));
+}
+
+template<class Value>
+void StringAVLTree<Value>::releaseKeys(Node<StringKey, Value>* root)
+{
+    if(root == nullptr){
+        return;
+    }
+    releaseKeys(root->getLeft());
+    keys_.release(root->getKey());
+    releaseKeys(root->getRight());
+}
+
+template<class Value>
+void StringAVLTree<Value>::clear()
+{
+    releaseKeys(this->root_);
+    AVLTree<StringKey, Value>::clear();
+}
+
+template<class Value>
+void StringAVLTree<Value>::load(std::istream& is)
+{
+    clear();
+    BinarySearchTree<StringKey, Value>::load(is);
+}
+
+/**
+* Prefix-skipping find. Unlike BinarySearchTree::find(), this does not
+* go through the lookup cache.
+*/
+template<class Value>
+typename StringAVLTree<Value>::iterator StringAVLTree<Value>::find(const StringKey& key) const
+{
+    BST_STAT_ADD(TREE_FIND_CALLS, 1);
+    AVLNode<StringKey, Value>* parent;
+    int side;
+    return this->makeIterator(descend(key, parent, side));
+}
+
+template<class Value>
+typename StringAVLTree<Value>::iterator StringAVLTree<Value>::find(const std::string& key) const
+{
+    return find(StringKey::view(key));
+}
+
+template<class Value>
+Value& StringAVLTree<Value>::operator[](const StringKey& key)
+{
+    AVLNode<StringKey, Value>* parent;
+    int side;
+    AVLNode<StringKey, Value>* found = descend(key, parent, side);
+    if(found == nullptr){
+        throw std::out_of_range("Invalid key");
+    }
+    return found->getValue();
+}
+
+template<class Value>
+Value const & StringAVLTree<Value>::operator[](const StringKey& key) const
+{
+    AVLNode<StringKey, Value>* parent;
+    int side;
+    AVLNode<StringKey, Value>* found = descend(key, parent, side);
+    if(found == nullptr){
+        throw std::out_of_range("Invalid key");
+    }
+    return found->getValue();
+}
+
+template<class Value>
+Value& StringAVLTree<Value>::operator[](const std::string& key)
+{
+    return (*this)[StringKey::view(key)];
+}
+
+template<class Value>
+Value const & StringAVLTree<Value>::operator[](const std::string& key) const
+{
+    return (*this)[StringKey::view(key)];
+}
+
+/*
+  ------------------------------------------------
+  End implementations for the StringAVLTree class.
+  ------------------------------------------------
+*/
+
+#endif
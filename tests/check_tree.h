@@ -0,0 +1,75 @@
+// check_tree.h - helpers shared by the tree tests: comparing a tree's
+// contents against a std::map, and a seeded random workload that keeps
+// both in step.
+
+#ifndef CHECK_TREE_H
+#define CHECK_TREE_H
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <sstream>
+
+/**
+* Checks that iterating tree yields exactly the entries of expected, in
+* key order, and that find() and operator[] agree with it.
+*/
+template <class Tree, class Key, class Value>
+testing::AssertionResult sameContents(const Tree& tree, const std::map<Key, Value>& expected)
+{
+    typename std::map<Key, Value>::const_iterator want = expected.begin();
+    size_t position = 0;
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++want, ++position){
+        if(want == expected.end()){
+            return testing::AssertionFailure() << "tree has an extra entry " << it->first
+                                               << " after " << position << " entries";
+        }
+        if(!(it->first == want->first) || !(it->second == want->second)){
+            return testing::AssertionFailure() << "entry " << position << " is (" << it->first << ", "
+                                               << it->second << "), expected (" << want->first << ", "
+                                               << want->second << ")";
+        }
+    }
+    if(want != expected.end()){
+        return testing::AssertionFailure() << "tree is missing " << want->first << " and "
+                                           << expected.size() - position - 1 << " more";
+    }
+    for(want = expected.begin(); want != expected.end(); ++want){
+        typename Tree::iterator found = tree.find(want->first);
+        if(found == tree.end() || !(found->second == want->second)){
+            return testing::AssertionFailure() << "find(" << want->first << ") does not return its entry";
+        }
+    }
+    return testing::AssertionSuccess();
+}
+
+/**
+* Runs ops random inserts (overwriting existing keys half the time) and
+* removes over keys in [0, keyRange) against both tree and expected,
+* calling check(step) after every checkEvery operations. Inserts are
+* twice as likely as removes, so the tree grows while it churns.
+*/
+template <class Tree, class Check>
+void randomWorkload(Tree& tree, std::map<int, int>& expected, unsigned seed, int ops, int keyRange,
+                    int checkEvery, Check check)
+{
+    std::mt19937 rng(seed);
+    for(int step = 1; step <= ops; ++step){
+        int key = static_cast<int>(rng() % keyRange);
+        if(rng() % 3 != 0){
+            int value = static_cast<int>(rng() % 1000);
+            tree.insert(std::make_pair(key, value));
+            expected[key] = value;
+        }
+        else{
+            tree.remove(key);
+            expected.erase(key);
+        }
+        if(step % checkEvery == 0){
+            check(step);
+        }
+    }
+}
+
+#endif
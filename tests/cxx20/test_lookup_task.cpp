@@ -0,0 +1,202 @@
+#include <compactavl.h>
+#include <lookup_task.h>
+#include <mappedavl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace
+{
+
+typedef CompactAVLTree<int, int> Tree;
+
+/**
+* A slow pager: only nodes fetched before are resident, and a fetch
+* lands after it was polled latency times. Counts the distinct fetches
+* and how many were in flight at once.
+*/
+class SimulatedPager
+{
+public:
+    explicit SimulatedPager(int latency) : latency_(latency), fetches(0), waiting(0), maxWaiting(0) {}
+
+    bool resident(const void* addr, size_t) const
+    {
+        return warm_.count(addr) != 0;
+    }
+
+    void fetch(const void* addr, size_t)
+    {
+        // another lookup already asked for it
+        if(pending_.count(addr) != 0){
+            return;
+        }
+        fetches++;
+        pending_[addr] = latency_;
+        waiting++;
+        maxWaiting = std::max(maxWaiting, waiting);
+    }
+
+    bool arrived(const void* addr, size_t)
+    {
+        if(warm_.count(addr) != 0){
+            return true;
+        }
+        if(--pending_[addr] > 0){
+            return false;
+        }
+        // lookups waiting on the same node all see it land
+        warm_.insert(addr);
+        pending_.erase(addr);
+        waiting--;
+        return true;
+    }
+
+    int latency_;
+    std::set<const void*> warm_;
+    std::map<const void*, int> pending_;
+    int fetches;
+    int waiting;
+    int maxWaiting;
+};
+
+LookupTask<int> sumOf(const Tree& tree, std::vector<int> keys, LookupScheduler& scheduler)
+{
+    int sum = 0;
+    for(size_t i = 0; i < keys.size(); ++i){
+        Tree::iterator it = co_await tree.findAsync(keys[i], scheduler);
+        sum += (it != tree.end()) ? it->second : 0;
+    }
+    co_return sum;
+}
+
+}
+
+TEST(LookupTask, AsyncFindMatchesFind)
+{
+    std::mt19937 rng(1);
+    Tree tree;
+    for(int i = 0; i < 5000; ++i){
+        int key = static_cast<int>(rng() % 20000);
+        tree.insert(std::make_pair(key, i));
+    }
+    LookupScheduler scheduler;
+    std::vector<int> keys;
+    std::vector<LookupTask<Tree::iterator> > lookups;
+    for(int i = 0; i < 1000; ++i){
+        keys.push_back(static_cast<int>(rng() % 20000));
+        lookups.push_back(tree.findAsync(keys.back(), scheduler));
+    }
+    for(size_t i = 0; i < lookups.size(); ++i){
+        EXPECT_FALSE(lookups[i].done());
+        scheduler.spawn(lookups[i]);
+    }
+
+    scheduler.run();
+
+    for(size_t i = 0; i < lookups.size(); ++i){
+        ASSERT_TRUE(lookups[i].done());
+        ASSERT_TRUE(lookups[i].result() == tree.find(keys[i])) << keys[i];
+    }
+}
+
+// cold nodes suspend the descent, so many lookups wait at once
+TEST(LookupTask, SlowPagerOverlapsLookups)
+{
+    Tree tree;
+    for(int i = 0; i < 4096; ++i){
+        tree.insert(std::make_pair(i, -i));
+    }
+    SimulatedPager pager(5);
+    LookupScheduler scheduler;
+    std::vector<LookupTask<Tree::iterator> > lookups;
+    for(int i = 0; i < 256; ++i){
+        lookups.push_back(tree.findAsync(i * 16 + 3, scheduler, pager));
+    }
+    lookups.push_back(tree.findAsync(-1, scheduler, pager));
+    for(size_t i = 0; i < lookups.size(); ++i){
+        scheduler.spawn(lookups[i]);
+    }
+
+    scheduler.run();
+
+    for(int i = 0; i < 256; ++i){
+        ASSERT_EQ(-(i * 16 + 3), lookups[i].result()->second);
+    }
+    EXPECT_TRUE(lookups.back().result() == tree.end());
+    EXPECT_EQ(0, pager.waiting);
+    EXPECT_GT(pager.maxWaiting, 50);
+    // every node fetched at most once, at least the root and a level below
+    EXPECT_LE(pager.fetches, 4096);
+    EXPECT_GE(pager.fetches, 3);
+}
+
+TEST(LookupTask, AwaitedFromAnotherCoroutine)
+{
+    Tree tree;
+    for(int i = 1; i <= 100; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    LookupScheduler scheduler;
+    LookupTask<int> sum = sumOf(tree, std::vector<int>{1, 2, 3, 500, 100}, scheduler);
+    LookupTask<int> other = sumOf(tree, std::vector<int>{50}, scheduler);
+
+    scheduler.spawn(sum);
+    scheduler.spawn(other);
+    scheduler.run();
+
+    EXPECT_EQ(106, sum.result());
+    EXPECT_EQ(50, other.result());
+}
+
+TEST(LookupTask, EmptyTree)
+{
+    Tree tree;
+    LookupScheduler scheduler;
+    LookupTask<Tree::iterator> lookup = tree.findAsync(1, scheduler);
+
+    scheduler.spawn(lookup);
+    scheduler.run();
+
+    EXPECT_TRUE(lookup.result() == tree.end());
+}
+
+TEST(LookupTask, MincorePagerOnAMappedTree)
+{
+    std::string path = testing::TempDir() + "lookuptask-" + std::to_string(::getpid()) + ".avl";
+    ::unlink(path.c_str());
+    {
+        MappedAVLTree<int, int> tree(path);
+        for(int i = 0; i < 50000; ++i){
+            tree.insert(std::make_pair(i * 2, i));
+        }
+        MincorePager pager;
+        LookupScheduler scheduler;
+        std::vector<LookupTask<MappedAVLTree<int, int>::iterator> > lookups;
+        for(int i = 0; i < 500; ++i){
+            lookups.push_back(tree.findAsync(i * 199, scheduler, pager));
+        }
+        for(size_t i = 0; i < lookups.size(); ++i){
+            scheduler.spawn(lookups[i]);
+        }
+        scheduler.run();
+
+        for(int i = 0; i < 500; ++i){
+            int key = i * 199;
+            if(key % 2 == 0){
+                ASSERT_EQ(key / 2, lookups[i].result()->second);
+            }
+            else{
+                ASSERT_TRUE(lookups[i].result() == tree.end());
+            }
+        }
+        tree.sync();
+    }
+    ::unlink(path.c_str());
+}
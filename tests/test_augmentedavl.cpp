@@ -0,0 +1,141 @@
+#include "check_tree.h"
+
+#include <augmentedavl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+/**
+* The keys in order, comma separated; not commutative, so it checks that
+* summaries are always combined smaller keys first.
+*/
+struct KeyListAggregate
+{
+    typedef std::string type;
+    static type identity() { return std::string(); }
+    static type lift(const int& key, const int&) { return std::to_string(key) + ","; }
+    static type combine(const type& a, const type& b) { return a + b; }
+};
+
+template <class Aggregate>
+typename Aggregate::type bruteForce(const std::map<int, int>& items, int lo, int hi)
+{
+    typename Aggregate::type result = Aggregate::identity();
+    for(std::map<int, int>::const_iterator it = items.lower_bound(lo); it != items.end() && it->first <= hi; ++it){
+        result = Aggregate::combine(result, Aggregate::lift(it->first, it->second));
+    }
+    return result;
+}
+
+/**
+* Compares aggregate(lo, hi) with a brute-force fold for random ranges,
+* including empty and inverted ones.
+*/
+template <class Aggregate>
+testing::AssertionResult rangesMatch(const AugmentedAVLTree<int, int, Aggregate>& tree,
+                                     const std::map<int, int>& items, std::mt19937& rng, int keyRange)
+{
+    for(int q = 0; q < 50; ++q){
+        int lo = static_cast<int>(rng() % (keyRange + 20)) - 10;
+        int hi = lo + static_cast<int>(rng() % (keyRange / 4 + 1)) - 2;
+        typename Aggregate::type want = bruteForce<Aggregate>(items, lo, hi);
+        typename Aggregate::type got = tree.aggregate(lo, hi);
+        if(!(want == got)){
+            return testing::AssertionFailure() << "aggregate(" << lo << ", " << hi << ") is " << got
+                                               << ", expected " << want;
+        }
+    }
+    if(!(tree.aggregate() == bruteForce<Aggregate>(items, -1000000, 1000000))){
+        return testing::AssertionFailure() << "aggregate() of the whole tree is " << tree.aggregate();
+    }
+    return testing::AssertionSuccess();
+}
+
+}
+
+TEST(AugmentedAVLTree, EmptyTree)
+{
+    AugmentedAVLTree<int, int, SumAggregate<int, int> > tree;
+
+    EXPECT_EQ(0, tree.aggregate());
+    EXPECT_EQ(0, tree.aggregate(1, 10));
+}
+
+TEST(AugmentedAVLTree, SumMinMaxOfRange)
+{
+    AugmentedAVLTree<int, int, SumAggregate<int, int> > sum;
+    AugmentedAVLTree<int, int, MinAggregate<int, int> > min;
+    AugmentedAVLTree<int, int, MaxAggregate<int, int> > max;
+    for(int i = 1; i <= 100; ++i){
+        sum.insert(std::make_pair(i, i));
+        min.insert(std::make_pair(i, (i * 37) % 101));
+        max.insert(std::make_pair(i, (i * 37) % 101));
+    }
+
+    EXPECT_EQ(5050, sum.aggregate());
+    EXPECT_EQ(10 + 11 + 12, sum.aggregate(10, 12));
+    EXPECT_EQ(0, sum.aggregate(12, 10));
+    EXPECT_EQ(100, sum.aggregate(100, 1000));
+    EXPECT_EQ(1, min.aggregate());
+    EXPECT_EQ(100, max.aggregate());
+    EXPECT_EQ(37, min.aggregate(1, 1));
+}
+
+TEST(AugmentedAVLTree, RandomAgainstBruteForce)
+{
+    for(unsigned seed = 1; seed <= 4; ++seed){
+        AugmentedAVLTree<int, int, SumAggregate<int, int> > sum;
+        AugmentedAVLTree<int, int, KeyListAggregate> keys;
+        std::map<int, int> expected;
+        std::map<int, int> expectedKeys;
+        std::mt19937 rng(seed);
+        randomWorkload(sum, expected, seed, 4000, 500, 200, [&](int step) {
+            ASSERT_TRUE(sum.isBalanced()) << "seed " << seed << ", step " << step;
+            ASSERT_TRUE(rangesMatch(sum, expected, rng, 500)) << "seed " << seed << ", step " << step;
+        });
+        randomWorkload(keys, expectedKeys, seed, 4000, 500, 200, [&](int step) {
+            ASSERT_TRUE(rangesMatch(keys, expectedKeys, rng, 500)) << "seed " << seed << ", step " << step;
+        });
+    }
+}
+
+TEST(AugmentedAVLTree, HintedInsertKeepsSummaries)
+{
+    AugmentedAVLTree<int, int, KeyListAggregate> tree;
+    AugmentedAVLTree<int, int, KeyListAggregate>::iterator hint = tree.end();
+    for(int i = 0; i < 50; ++i){
+        hint = tree.insert(tree.end(), std::make_pair(i * 2, 0));
+    }
+    hint = tree.find(10);
+    for(int i = 11; i < 20; i += 2){
+        hint = tree.insert(hint, std::make_pair(i, 0));
+        ++hint;
+    }
+
+    EXPECT_EQ("8,10,11,12,13,14,15,16,17,18,19,20,", tree.aggregate(8, 20));
+}
+
+TEST(AugmentedAVLTree, LoadedTreeHasSummaries)
+{
+    AugmentedAVLTree<int, int, SumAggregate<int, int> > tree;
+    for(int i = 1; i <= 1000; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    std::stringstream snapshot;
+    tree.save(snapshot);
+
+    AugmentedAVLTree<int, int, SumAggregate<int, int> > loaded;
+    loaded.load(snapshot);
+
+    EXPECT_EQ(500500, loaded.aggregate());
+    EXPECT_EQ(101 + 102 + 103, loaded.aggregate(101, 103));
+    loaded.remove(500);
+    EXPECT_EQ(500000, loaded.aggregate());
+}
@@ -0,0 +1,130 @@
+#include "check_tree.h"
+
+#include <avlbst.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <sstream>
+
+namespace
+{
+
+/**
+* An AVLTree that can check the balance stored in every node against the
+* actual heights of its subtrees, and exposes its node count.
+*/
+class CheckedAVLTree : public AVLTree<int, int>
+{
+public:
+    size_t nodes() const
+    {
+        return size_;
+    }
+
+    bool balancesMatch() const
+    {
+        bool ok = true;
+        height(static_cast<AVLNode<int, int>*>(root_), ok);
+        return ok;
+    }
+
+private:
+    static int height(const AVLNode<int, int>* node, bool& ok)
+    {
+        if(node == nullptr){
+            return 0;
+        }
+        int left = height(node->getLeft(), ok);
+        int right = height(node->getRight(), ok);
+        if(node->getBalance() != right - left || right - left < -1 || right - left > 1){
+            ok = false;
+        }
+        return 1 + std::max(left, right);
+    }
+};
+
+}
+
+TEST(AVLTree, AscendingAndDescendingInsertStayBalanced)
+{
+    CheckedAVLTree up;
+    CheckedAVLTree down;
+    for(int i = 0; i < 1000; ++i){
+        up.insert(std::make_pair(i, i));
+        down.insert(std::make_pair(-i, i));
+        ASSERT_TRUE(up.balancesMatch()) << "after inserting " << i;
+        ASSERT_TRUE(down.balancesMatch()) << "after inserting " << -i;
+    }
+}
+
+// zig-zag insertions: every key lands between two existing ones
+TEST(AVLTree, InterleavedInsertStaysBalanced)
+{
+    CheckedAVLTree tree;
+    std::map<int, int> expected;
+    for(int i = 0; i < 512; ++i){
+        int key = (i % 2 == 0) ? i : 1024 - i;
+        tree.insert(std::make_pair(key, i));
+        expected[key] = i;
+        ASSERT_TRUE(tree.balancesMatch()) << "after inserting " << key;
+    }
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+TEST(AVLTree, RandomAgainstStdMap)
+{
+    for(unsigned seed = 1; seed <= 5; ++seed){
+        CheckedAVLTree tree;
+        std::map<int, int> expected;
+        randomWorkload(tree, expected, seed, 20000, 2000, 250, [&](int step) {
+            ASSERT_TRUE(tree.balancesMatch()) << "seed " << seed << ", step " << step;
+            ASSERT_EQ(expected.size(), tree.nodes()) << "seed " << seed << ", step " << step;
+        });
+        EXPECT_TRUE(sameContents(tree, expected)) << "seed " << seed;
+    }
+}
+
+TEST(AVLTree, RemoveEverything)
+{
+    CheckedAVLTree tree;
+    for(int i = 0; i < 300; ++i){
+        tree.insert(std::make_pair(i * 7 % 300, i));
+    }
+    for(int i = 0; i < 300; ++i){
+        tree.remove(i * 11 % 300);
+        ASSERT_TRUE(tree.balancesMatch()) << "after removing " << i * 11 % 300;
+    }
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(0u, tree.nodes());
+}
+
+// every way in counts: appends, hints, loads; clear() also works through
+// a BinarySearchTree reference
+TEST(AVLTree, NodeCountAndClear)
+{
+    CheckedAVLTree tree;
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i * 2, i));
+    }
+    CheckedAVLTree::iterator hint = tree.find(10);
+    tree.insert(hint, std::make_pair(9, 0));
+    tree.insert(tree.end(), std::make_pair(1000, 0));
+    tree.insert(tree.begin(), std::make_pair(10, 1));
+    EXPECT_EQ(102u, tree.nodes());
+
+    BinarySearchTree<int, int>& base = tree;
+    base.clear();
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(0u, tree.nodes());
+
+    std::map<int, int> expected;
+    randomWorkload(tree, expected, 7, 500, 100, 500, [](int) {});
+    std::stringstream snapshot;
+    tree.save(snapshot);
+    CheckedAVLTree loaded;
+    loaded.load(snapshot);
+    EXPECT_EQ(expected.size(), loaded.nodes());
+    loaded.insert(std::make_pair(-1, 0));
+    EXPECT_EQ(expected.size() + 1, loaded.nodes());
+}
@@ -0,0 +1,159 @@
+#include "check_tree.h"
+
+#include <avlbst.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <ostream>
+
+namespace
+{
+
+/**
+* An int key that counts how often keys are compared.
+*/
+struct CountedKey
+{
+    CountedKey(int v = 0) : value(v) {}
+
+    bool operator<(const CountedKey& other) const
+    {
+        comparisons++;
+        return value < other.value;
+    }
+
+    bool operator>(const CountedKey& other) const
+    {
+        return other < *this;
+    }
+
+    bool operator==(const CountedKey& other) const
+    {
+        return value == other.value;
+    }
+
+    int value;
+    static long comparisons;
+};
+
+long CountedKey::comparisons = 0;
+
+std::ostream& operator<<(std::ostream& os, const CountedKey& key)
+{
+    return os << key.value;
+}
+
+}
+
+TEST(AVLTreeAppend, AscendingInsertComparesOncePerKey)
+{
+    AVLTree<CountedKey, int> tree;
+    CountedKey::comparisons = 0;
+    for(int i = 0; i < 10000; ++i){
+        tree.insert(std::make_pair(CountedKey(i), i));
+    }
+    EXPECT_LE(CountedKey::comparisons, 10000);
+    EXPECT_TRUE(tree.isBalanced());
+}
+
+// removing the largest key drops the cached rightmost node
+TEST(AVLTreeAppend, AppendAfterRemovingLargest)
+{
+    AVLTree<int, int> tree;
+    std::map<int, int> expected;
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i, i));
+        expected[i] = i;
+    }
+    for(int i = 99; i >= 50; --i){
+        tree.remove(i);
+        expected.erase(i);
+        tree.insert(std::make_pair(i - 1, -i));
+        expected[i - 1] = -i;
+        tree.insert(std::make_pair(1000 + i, i));
+        expected[1000 + i] = i;
+        tree.remove(1000 + i);
+        expected.erase(1000 + i);
+    }
+    EXPECT_TRUE(tree.isBalanced());
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+TEST(AVLTreeHint, EndHintAppends)
+{
+    AVLTree<CountedKey, int> tree;
+    AVLTree<CountedKey, int>::iterator it = tree.end();
+    for(int i = 0; i < 1000; ++i){
+        it = tree.insert(tree.end(), std::make_pair(CountedKey(i), i));
+        ASSERT_EQ(i, it->first.value);
+    }
+    EXPECT_TRUE(tree.isBalanced());
+}
+
+// the returned iterator is the right hint for the next key of a run
+TEST(AVLTreeHint, RunsBetweenExistingKeysFollowTheHint)
+{
+    AVLTree<CountedKey, int> tree;
+    std::map<int, int> expected;
+    for(int i = 0; i < 1000; i += 100){
+        tree.insert(std::make_pair(CountedKey(i), i));
+        expected[i] = i;
+    }
+    CountedKey::comparisons = 0;
+    long runs = 0;
+    for(int start = 0; start < 1000; start += 100, ++runs){
+        AVLTree<CountedKey, int>::iterator hint = tree.find(CountedKey(start));
+        for(int i = start + 1; i < start + 100; ++i){
+            hint = tree.insert(hint, std::make_pair(CountedKey(i), -i));
+            ASSERT_EQ(i, hint->first.value);
+            expected[i] = -i;
+            ++hint;
+        }
+    }
+    // a good hint costs a few comparisons, not a descent of ~10 levels
+    EXPECT_LE(CountedKey::comparisons, 990 * 4 + runs * 20);
+    EXPECT_TRUE(tree.isBalanced());
+    std::map<int, int>::const_iterator want = expected.begin();
+    for(AVLTree<CountedKey, int>::iterator it = tree.begin(); it != tree.end(); ++it, ++want){
+        ASSERT_EQ(want->first, it->first.value);
+        ASSERT_EQ(want->second, it->second);
+    }
+}
+
+TEST(AVLTreeHint, WrongHintStillInserts)
+{
+    AVLTree<int, int> tree;
+    std::map<int, int> expected;
+    for(int i = 0; i < 100; i += 2){
+        tree.insert(std::make_pair(i, i));
+        expected[i] = i;
+    }
+    for(int i = 1; i < 100; i += 2){
+        // always hint at the smallest key
+        AVLTree<int, int>::iterator it = tree.insert(tree.begin(), std::make_pair(i, i));
+        ASSERT_EQ(i, it->first);
+        expected[i] = i;
+    }
+    // hints at the end for a small key, and at an existing key
+    EXPECT_EQ(-5, tree.insert(tree.end(), std::make_pair(-5, 0))->first);
+    expected[-5] = 0;
+    EXPECT_EQ(70, tree.insert(tree.find(7), std::make_pair(7, 70))->second);
+    expected[7] = 70;
+    EXPECT_EQ(10, tree.insert(tree.find(50), std::make_pair(10, 100))->first);
+    expected[10] = 100;
+
+    EXPECT_TRUE(tree.isBalanced());
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+TEST(AVLTreeHint, IntoEmptyTree)
+{
+    AVLTree<int, int> tree;
+
+    AVLTree<int, int>::iterator it = tree.insert(tree.end(), std::make_pair(3, 4));
+
+    ASSERT_TRUE(it != tree.end());
+    EXPECT_EQ(3, it->first);
+    EXPECT_EQ(4, tree[3]);
+}
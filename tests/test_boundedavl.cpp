@@ -0,0 +1,226 @@
+#include "check_tree.h"
+
+#include <boundedavl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+typedef BoundedAVLTree<int, int> Tree;
+
+// the charge of one entry with no payload
+size_t entryBytes()
+{
+    Tree probe(1000000);
+    probe.insert(std::make_pair(0, 0));
+    return probe.bytes();
+}
+
+std::vector<int> keysOf(const Tree& tree)
+{
+    std::vector<int> keys;
+    for(Tree::iterator it = tree.begin(); it != tree.end(); ++it){
+        keys.push_back(it->first);
+    }
+    return keys;
+}
+
+/**
+* Charges each entry its value as payload bytes.
+*/
+struct ValueSizer
+{
+    static size_t payloadBytes(const int&, const int& value) { return static_cast<size_t>(value); }
+};
+
+}
+
+TEST(BoundedAVLTree, LargeBudgetBehavesLikeAMap)
+{
+    for(unsigned seed = 1; seed <= 3; ++seed){
+        Tree tree(1 << 30);
+        std::map<int, int> expected;
+        randomWorkload(tree, expected, seed, 4000, 400, 200, [&](int step) {
+            ASSERT_TRUE(tree.isBalanced()) << "seed " << seed << ", step " << step;
+            ASSERT_EQ(expected.size(), tree.size());
+            ASSERT_EQ(expected.size() * entryBytes(), tree.bytes());
+            ASSERT_TRUE(sameContents(tree, expected)) << "seed " << seed << ", step " << step;
+        });
+        EXPECT_EQ(0u, tree.evictions());
+    }
+}
+
+// with no lookups CLOCK evicts in insertion order
+TEST(BoundedAVLTree, EvictsOldestFirst)
+{
+    Tree tree(4 * entryBytes());
+    for(int i = 1; i <= 6; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+
+    EXPECT_EQ((std::vector<int>{3, 4, 5, 6}), keysOf(tree));
+    EXPECT_EQ(2u, tree.evictions());
+    EXPECT_EQ(4u, tree.size());
+}
+
+TEST(BoundedAVLTree, ReferencedEntriesGetASecondChance)
+{
+    Tree tree(4 * entryBytes());
+    for(int i = 1; i <= 4; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    tree.find(1);
+    tree[3];
+
+    tree.insert(std::make_pair(5, 5));
+    EXPECT_EQ((std::vector<int>{1, 3, 4, 5}), keysOf(tree));
+    tree.insert(std::make_pair(6, 6));
+    EXPECT_EQ((std::vector<int>{1, 3, 5, 6}), keysOf(tree));
+}
+
+TEST(BoundedAVLTree, FindBatchReferences)
+{
+    Tree tree(4 * entryBytes());
+    for(int i = 1; i <= 4; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    std::vector<Tree::iterator> found;
+    tree.findBatch(std::vector<int>{3, 9, 1}, found);
+    ASSERT_EQ(3u, found.size());
+    EXPECT_TRUE(found[1] == tree.end());
+
+    tree.insert(std::make_pair(5, 5));
+    EXPECT_EQ((std::vector<int>{1, 3, 4, 5}), keysOf(tree));
+    tree.insert(std::make_pair(6, 6));
+    EXPECT_EQ((std::vector<int>{1, 3, 5, 6}), keysOf(tree));
+}
+
+// ordered iteration is not a reference
+TEST(BoundedAVLTree, ScansDoNotReference)
+{
+    Tree tree(4 * entryBytes());
+    for(int i = 1; i <= 4; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    keysOf(tree);
+
+    tree.insert(std::make_pair(5, 5));
+
+    EXPECT_EQ((std::vector<int>{2, 3, 4, 5}), keysOf(tree));
+}
+
+TEST(BoundedAVLTree, PayloadBytesCountAgainstTheBudget)
+{
+    size_t node = entryBytes();
+    BoundedAVLTree<int, int, ValueSizer> tree(3 * node + 100);
+    tree.insert(std::make_pair(1, 60));
+    tree.insert(std::make_pair(2, 30));
+    EXPECT_EQ(2 * node + 90, tree.bytes());
+
+    // overwriting recharges the entry
+    tree.insert(std::make_pair(2, 40));
+    EXPECT_EQ(2 * node + 100, tree.bytes());
+    EXPECT_EQ(0u, tree.evictions());
+
+    // an entry larger than the whole budget does not stay
+    tree.insert(std::make_pair(3, 1000));
+    EXPECT_TRUE(tree.find(3) == tree.end());
+    EXPECT_LE(tree.bytes(), tree.maxBytes());
+}
+
+TEST(BoundedAVLTree, ShrinkingTheBudgetEvicts)
+{
+    Tree tree(100 * entryBytes());
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+
+    tree.setMaxBytes(10 * entryBytes());
+
+    EXPECT_EQ(10u, tree.size());
+    EXPECT_EQ(90u, tree.evictions());
+    EXPECT_TRUE(tree.isBalanced());
+}
+
+// under any workload: within budget, balanced, and every entry left is current
+TEST(BoundedAVLTree, RandomWorkloadStaysWithinBudget)
+{
+    std::mt19937 rng(11);
+    Tree tree(50 * entryBytes());
+    std::map<int, int> model;
+    for(int step = 0; step < 20000; ++step){
+        int key = static_cast<int>(rng() % 500);
+        switch(rng() % 4){
+        case 0:
+            tree.remove(key);
+            model.erase(key);
+            break;
+        case 1:
+            tree.find(key);
+            break;
+        default:
+            tree.insert(std::make_pair(key, step));
+            model[key] = step;
+        }
+        ASSERT_LE(tree.bytes(), tree.maxBytes());
+        if(step % 500 == 0){
+            ASSERT_TRUE(tree.isBalanced());
+            size_t entries = 0;
+            for(Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++entries){
+                ASSERT_EQ(model[it->first], it->second) << "key " << it->first;
+            }
+            ASSERT_EQ(entries, tree.size());
+        }
+    }
+    EXPECT_EQ(50u, tree.size());
+}
+
+TEST(BoundedAVLTree, LoadEvictsToFit)
+{
+    Tree big(1 << 30);
+    for(int i = 0; i < 100; ++i){
+        big.insert(std::make_pair(i, i));
+    }
+    std::stringstream snapshot;
+    big.save(snapshot);
+
+    Tree small(20 * entryBytes());
+    small.load(snapshot);
+
+    EXPECT_EQ(20u, small.size());
+    EXPECT_EQ(20 * entryBytes(), small.bytes());
+    EXPECT_TRUE(small.isBalanced());
+}
+
+TEST(BoundedAVLTree, HintedInsertIsChargedAndEvicts)
+{
+    size_t entry = entryBytes();
+    BoundedAVLTree<int, int, ValueSizer> tree(10 * entry + 100);
+    AVLTree<int, int>& base = tree;
+    AVLTree<int, int>::iterator hint = base.end();
+    for(int i = 0; i < 10; ++i){
+        hint = base.insert(hint, std::make_pair(i, 10));
+        ++hint;
+    }
+    ASSERT_EQ(10u, tree.size());
+    EXPECT_EQ(10 * entry + 100, tree.bytes());
+
+    // overwriting through the hint recharges, and references, the entry
+    base.insert(tree.find(0), std::make_pair(0, 20));
+    EXPECT_EQ(9 * entry + 100, tree.bytes());
+    EXPECT_EQ(1u, tree.evictions());
+    EXPECT_TRUE(tree.find(1) == tree.end());
+    EXPECT_EQ(20, tree[0]);
+
+    // too large on its own: evicted at once, and end() comes back
+    EXPECT_TRUE(base.insert(base.end(), std::make_pair(50, 1000000)) == tree.end());
+    EXPECT_TRUE(tree.find(50) == tree.end());
+    EXPECT_LE(tree.bytes(), tree.maxBytes());
+    EXPECT_TRUE(tree.isBalanced());
+}
@@ -0,0 +1,136 @@
+#include "check_tree.h"
+
+#include <avlbst.h>
+#include <bst.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <ostream>
+#include <random>
+#include <string>
+
+namespace
+{
+
+/**
+* An int key that is not arithmetic, so it takes the branching descent
+* unless opted in.
+*/
+struct BoxedKey
+{
+    BoxedKey(int v = 0) : value(v) {}
+    bool operator<(const BoxedKey& other) const { return value < other.value; }
+    bool operator>(const BoxedKey& other) const { return value > other.value; }
+    bool operator==(const BoxedKey& other) const { return value == other.value; }
+    int value;
+};
+
+struct OptedInKey : BoxedKey
+{
+    OptedInKey(int v = 0) : BoxedKey(v) {}
+};
+
+std::ostream& operator<<(std::ostream& os, const BoxedKey& key)
+{
+    return os << key.value;
+}
+
+}
+
+template <>
+struct BranchlessDescent<OptedInKey> : std::true_type
+{
+};
+
+// an arithmetic key opted out
+template <>
+struct BranchlessDescent<short> : std::false_type
+{
+};
+
+TEST(BranchlessDescent, DefaultsToArithmeticKeys)
+{
+    EXPECT_TRUE(BranchlessDescent<int>::value);
+    EXPECT_TRUE(BranchlessDescent<double>::value);
+    EXPECT_TRUE(BranchlessDescent<unsigned char>::value);
+    EXPECT_FALSE(BranchlessDescent<std::string>::value);
+    EXPECT_FALSE(BranchlessDescent<BoxedKey>::value);
+    EXPECT_TRUE(BranchlessDescent<OptedInKey>::value);
+    EXPECT_FALSE(BranchlessDescent<short>::value);
+}
+
+TEST(BranchlessDescent, SelectPicksWithoutBranching)
+{
+    int a = 1;
+    int b = 2;
+
+    EXPECT_EQ(&a, branchlessSelect(true, &a, &b));
+    EXPECT_EQ(&b, branchlessSelect(false, &a, &b));
+    EXPECT_EQ(nullptr, branchlessSelect(true, static_cast<int*>(nullptr), &b));
+    EXPECT_EQ(nullptr, branchlessSelect(false, &a, static_cast<int*>(nullptr)));
+
+    Node<int, int> parent(5, 0, nullptr);
+    Node<int, int> left(3, 0, &parent);
+    parent.setLeft(&left);
+    EXPECT_EQ(&left, parent.getChild(false));
+    EXPECT_EQ(nullptr, parent.getChild(true));
+}
+
+// both flavours of the walk over the same workload, against std::map
+TEST(BranchlessDescent, BothWalksAgree)
+{
+    for(unsigned seed = 1; seed <= 3; ++seed){
+        AVLTree<int, int> branchless;
+        AVLTree<BoxedKey, int> branching;
+        AVLTree<OptedInKey, int> optedIn;
+        BinarySearchTree<short, int> optedOut;
+        std::map<int, int> expected;
+        std::mt19937 rng(seed);
+        for(int step = 1; step <= 5000; ++step){
+            int key = static_cast<int>(rng() % 500) - 250;
+            if(rng() % 3 != 0){
+                branchless.insert(std::make_pair(key, step));
+                branching.insert(std::make_pair(BoxedKey(key), step));
+                optedIn.insert(std::make_pair(OptedInKey(key), step));
+                optedOut.insert(std::make_pair(static_cast<short>(key), step));
+                expected[key] = step;
+            }
+            else{
+                branchless.remove(key);
+                branching.remove(BoxedKey(key));
+                optedIn.remove(OptedInKey(key));
+                optedOut.remove(static_cast<short>(key));
+                expected.erase(key);
+            }
+        }
+        ASSERT_TRUE(sameContents(branchless, expected));
+        ASSERT_TRUE(branchless.isBalanced());
+        for(int key = -260; key < 260; ++key){
+            bool present = expected.count(key) != 0;
+            ASSERT_EQ(present, branching.find(BoxedKey(key)) != branching.end()) << key;
+            ASSERT_EQ(present, optedIn.find(OptedInKey(key)) != optedIn.end()) << key;
+            ASSERT_EQ(present, optedOut.find(static_cast<short>(key)) != optedOut.end()) << key;
+            if(present){
+                ASSERT_EQ(expected[key], optedIn.find(OptedInKey(key))->second);
+                ASSERT_EQ(expected[key], optedOut.find(static_cast<short>(key))->second);
+            }
+        }
+    }
+}
+
+// the branchless walk runs to the bottom; misses just past the ends too
+TEST(BranchlessDescent, FloatingPointKeys)
+{
+    AVLTree<double, int> tree;
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i * 0.5, i));
+    }
+
+    EXPECT_EQ(7, tree.find(3.5)->second);
+    EXPECT_TRUE(tree.find(3.25) == tree.end());
+    EXPECT_TRUE(tree.find(-0.5) == tree.end());
+    EXPECT_TRUE(tree.find(49.75) == tree.end());
+    // -0.0 == 0.0
+    EXPECT_EQ(0, tree.find(-0.0)->second);
+}
@@ -0,0 +1,106 @@
+#include "check_tree.h"
+
+#include <compactavl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <stdexcept>
+#include <string>
+
+TEST(CompactAVL, EmptyTree)
+{
+    CompactAVLTree<int, int> tree;
+
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(0u, tree.size());
+    EXPECT_TRUE(tree.begin() == tree.end());
+    EXPECT_TRUE(tree.find(3) == tree.end());
+    EXPECT_THROW(tree[3], std::out_of_range);
+    EXPECT_TRUE(tree.isBalanced());
+}
+
+TEST(CompactAVL, InsertOverwritesExistingKey)
+{
+    CompactAVLTree<std::string, int> tree;
+
+    tree.insert(std::make_pair(std::string("a"), 1));
+    tree.insert(std::make_pair(std::string("a"), 2));
+
+    EXPECT_EQ(1u, tree.size());
+    EXPECT_EQ(2, tree["a"]);
+}
+
+TEST(CompactAVL, SortedInsertStaysBalanced)
+{
+    CompactAVLTree<int, int> tree;
+    std::map<int, int> expected;
+
+    for(int i = 0; i < 1000; ++i){
+        tree.insert(std::make_pair(i, -i));
+        expected[i] = -i;
+        ASSERT_TRUE(tree.isBalanced()) << "after inserting " << i;
+    }
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+// removes keep the arena dense by moving the last node into the hole
+TEST(CompactAVL, RemoveKeepsArenaDense)
+{
+    CompactAVLTree<int, int> tree;
+    std::map<int, int> expected;
+    for(int i = 0; i < 200; ++i){
+        tree.insert(std::make_pair(i, i));
+        expected[i] = i;
+    }
+    for(int i = 0; i < 200; i += 3){
+        tree.remove(i);
+        expected.erase(i);
+        ASSERT_EQ(expected.size(), tree.size());
+        ASSERT_TRUE(tree.isBalanced()) << "after removing " << i;
+    }
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+TEST(CompactAVL, RandomAgainstStdMap)
+{
+    for(unsigned seed = 1; seed <= 5; ++seed){
+        CompactAVLTree<int, int> tree;
+        std::map<int, int> expected;
+        randomWorkload(tree, expected, seed, 20000, 2000, 250, [&](int step) {
+            ASSERT_TRUE(tree.isBalanced()) << "seed " << seed << ", step " << step;
+            ASSERT_EQ(expected.size(), tree.size());
+        });
+        EXPECT_TRUE(sameContents(tree, expected)) << "seed " << seed;
+        tree.clear();
+        EXPECT_TRUE(tree.empty());
+    }
+}
+
+// relayout() only moves nodes within the arena; the tree must not change
+TEST(CompactAVL, RelayoutKeepsContents)
+{
+    for(int count = 0; count <= 70; ++count){
+        CompactAVLTree<int, int> tree;
+        std::map<int, int> expected;
+        for(int i = 0; i < count; ++i){
+            int key = (i * 37) % 71;
+            tree.insert(std::make_pair(key, i));
+            expected[key] = i;
+        }
+        tree.relayout();
+        ASSERT_TRUE(tree.isBalanced()) << count << " entries";
+        ASSERT_TRUE(sameContents(tree, expected)) << count << " entries";
+    }
+}
+
+TEST(CompactAVL, RelayoutInterleavedWithUpdates)
+{
+    CompactAVLTree<int, int> tree;
+    std::map<int, int> expected;
+    randomWorkload(tree, expected, 7, 20000, 3000, 1000, [&](int step) {
+        tree.relayout();
+        ASSERT_TRUE(tree.isBalanced()) << "step " << step;
+        ASSERT_TRUE(sameContents(tree, expected)) << "step " << step;
+    });
+}
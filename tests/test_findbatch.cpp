@@ -0,0 +1,124 @@
+#include <avlbst.h>
+#include <bst.h>
+#include <lazyavl.h>
+#include <splitavl.h>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/**
+* Checks that findBatch(keys) returns exactly find(key) for every key.
+*/
+template <class Tree>
+testing::AssertionResult batchMatchesFind(const Tree& tree, const std::vector<int>& keys)
+{
+    std::vector<typename Tree::iterator> found;
+    tree.findBatch(keys, found);
+    if(found.size() != keys.size()){
+        return testing::AssertionFailure() << found.size() << " results for " << keys.size() << " keys";
+    }
+    for(size_t i = 0; i < keys.size(); ++i){
+        if(found[i] != tree.find(keys[i])){
+            return testing::AssertionFailure() << "findBatch and find disagree on key " << keys[i]
+                                               << " at position " << i;
+        }
+    }
+    return testing::AssertionSuccess();
+}
+
+// hits, misses below, between and above the keys, and repeats, in random order
+std::vector<int> mixedKeys(std::mt19937& rng, size_t count)
+{
+    std::vector<int> keys;
+    for(size_t i = 0; i < count; ++i){
+        keys.push_back(static_cast<int>(rng() % 2200) - 100);
+    }
+    if(!keys.empty()){
+        keys.push_back(keys[0]);
+    }
+    return keys;
+}
+
+}
+
+TEST(FindBatch, EmptyTreeAndEmptyBatch)
+{
+    AVLTree<int, int> tree;
+    std::vector<AVLTree<int, int>::iterator> found(3);
+
+    tree.findBatch(std::vector<int>(), found);
+    EXPECT_TRUE(found.empty());
+    EXPECT_TRUE(batchMatchesFind(tree, std::vector<int>(5, 1)));
+}
+
+// batch sizes around the lockstep group of 16
+TEST(FindBatch, MatchesFindForEveryBatchSize)
+{
+    std::mt19937 rng(3);
+    BinarySearchTree<int, int> bst;
+    AVLTree<int, int> avl;
+    for(int i = 0; i < 1000; ++i){
+        int key = static_cast<int>(rng() % 2000);
+        bst.insert(std::make_pair(key, i));
+        avl.insert(std::make_pair(key, i));
+    }
+    for(size_t count = 1; count <= 40; ++count){
+        std::vector<int> keys = mixedKeys(rng, count);
+        ASSERT_TRUE(batchMatchesFind(bst, keys)) << count << " keys";
+        ASSERT_TRUE(batchMatchesFind(avl, keys)) << count << " keys";
+    }
+}
+
+TEST(FindBatch, UsesTheLookupCache)
+{
+    std::mt19937 rng(4);
+    AVLTree<int, int> tree;
+    tree.enableLookupCache(64);
+    for(int i = 0; i < 2000; i += 2){
+        tree.insert(std::make_pair(i, i));
+    }
+    for(int round = 0; round < 5; ++round){
+        std::vector<int> keys = mixedKeys(rng, 500);
+        ASSERT_TRUE(batchMatchesFind(tree, keys));
+        tree.remove(keys[0] & ~1);
+    }
+}
+
+TEST(FindBatch, LazyTreeSkipsTombstones)
+{
+    std::mt19937 rng(5);
+    LazyAVLTree<int, int> tree(0.5);
+    for(int i = 0; i < 2000; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 2000; i += 3){
+        tree.remove(i);
+    }
+    ASSERT_GT(tree.tombstones(), 0u);
+
+    EXPECT_TRUE(batchMatchesFind(tree, mixedKeys(rng, 600)));
+}
+
+TEST(FindBatch, SplitTree)
+{
+    std::mt19937 rng(6);
+    SplitAVLTree<int, int> tree;
+    for(int i = 0; i < 1500; ++i){
+        tree.insert(std::make_pair(static_cast<int>(rng() % 2000), i));
+    }
+
+    std::vector<int> keys = mixedKeys(rng, 600);
+    EXPECT_TRUE(batchMatchesFind(tree, keys));
+    std::vector<SplitAVLTree<int, int>::iterator> found;
+    tree.findBatch(keys, found);
+    for(size_t i = 0; i < keys.size(); ++i){
+        if(found[i] != tree.end()){
+            ASSERT_EQ(keys[i], found[i]->first);
+        }
+    }
+}
@@ -0,0 +1,129 @@
+#include <intervaltree.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+typedef IntervalTree<int, int> Tree;
+typedef std::map<std::pair<int, int>, int> Intervals;
+
+// the intervals overlapping [lo, hi] in key order, by brute force
+std::vector<std::pair<int, int> > bruteOverlapping(const Intervals& intervals, int lo, int hi)
+{
+    std::vector<std::pair<int, int> > out;
+    for(Intervals::const_iterator it = intervals.begin(); it != intervals.end(); ++it){
+        if(it->first.first <= hi && lo <= it->first.second){
+            out.push_back(it->first);
+        }
+    }
+    return out;
+}
+
+std::vector<std::pair<int, int> > keysOf(const std::vector<Tree::iterator>& found)
+{
+    std::vector<std::pair<int, int> > out;
+    for(size_t i = 0; i < found.size(); ++i){
+        out.push_back(std::make_pair(found[i]->first.lo, found[i]->first.hi));
+    }
+    return out;
+}
+
+}
+
+TEST(IntervalTree, StabAndOverlap)
+{
+    Tree tree;
+    tree.insert(1, 5, 10);
+    tree.insert(3, 3, 20);
+    tree.insert(4, 9, 30);
+    tree.insert(10, 12, 40);
+
+    std::vector<Tree::iterator> at4 = tree.stab(4);
+    ASSERT_EQ(2u, at4.size());
+    EXPECT_EQ(10, at4[0]->second);
+    EXPECT_EQ(30, at4[1]->second);
+    EXPECT_EQ(2u, tree.stab(3).size());
+    EXPECT_TRUE(tree.stab(0).empty());
+    EXPECT_TRUE(tree.stab(13).empty());
+    // closed intervals: touching endpoints overlap
+    EXPECT_EQ(2u, tree.overlapping(9, 10).size());
+    EXPECT_TRUE(tree.overlapping(13, 20).empty());
+}
+
+TEST(IntervalTree, ReinsertReplacesAndRemoveDrops)
+{
+    Tree tree;
+    tree.insert(1, 5, 10);
+    tree.insert(1, 5, 11);
+    tree.insert(1, 6, 12);
+
+    ASSERT_EQ(2u, tree.stab(5).size());
+    EXPECT_EQ(11, tree.stab(5)[0]->second);
+
+    tree.remove(1, 6);
+    EXPECT_EQ(1u, tree.stab(5).size());
+    EXPECT_TRUE(tree.stab(6).empty());
+}
+
+TEST(IntervalTree, RandomAgainstBruteForce)
+{
+    std::mt19937 rng(5);
+    Tree tree;
+    Intervals intervals;
+    for(int step = 0; step < 3000; ++step){
+        int lo = static_cast<int>(rng() % 1000);
+        int hi = lo + static_cast<int>(rng() % 50);
+        if(rng() % 4 != 0){
+            tree.insert(lo, hi, step);
+            intervals[std::make_pair(lo, hi)] = step;
+        }
+        else if(!intervals.empty()){
+            // remove an existing interval
+            Intervals::iterator victim = intervals.lower_bound(std::make_pair(lo, 0));
+            if(victim == intervals.end()){
+                victim = intervals.begin();
+            }
+            tree.remove(victim->first.first, victim->first.second);
+            intervals.erase(victim);
+        }
+        if(step % 100 == 0){
+            ASSERT_TRUE(tree.isBalanced());
+            for(int q = 0; q < 20; ++q){
+                int qlo = static_cast<int>(rng() % 1100) - 50;
+                int qhi = qlo + static_cast<int>(rng() % 30);
+                ASSERT_EQ(bruteOverlapping(intervals, qlo, qhi), keysOf(tree.overlapping(qlo, qhi)))
+                    << "overlapping(" << qlo << ", " << qhi << ") at step " << step;
+            }
+        }
+    }
+}
+
+// the batched stab must answer exactly like one stab per point
+TEST(IntervalTree, BatchedStabMatchesSingleStabs)
+{
+    std::mt19937 rng(9);
+    Tree tree;
+    for(int i = 0; i < 500; ++i){
+        int lo = static_cast<int>(rng() % 1000);
+        tree.insert(lo, lo + static_cast<int>(rng() % 80), i);
+    }
+    std::vector<int> points;
+    for(int i = 0; i < 300; ++i){
+        points.push_back(static_cast<int>(rng() % 1200) - 100);
+    }
+    // duplicates too
+    points.push_back(points[0]);
+
+    std::vector<std::vector<Tree::iterator> > batch = tree.stab(points);
+
+    ASSERT_EQ(points.size(), batch.size());
+    for(size_t i = 0; i < points.size(); ++i){
+        EXPECT_EQ(keysOf(tree.stab(points[i])), keysOf(batch[i])) << "point " << points[i];
+    }
+}
@@ -0,0 +1,248 @@
+#include "check_tree.h"
+
+#include <lazyavl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+/**
+* Exposes the length of the incremental purge queue.
+*/
+class QueueLazyAVLTree : public LazyAVLTree<int, int>
+{
+public:
+    QueueLazyAVLTree(double maxDeadRatio, CompactionMode mode, size_t purgeBatch) :
+        LazyAVLTree<int, int>(maxDeadRatio, mode, purgeBatch)
+    {
+    }
+
+    size_t queued() const
+    {
+        return removed_.size();
+    }
+};
+
+}
+
+TEST(LazyAVLTree, RemoveLeavesTombstoneThatInsertRevives)
+{
+    LazyAVLTree<int, int> tree(0.9);
+    for(int i = 0; i < 10; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+
+    tree.remove(3);
+    tree.remove(3);
+
+    EXPECT_EQ(9u, tree.size());
+    EXPECT_EQ(1u, tree.tombstones());
+    EXPECT_TRUE(tree.find(3) == tree.end());
+    std::map<int, int> expected;
+    for(int i = 0; i < 10; ++i){
+        if(i != 3){
+            expected[i] = i;
+        }
+    }
+    EXPECT_TRUE(sameContents(tree, expected));
+
+    tree.insert(std::make_pair(3, 30));
+    expected[3] = 30;
+    EXPECT_EQ(10u, tree.size());
+    EXPECT_EQ(0u, tree.tombstones());
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+TEST(LazyAVLTree, AllDeadIsEmpty)
+{
+    LazyAVLTree<int, int> tree(0.99);
+    tree.insert(std::make_pair(1, 1));
+    tree.insert(std::make_pair(2, 2));
+    tree.remove(1);
+    tree.remove(2);
+
+    EXPECT_TRUE(tree.empty());
+    EXPECT_TRUE(tree.begin() == tree.end());
+}
+
+TEST(LazyAVLTree, RandomAgainstStdMap)
+{
+    for(unsigned seed = 1; seed <= 3; ++seed){
+        LazyAVLTree<int, int> rebuild(0.25, LazyAVLTree<int, int>::COMPACT_REBUILD);
+        LazyAVLTree<int, int> incremental(0.25, LazyAVLTree<int, int>::COMPACT_INCREMENTAL, 2);
+        std::map<int, int> expected;
+        std::map<int, int> expectedIncremental;
+        randomWorkload(rebuild, expected, seed, 5000, 400, 250, [&](int step) {
+            ASSERT_TRUE(rebuild.isBalanced()) << "seed " << seed << ", step " << step;
+            ASSERT_EQ(expected.size(), rebuild.size());
+            ASSERT_TRUE(sameContents(rebuild, expected)) << "seed " << seed << ", step " << step;
+        });
+        randomWorkload(incremental, expectedIncremental, seed, 5000, 400, 250, [&](int step) {
+            ASSERT_TRUE(incremental.isBalanced()) << "seed " << seed << ", step " << step;
+            ASSERT_EQ(expectedIncremental.size(), incremental.size());
+            ASSERT_TRUE(sameContents(incremental, expectedIncremental)) << "seed " << seed << ", step " << step;
+        });
+    }
+}
+
+TEST(LazyAVLTree, TombstonesStayUnderTheRatio)
+{
+    LazyAVLTree<int, int> tree(0.25, LazyAVLTree<int, int>::COMPACT_INCREMENTAL, 2);
+    for(int i = 0; i < 1000; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 1000; i += 2){
+        tree.remove(i);
+        ASSERT_LE(tree.tombstones(), (tree.size() + tree.tombstones()) / 4 + 2);
+    }
+    EXPECT_EQ(500u, tree.size());
+}
+
+// a remove/revive cycle leaves a stale queue entry; they must not pile up
+TEST(LazyAVLTree, IncrementalQueueStaysBounded)
+{
+    QueueLazyAVLTree tree(0.25, QueueLazyAVLTree::COMPACT_INCREMENTAL, 2);
+    std::map<int, int> expected;
+    for(int i = 0; i < 1000; ++i){
+        tree.insert(std::make_pair(i, i));
+        expected[i] = i;
+    }
+    for(int cycle = 0; cycle < 2000; ++cycle){
+        int key = (cycle * 7) % 1000;
+        tree.remove(key);
+        tree.insert(std::make_pair(key, cycle));
+        expected[key] = cycle;
+        ASSERT_LE(tree.queued(), 2 * tree.tombstones() + 2);
+    }
+    EXPECT_EQ(0u, tree.tombstones());
+    EXPECT_LE(tree.queued(), 2u);
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+// BinarySearchTree::clear() removed until empty, which tombstones never are
+TEST(LazyAVLTree, ClearThroughBaseReference)
+{
+    LazyAVLTree<int, int> tree(0.9);
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    tree.remove(5);
+
+    BinarySearchTree<int, int>& base = tree;
+    base.clear();
+
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(0u, tree.size());
+    EXPECT_EQ(0u, tree.tombstones());
+    tree.insert(std::make_pair(5, 50));
+    EXPECT_EQ(1u, tree.size());
+}
+
+// the hinted insert is virtual, so a base reference still counts and revives
+TEST(LazyAVLTree, HintedInsertRevivesAndCounts)
+{
+    for(int mode = 0; mode < 2; ++mode){
+        LazyAVLTree<int, int> tree(0.5, mode == 0 ? LazyAVLTree<int, int>::COMPACT_REBUILD
+                                                  : LazyAVLTree<int, int>::COMPACT_INCREMENTAL);
+        AVLTree<int, int>& base = tree;
+        std::map<int, int> expected;
+        AVLTree<int, int>::iterator hint = base.end();
+        for(int i = 0; i < 100; i += 2){
+            hint = base.insert(base.end(), std::make_pair(i, i));
+            expected[i] = i;
+        }
+        for(int i = 0; i < 100; i += 4){
+            tree.remove(i);
+            expected.erase(i);
+        }
+        ASSERT_GT(tree.tombstones(), 0u);
+        for(int i = 0; i < 100; ++i){
+            // a tombstone as the hint, and a hint at the dead key itself
+            hint = base.insert(i % 8 == 0 ? base.find(i) : base.find(i + 1), std::make_pair(i, -i));
+            ASSERT_EQ(i, hint->first);
+            expected[i] = -i;
+            ASSERT_EQ(expected.size(), tree.size()) << "mode " << mode << ", key " << i;
+        }
+        EXPECT_EQ(0u, tree.tombstones());
+        EXPECT_TRUE(tree.isBalanced());
+        EXPECT_TRUE(sameContents(tree, expected));
+    }
+}
+
+TEST(LazyAVLTree, CompactDropsTombstones)
+{
+    LazyAVLTree<int, int> tree(1.0, LazyAVLTree<int, int>::COMPACT_INCREMENTAL);
+    std::map<int, int> expected;
+    for(int i = 0; i < 500; ++i){
+        tree.insert(std::make_pair(i, i));
+        expected[i] = i;
+    }
+    for(int i = 0; i < 500; i += 3){
+        tree.remove(i);
+        expected.erase(i);
+    }
+
+    tree.compact();
+
+    EXPECT_EQ(0u, tree.tombstones());
+    EXPECT_TRUE(tree.isBalanced());
+    EXPECT_TRUE(sameContents(tree, expected));
+    tree.remove(1);
+    tree.insert(std::make_pair(1, 11));
+    expected[1] = 11;
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+TEST(LazyAVLTree, FindBatchSkipsTombstones)
+{
+    LazyAVLTree<int, int> tree(0.9);
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    tree.remove(40);
+    std::vector<int> keys;
+    keys.push_back(40);
+    keys.push_back(41);
+    keys.push_back(500);
+    std::vector<LazyAVLTree<int, int>::iterator> found;
+
+    tree.findBatch(keys, found);
+
+    ASSERT_EQ(3u, found.size());
+    EXPECT_TRUE(found[0] == tree.end());
+    EXPECT_EQ(41, found[1]->second);
+    EXPECT_TRUE(found[2] == tree.end());
+}
+
+TEST(LazyAVLTree, SnapshotHoldsOnlyLiveEntries)
+{
+    LazyAVLTree<int, int> tree(0.9);
+    std::map<int, int> expected;
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i, -i));
+        expected[i] = -i;
+    }
+    for(int i = 0; i < 100; i += 4){
+        tree.remove(i);
+        expected.erase(i);
+    }
+    size_t tombstones = tree.tombstones();
+    ASSERT_GT(tombstones, 0u);
+    // saving through the base class filters too, and compacts nothing
+    std::stringstream snapshot;
+    const BinarySearchTree<int, int>& base = tree;
+    base.save(snapshot);
+    EXPECT_EQ(tombstones, tree.tombstones());
+
+    LazyAVLTree<int, int> loaded;
+    loaded.load(snapshot);
+
+    EXPECT_EQ(expected.size(), loaded.size());
+    EXPECT_EQ(0u, loaded.tombstones());
+    EXPECT_TRUE(sameContents(loaded, expected));
+}
@@ -0,0 +1,126 @@
+#include "check_tree.h"
+
+#include <avlbst.h>
+#include <bst.h>
+#include <lazyavl.h>
+#include <lookup_cache.h>
+#include <tree_stats.h>
+#include <wavlbst.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+TEST(LookupCache, RoundsSlotsUpToAPowerOfTwo)
+{
+    EXPECT_EQ(4u, (LookupCache<int, int>(0).slots()));
+    EXPECT_EQ(4u, (LookupCache<int, int>(3).slots()));
+    EXPECT_EQ(64u, (LookupCache<int, int>(33).slots()));
+}
+
+TEST(LookupCache, StoreLookupForget)
+{
+    LookupCache<int, int> cache(64);
+    Node<int, int> a(1, 10, nullptr);
+    Node<int, int> b(2, 20, nullptr);
+
+    EXPECT_EQ(nullptr, cache.lookup(1));
+    cache.store(1, &a);
+    cache.store(2, &b);
+    EXPECT_EQ(&a, cache.lookup(1));
+    EXPECT_EQ(&b, cache.lookup(2));
+    EXPECT_EQ(nullptr, cache.lookup(3));
+
+    // forgetting a node that is not cached leaves the slot alone
+    Node<int, int> other(1, 11, nullptr);
+    cache.forget(&other);
+    EXPECT_EQ(&a, cache.lookup(1));
+    cache.forget(&a);
+    EXPECT_EQ(nullptr, cache.lookup(1));
+
+    cache.flush();
+    EXPECT_EQ(nullptr, cache.lookup(2));
+}
+
+// a few slots shared by many keys: every lookup is checked against the key
+TEST(LookupCache, CollidingKeysAreNotConfused)
+{
+    AVLTree<int, int> tree;
+    tree.enableLookupCache(4);
+    for(int i = 0; i < 200; ++i){
+        tree.insert(std::make_pair(i, i * 3));
+    }
+    for(int round = 0; round < 3; ++round){
+        for(int i = 0; i < 200; ++i){
+            ASSERT_EQ(i * 3, tree.find(i)->second);
+        }
+    }
+    EXPECT_TRUE(tree.find(500) == tree.end());
+}
+
+// removes free nodes and nodeSwap moves them; no cached entry may outlive
+// its node or point at the wrong key
+TEST(LookupCache, TreesStayCorrectWithCacheEnabled)
+{
+    for(unsigned seed = 1; seed <= 3; ++seed){
+        BinarySearchTree<int, int> bst;
+        AVLTree<int, int> avl;
+        WAVLTree<int, int> wavl;
+        LazyAVLTree<int, int> lazy(0.25, LazyAVLTree<int, int>::COMPACT_INCREMENTAL);
+        bst.enableLookupCache(64);
+        avl.enableLookupCache(64);
+        wavl.enableLookupCache(64);
+        lazy.enableLookupCache(64);
+        std::map<int, int> expected[4];
+        // the check reads every key, so the cache is warm before the next batch
+        randomWorkload(bst, expected[0], seed, 3000, 300, 100, [&](int step) {
+            ASSERT_TRUE(sameContents(bst, expected[0])) << "seed " << seed << ", step " << step;
+        });
+        randomWorkload(avl, expected[1], seed, 3000, 300, 100, [&](int step) {
+            ASSERT_TRUE(sameContents(avl, expected[1])) << "seed " << seed << ", step " << step;
+        });
+        randomWorkload(wavl, expected[2], seed, 3000, 300, 100, [&](int step) {
+            ASSERT_TRUE(sameContents(wavl, expected[2])) << "seed " << seed << ", step " << step;
+        });
+        randomWorkload(lazy, expected[3], seed, 3000, 300, 100, [&](int step) {
+            ASSERT_TRUE(sameContents(lazy, expected[3])) << "seed " << seed << ", step " << step;
+        });
+    }
+}
+
+TEST(LookupCache, ClearAndDisable)
+{
+    AVLTree<int, int> tree;
+    tree.enableLookupCache(16);
+    for(int i = 0; i < 20; ++i){
+        tree.insert(std::make_pair(i, i));
+        tree.find(i);
+    }
+
+    tree.clear();
+    EXPECT_TRUE(tree.find(3) == tree.end());
+    tree.insert(std::make_pair(3, 33));
+    EXPECT_EQ(33, tree.find(3)->second);
+
+    tree.enableLookupCache(0);
+    EXPECT_EQ(33, tree.find(3)->second);
+}
+
+#ifdef BST_STATS
+TEST(LookupCache, HitsAreReported)
+{
+    AVLTree<int, int> tree;
+    tree.enableLookupCache(64);
+    for(int i = 0; i < 1000; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    treeStatsReset();
+    for(int round = 0; round < 10; ++round){
+        tree.find(7);
+    }
+
+    TreeStatsSnapshot snapshot = treeStatsSnapshot();
+    EXPECT_EQ(9u, snapshot.counters[TREE_CACHE_HITS]);
+    EXPECT_EQ(1u, snapshot.counters[TREE_CACHE_MISSES]);
+}
+#endif
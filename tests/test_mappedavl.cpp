@@ -0,0 +1,223 @@
+#include "check_tree.h"
+
+#include <mappedavl.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+
+typedef MappedAVLTree<int, int> Tree;
+typedef MappedArena<CompactAVLNode<int, int> > Arena;
+
+class MappedAVL : public testing::Test
+{
+protected:
+    MappedAVL() :
+        path_(testing::TempDir() + "mappedavl-" + std::to_string(::getpid()) + ".avl")
+    {
+        ::unlink(path_.c_str());
+    }
+
+    ~MappedAVL()
+    {
+        ::unlink(path_.c_str());
+    }
+
+    std::string readFile(const std::string& path) const
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::string& path, const std::string& bytes) const
+    {
+        std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size());
+    }
+
+    // rewrites one header field of the closed arena file
+    template <class Field>
+    void patchHeader(size_t offset, Field value) const
+    {
+        std::string bytes = readFile(path_);
+        std::memcpy(&bytes[offset], &value, sizeof(value));
+        writeFile(path_, bytes);
+    }
+
+    void fill(int count) const
+    {
+        Tree tree(path_);
+        for(int i = 0; i < count; ++i){
+            tree.insert(std::make_pair(i, i * 2));
+        }
+    }
+
+    std::string path_;
+};
+
+}
+
+TEST_F(MappedAVL, ReopensWhatWasWritten)
+{
+    std::map<int, int> expected;
+    {
+        Tree tree(path_);
+        EXPECT_TRUE(tree.empty());
+        for(int i = 0; i < 5000; ++i){
+            int key = (i * 7919) % 5000;
+            tree.insert(std::make_pair(key, i));
+            expected[key] = i;
+        }
+        for(int key = 0; key < 5000; key += 4){
+            tree.remove(key);
+            expected.erase(key);
+        }
+        tree.sync();
+    }
+
+    Tree reopened(path_);
+    EXPECT_EQ(expected.size(), reopened.size());
+    EXPECT_TRUE(reopened.isBalanced());
+    EXPECT_TRUE(sameContents(reopened, expected));
+}
+
+TEST_F(MappedAVL, CloseWithoutSyncIsClean)
+{
+    fill(100);
+
+    Tree reopened(path_);
+    EXPECT_EQ(100u, reopened.size());
+    EXPECT_EQ(198, reopened[99]);
+}
+
+TEST_F(MappedAVL, RandomAgainstStdMapAcrossReopens)
+{
+    std::map<int, int> expected;
+    for(unsigned round = 1; round <= 4; ++round){
+        Tree tree(path_);
+        ASSERT_TRUE(sameContents(tree, expected)) << "after reopening for round " << round;
+        randomWorkload(tree, expected, round, 5000, 1000, 500, [&](int step) {
+            ASSERT_TRUE(tree.isBalanced()) << "round " << round << ", step " << step;
+        });
+        if(round % 2 == 0){
+            tree.relayout();
+        }
+    }
+    Tree tree(path_);
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+// a copy taken between a change and the next sync, as a crash would leave it
+TEST_F(MappedAVL, RefusesFileThatWasNotSynced)
+{
+    std::string copy = path_ + ".crashed";
+    {
+        Tree tree(path_);
+        tree.insert(std::make_pair(1, 1));
+        tree.sync();
+        tree.insert(std::make_pair(2, 2));
+        writeFile(copy, readFile(path_));
+    }
+    EXPECT_THROW(Tree crashed(copy), std::runtime_error);
+    ::unlink(copy.c_str());
+
+    Tree tree(path_);
+    EXPECT_EQ(2u, tree.size());
+}
+
+TEST_F(MappedAVL, SyncedCopyReopens)
+{
+    std::string copy = path_ + ".copy";
+    {
+        Tree tree(path_);
+        tree.insert(std::make_pair(1, 1));
+        tree.sync();
+        writeFile(copy, readFile(path_));
+    }
+    Tree reopened(copy);
+    EXPECT_EQ(1, reopened[1]);
+    ::unlink(copy.c_str());
+}
+
+// reads alone must not leave the header dirty
+TEST_F(MappedAVL, ConstReadsKeepFileClean)
+{
+    fill(50);
+    std::string copy = path_ + ".copy";
+    {
+        Tree tree(path_);
+        const Tree& reader = tree;
+        int sum = 0;
+        for(Tree::iterator it = reader.begin(); it != reader.end(); ++it){
+            sum += it->second;
+        }
+        EXPECT_EQ(49 * 50, sum);
+        EXPECT_EQ(20, reader.find(10)->second);
+        EXPECT_EQ(40, reader[20]);
+        writeFile(copy, readFile(path_));
+    }
+    Tree reopened(copy);
+    EXPECT_EQ(50u, reopened.size());
+    ::unlink(copy.c_str());
+}
+
+TEST_F(MappedAVL, RefusesSizeBeyondCapacity)
+{
+    fill(10);
+    patchHeader(offsetof(MappedArenaHeader, size), static_cast<uint64_t>(50000000));
+
+    EXPECT_THROW(Tree tree(path_), std::runtime_error);
+}
+
+TEST_F(MappedAVL, RefusesCapacityBeyondFile)
+{
+    fill(10);
+    patchHeader(offsetof(MappedArenaHeader, capacity), static_cast<uint64_t>(1) << 40);
+
+    EXPECT_THROW(Tree tree(path_), std::runtime_error);
+}
+
+TEST_F(MappedAVL, RefusesRootOutsideTree)
+{
+    fill(10);
+    patchHeader(offsetof(MappedArenaHeader, root), static_cast<uint32_t>(10));
+
+    EXPECT_THROW(Tree tree(path_), std::runtime_error);
+}
+
+TEST_F(MappedAVL, RefusesMissingRootOfNonEmptyTree)
+{
+    fill(10);
+    patchHeader(offsetof(MappedArenaHeader, root), static_cast<uint32_t>(0xFFFFFFFFu));
+
+    EXPECT_THROW(Tree tree(path_), std::runtime_error);
+}
+
+TEST_F(MappedAVL, RefusesOtherNodeLayout)
+{
+    fill(10);
+
+    EXPECT_THROW((MappedAVLTree<int, double>(path_)), std::runtime_error);
+    Tree tree(path_);
+    EXPECT_EQ(10u, tree.size());
+}
+
+TEST_F(MappedAVL, RefusedArenaIsClosed)
+{
+    fill(10);
+    patchHeader(offsetof(MappedArenaHeader, root), static_cast<uint32_t>(10));
+
+    Arena arena;
+    EXPECT_THROW(arena.open(path_), std::runtime_error);
+    EXPECT_FALSE(arena.isOpen());
+}
@@ -0,0 +1,115 @@
+#include "check_tree.h"
+
+#include <avlbst.h>
+#include <bst.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+
+// whether tree.enableScapegoat(alpha) is callable from outside the class
+template <class Tree, class = void>
+struct HasPublicScapegoat : std::false_type
+{
+};
+
+template <class Tree>
+struct HasPublicScapegoat<Tree, decltype(std::declval<Tree&>().enableScapegoat(0.7))> : std::true_type
+{
+};
+
+// nodes on the longest path allowed right after an insert: the new node
+// sits at most log base 1/alpha of the size edges deep
+size_t heightBound(size_t size, double alpha)
+{
+    return static_cast<size_t>(std::floor(std::log(static_cast<double>(size)) / -std::log(alpha) + 1e-9)) + 1;
+}
+
+}
+
+// trees with their own insert and remove never get scapegoat rebuilds
+TEST(ScapegoatBST, OnlyThePlainTreeExposesTheMode)
+{
+    EXPECT_TRUE((HasPublicScapegoat<ScapegoatBST<int, int> >::value));
+    EXPECT_FALSE((HasPublicScapegoat<BinarySearchTree<int, int> >::value));
+    EXPECT_FALSE((HasPublicScapegoat<AVLTree<int, int> >::value));
+}
+
+TEST(ScapegoatBST, RejectsBadAlpha)
+{
+    EXPECT_THROW((ScapegoatBST<int, int>(0.4)), std::invalid_argument);
+    EXPECT_THROW((ScapegoatBST<int, int>(1.0)), std::invalid_argument);
+    EXPECT_THROW((ScapegoatBST<int, int>(0)), std::invalid_argument);
+    ScapegoatBST<int, int> tree;
+    EXPECT_THROW(tree.enableScapegoat(0.3), std::invalid_argument);
+}
+
+// sorted input degenerates a plain tree into a list
+TEST(ScapegoatBST, SortedInsertsStayWithinAlphaLogN)
+{
+    const double alphas[] = { 0.55, 0.7, 0.9 };
+    for(size_t a = 0; a < 3; ++a){
+        double alpha = alphas[a];
+        ScapegoatBST<int, int> ascending(alpha);
+        ScapegoatBST<int, int> descending(alpha);
+        for(int i = 1; i <= 4000; ++i){
+            ascending.insert(std::make_pair(i, i));
+            descending.insert(std::make_pair(-i, i));
+            if(i > 256 && i % 16 != 0){
+                continue;
+            }
+            ASSERT_LE(ascending.shape().height(), heightBound(i, alpha)) << "alpha " << alpha << ", size " << i;
+            ASSERT_LE(descending.shape().height(), heightBound(i, alpha)) << "alpha " << alpha << ", size " << i;
+        }
+        std::map<int, int> expected;
+        for(int i = 1; i <= 4000; ++i){
+            expected[i] = i;
+        }
+        EXPECT_TRUE(sameContents(ascending, expected));
+    }
+}
+
+// removes may leave the tree one level deeper than the insert bound until
+// it shrinks below alpha of its peak size and is rebuilt
+TEST(ScapegoatBST, RandomAgainstStdMap)
+{
+    for(unsigned seed = 1; seed <= 3; ++seed){
+        double alpha = 0.6 + 0.1 * seed;
+        ScapegoatBST<int, int> tree(alpha);
+        std::map<int, int> expected;
+        randomWorkload(tree, expected, seed, 6000, 800, 100, [&](int step) {
+            if(!expected.empty()){
+                ASSERT_LE(tree.shape().height(), heightBound(expected.size(), alpha) + 1)
+                    << "seed " << seed << ", step " << step;
+            }
+            ASSERT_TRUE(sameContents(tree, expected)) << "seed " << seed << ", step " << step;
+        });
+        // shrink to nothing through the full rebuilds
+        for(int key = 0; key < 800; ++key){
+            tree.remove(key);
+        }
+        EXPECT_TRUE(tree.empty());
+    }
+}
+
+TEST(ScapegoatBST, EnablingRepairsADegenerateTree)
+{
+    ScapegoatBST<int, int> tree;
+    tree.enableScapegoat(0);
+    for(int i = 0; i < 1023; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    ASSERT_EQ(1023u, tree.shape().height());
+
+    tree.enableScapegoat(0.75);
+
+    EXPECT_EQ(10u, tree.shape().height());
+    EXPECT_TRUE(tree.isBalanced());
+}
@@ -0,0 +1,263 @@
+#include "check_tree.h"
+
+#include <skiplist.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+typedef LockFreeSkipList<int, int> List;
+
+/**
+* A value that counts its live instances, so tests can see how many
+* replaced items are still held.
+*/
+struct Counted
+{
+    Counted(int v = 0) : value(v) { live++; }
+    Counted(const Counted& other) : value(other.value) { live++; }
+    ~Counted() { live--; }
+
+    int value;
+    static std::atomic<long> live;
+};
+
+std::atomic<long> Counted::live(0);
+
+typedef LockFreeSkipList<int, Counted> CountedList;
+
+/**
+* A list that counts its thread records.
+*/
+class RecordCountingList : public List
+{
+public:
+    size_t records() const
+    {
+        size_t count = 0;
+        for(ThreadRecord* rec = records_.load(); rec != nullptr; rec = rec->next){
+            count++;
+        }
+        return count;
+    }
+};
+
+// values written by the concurrent tests name their key
+int valueFor(int key, int step)
+{
+    return key * 100000 + step;
+}
+
+}
+
+TEST(LockFreeSkipList, InsertOverwriteRemove)
+{
+    List list;
+    EXPECT_TRUE(list.empty());
+    list.insert(std::make_pair(2, 20));
+    list.insert(std::make_pair(1, 10));
+    list.insert(std::make_pair(2, 21));
+
+    EXPECT_EQ(21, list[2]);
+    EXPECT_EQ(10, list.find(1)->second);
+    EXPECT_THROW(list[3], std::out_of_range);
+
+    list.remove(1);
+    list.remove(3);
+    std::map<int, int> expected;
+    expected[2] = 21;
+    EXPECT_TRUE(sameContents(list, expected));
+
+    list.clear();
+    EXPECT_TRUE(list.empty());
+    list.insert(std::make_pair(5, 50));
+    EXPECT_EQ(50, list[5]);
+}
+
+TEST(LockFreeSkipList, RandomAgainstStdMap)
+{
+    for(unsigned seed = 1; seed <= 4; ++seed){
+        List list;
+        std::map<int, int> expected;
+        randomWorkload(list, expected, seed, 20000, 500, 500, [&](int step) {
+            ASSERT_TRUE(sameContents(list, expected)) << "seed " << seed << ", step " << step;
+        });
+    }
+}
+
+// writers on interleaved keys, so they fight over the same links, while
+// readers walk and search the list under guards
+TEST(LockFreeSkipList, ConcurrentWritersAndReaders)
+{
+    const int writers = 4;
+    const int keyRange = 2000;
+    List list;
+    std::vector<std::map<int, int> > expected(writers);
+    std::atomic<int> running(writers);
+    std::atomic<long> badEntries(0);
+
+    std::vector<std::thread> pool;
+    for(int t = 0; t < writers; ++t){
+        pool.push_back(std::thread([&, t]() {
+            std::mt19937 rng(t + 1);
+            for(int step = 1; step <= 30000; ++step){
+                int key = static_cast<int>(rng() % (keyRange / writers)) * writers + t;
+                if(rng() % 3 != 0){
+                    list.insert(std::make_pair(key, valueFor(key, step)));
+                    expected[t][key] = valueFor(key, step);
+                }
+                else{
+                    list.remove(key);
+                    expected[t].erase(key);
+                }
+            }
+            running--;
+        }));
+    }
+    for(int r = 0; r < 2; ++r){
+        pool.push_back(std::thread([&, r]() {
+            std::mt19937 rng(100 + r);
+            while(running.load() > 0){
+                {
+                    List::Guard guard(list);
+                    int previous = -1;
+                    for(List::iterator it = list.begin(); it != list.end(); ++it){
+                        if(it->first <= previous || it->second / 100000 != it->first){
+                            badEntries++;
+                        }
+                        previous = it->first;
+                    }
+                }
+                for(int q = 0; q < 200; ++q){
+                    int key = static_cast<int>(rng() % keyRange);
+                    List::Guard guard(list);
+                    List::iterator it = list.find(key);
+                    if(it != list.end() && (it->first != key || it->second / 100000 != key)){
+                        badEntries++;
+                    }
+                    try{
+                        if(list[key] / 100000 != key){
+                            badEntries++;
+                        }
+                    }
+                    catch(const std::out_of_range&){
+                    }
+                }
+            }
+        }));
+    }
+    for(size_t i = 0; i < pool.size(); ++i){
+        pool[i].join();
+    }
+
+    EXPECT_EQ(0, badEntries.load());
+    std::map<int, int> all;
+    for(int t = 0; t < writers; ++t){
+        all.insert(expected[t].begin(), expected[t].end());
+    }
+    EXPECT_TRUE(sameContents(list, all));
+}
+
+// replaced items are freed as the epoch moves on, not kept until clear()
+TEST(LockFreeSkipList, OverwritesAreReclaimed)
+{
+    CountedList list;
+    long before = Counted::live.load();
+    for(int i = 0; i < 100000; ++i){
+        list.insert(std::make_pair(i % 10, Counted(i)));
+    }
+    // 10 entries plus what the last three epochs retired
+    EXPECT_LT(Counted::live.load() - before, 500);
+
+    std::vector<std::thread> pool;
+    for(int t = 0; t < 4; ++t){
+        pool.push_back(std::thread([&list, t]() {
+            for(int i = 0; i < 50000; ++i){
+                list.insert(std::make_pair(i % 10, Counted(i)));
+                if(i % 7 == t){
+                    list.remove(i % 10);
+                }
+            }
+        }));
+    }
+    for(size_t i = 0; i < pool.size(); ++i){
+        pool[i].join();
+    }
+    EXPECT_LT(Counted::live.load() - before, 2000);
+
+    list.clear();
+    EXPECT_EQ(before, Counted::live.load());
+}
+
+// a guard keeps what it can reach alive, and holds back reclamation
+// until it is dropped
+TEST(LockFreeSkipList, GuardKeepsReferencesValid)
+{
+    CountedList list;
+    long before = Counted::live.load();
+    list.insert(std::make_pair(1, Counted(-1)));
+    {
+        CountedList::Guard guard(list);
+        const Counted& held = list[1];
+        std::thread writer([&list]() {
+            for(int i = 0; i < 10000; ++i){
+                list.insert(std::make_pair(1, Counted(i)));
+            }
+            list.remove(1);
+        });
+        writer.join();
+
+        EXPECT_EQ(-1, held.value);
+        EXPECT_GT(Counted::live.load() - before, 9000);
+    }
+    for(int i = 0; i < 1000; ++i){
+        list.insert(std::make_pair(2, Counted(i)));
+    }
+    EXPECT_LT(Counted::live.load() - before, 500);
+}
+
+// more lists than a thread caches records for: pins reuse free records
+// instead of leaving one behind per call
+TEST(LockFreeSkipList, RecordsAreReused)
+{
+    const int lists = 9;
+    std::vector<RecordCountingList> all(lists);
+    for(int i = 0; i < lists; ++i){
+        all[i].insert(std::make_pair(i, i));
+    }
+    for(int round = 0; round < 2000; ++round){
+        for(int i = 0; i < lists; ++i){
+            ASSERT_TRUE(all[i].find(i) != all[i].end());
+        }
+    }
+    for(int i = 0; i < lists; ++i){
+        EXPECT_EQ(1u, all[i].records());
+    }
+
+    std::vector<std::thread> pool;
+    for(int t = 0; t < 4; ++t){
+        pool.push_back(std::thread([&all, t]() {
+            for(int round = 0; round < 2000; ++round){
+                for(int i = 0; i < lists; ++i){
+                    all[i].insert(std::make_pair(i, round));
+                    all[i].find((i + t) % lists);
+                }
+            }
+        }));
+    }
+    for(size_t i = 0; i < pool.size(); ++i){
+        pool[i].join();
+    }
+    for(int i = 0; i < lists; ++i){
+        // at most one pin per thread at a time, and the main thread's
+        EXPECT_LE(all[i].records(), 5u);
+    }
+}
@@ -0,0 +1,129 @@
+#include "check_tree.h"
+
+#include <avlbst.h>
+#include <bst.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+template <class Tree>
+std::string snapshotOf(const Tree& tree)
+{
+    std::ostringstream out;
+    tree.save(out);
+    return out.str();
+}
+
+template <class Tree>
+void loadFrom(Tree& tree, const std::string& bytes)
+{
+    std::istringstream in(bytes);
+    tree.load(in);
+}
+
+}
+
+TEST(Snapshot, EmptyTreeRoundTrips)
+{
+    AVLTree<int, int> empty;
+    AVLTree<int, int> loaded;
+    loaded.insert(std::make_pair(1, 1));
+
+    loadFrom(loaded, snapshotOf(empty));
+
+    EXPECT_TRUE(loaded.empty());
+}
+
+TEST(Snapshot, LoadReplacesContentsAndIsBalanced)
+{
+    AVLTree<int, int> tree;
+    std::map<int, int> expected;
+    for(int i = 0; i < 1000; ++i){
+        tree.insert(std::make_pair(i * 3, i));
+        expected[i * 3] = i;
+    }
+
+    AVLTree<int, int> loaded;
+    loaded.insert(std::make_pair(-1, -1));
+    loadFrom(loaded, snapshotOf(tree));
+
+    EXPECT_TRUE(loaded.isBalanced());
+    EXPECT_TRUE(sameContents(loaded, expected));
+}
+
+// the balance factors of the rebuilt nodes must be right for later rebalancing
+TEST(Snapshot, LoadedAVLTreeKeepsBalancingCorrectly)
+{
+    for(int count = 1; count <= 64; ++count){
+        AVLTree<int, int> tree;
+        std::map<int, int> expected;
+        for(int i = 0; i < count; ++i){
+            tree.insert(std::make_pair(i, i));
+            expected[i] = i;
+        }
+        AVLTree<int, int> loaded;
+        loadFrom(loaded, snapshotOf(tree));
+        randomWorkload(loaded, expected, count, 400, 2 * count, 1, [&](int step) {
+            ASSERT_TRUE(loaded.isBalanced()) << count << " entries, step " << step;
+        });
+        EXPECT_TRUE(sameContents(loaded, expected)) << count << " entries";
+    }
+}
+
+TEST(Snapshot, StringKeysAndValuesRoundTrip)
+{
+    BinarySearchTree<std::string, std::string> tree;
+    std::map<std::string, std::string> expected;
+    for(int i = 0; i < 200; ++i){
+        std::string key = "key" + std::to_string(i);
+        std::string value(static_cast<size_t>(i), 'v');
+        tree.insert(std::make_pair(key, value));
+        expected[key] = value;
+    }
+
+    BinarySearchTree<std::string, std::string> loaded;
+    loadFrom(loaded, snapshotOf(tree));
+
+    EXPECT_TRUE(loaded.isBalanced());
+    EXPECT_TRUE(sameContents(loaded, expected));
+}
+
+TEST(Snapshot, TruncatedSnapshotThrowsAndLeavesTreeEmpty)
+{
+    AVLTree<int, int> tree;
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    std::string bytes = snapshotOf(tree);
+
+    for(size_t cut = 0; cut < bytes.size(); cut += 37){
+        AVLTree<int, int> loaded;
+        loaded.insert(std::make_pair(1, 1));
+        EXPECT_THROW(loadFrom(loaded, bytes.substr(0, cut)), std::runtime_error) << "cut at " << cut;
+        EXPECT_TRUE(loaded.empty()) << "cut at " << cut;
+    }
+}
+
+TEST(Snapshot, RejectsOtherFiles)
+{
+    AVLTree<int, int> loaded;
+
+    EXPECT_THROW(loadFrom(loaded, std::string(64, 'x')), std::runtime_error);
+    EXPECT_TRUE(loaded.empty());
+}
+
+TEST(Snapshot, RejectsMismatchedFieldSize)
+{
+    AVLTree<int, int> tree;
+    tree.insert(std::make_pair(1, 1));
+
+    AVLTree<long long, int> loaded;
+    EXPECT_THROW(loadFrom(loaded, snapshotOf(tree)), std::runtime_error);
+}
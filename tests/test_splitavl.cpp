@@ -0,0 +1,142 @@
+#include "check_tree.h"
+
+#include <splitavl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/**
+* Throws from its constructor when asked to, and counts live objects.
+*/
+struct Fragile
+{
+    explicit Fragile(bool fail)
+    {
+        if(fail){
+            throw std::runtime_error("construction failed");
+        }
+        live++;
+    }
+    ~Fragile()
+    {
+        live--;
+    }
+
+    char payload[40];
+    static int live;
+};
+
+int Fragile::live = 0;
+
+}
+
+TEST(ValueSlab, ReusesFreedSlots)
+{
+    ValueSlab<std::string> slab;
+    std::vector<std::string*> items;
+    for(int i = 0; i < 600; ++i){
+        items.push_back(slab.create(std::to_string(i)));
+    }
+    std::set<std::string*> freed;
+    for(int i = 0; i < 600; i += 2){
+        freed.insert(items[i]);
+        slab.destroy(items[i]);
+    }
+    for(int i = 0; i < 300; ++i){
+        std::string* again = slab.create("again");
+        EXPECT_EQ(1u, freed.count(again));
+    }
+    for(int i = 1; i < 600; i += 2){
+        ASSERT_EQ(std::to_string(i), *items[i]);
+    }
+    // clean up: the slab runs no destructors itself
+    for(std::set<std::string*>::iterator it = freed.begin(); it != freed.end(); ++it){
+        slab.destroy(*it);
+    }
+    for(int i = 1; i < 600; i += 2){
+        slab.destroy(items[i]);
+    }
+}
+
+TEST(ValueSlab, ThrowingConstructorGivesTheSlotBack)
+{
+    ValueSlab<Fragile> slab;
+    Fragile* first = slab.create(false);
+    slab.destroy(first);
+
+    EXPECT_THROW(slab.create(true), std::runtime_error);
+
+    Fragile* second = slab.create(false);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(1, Fragile::live);
+    slab.destroy(second);
+    EXPECT_EQ(0, Fragile::live);
+}
+
+TEST(SplitAVLTree, EmptyTree)
+{
+    SplitAVLTree<int, int> tree;
+
+    EXPECT_TRUE(tree.empty());
+    EXPECT_TRUE(tree.begin() == tree.end());
+    EXPECT_TRUE(tree.find(1) == tree.end());
+    EXPECT_THROW(tree[1], std::out_of_range);
+}
+
+TEST(SplitAVLTree, RandomAgainstStdMap)
+{
+    for(unsigned seed = 1; seed <= 4; ++seed){
+        SplitAVLTree<int, int> tree;
+        std::map<int, int> expected;
+        randomWorkload(tree, expected, seed, 5000, 400, 250, [&](int step) {
+            ASSERT_TRUE(tree.isBalanced()) << "seed " << seed << ", step " << step;
+            ASSERT_EQ(expected.empty(), tree.empty());
+            ASSERT_TRUE(sameContents(tree, expected)) << "seed " << seed << ", step " << step;
+        });
+        tree.clear();
+        EXPECT_TRUE(tree.empty());
+    }
+}
+
+// items never move, so references survive rebalancing and other removes
+TEST(SplitAVLTree, ReferencesStayValid)
+{
+    SplitAVLTree<int, std::string> tree;
+    for(int i = 0; i < 1000; ++i){
+        tree.insert(std::make_pair(i, std::to_string(i)));
+    }
+    std::vector<std::string*> held;
+    for(int i = 0; i < 1000; i += 10){
+        held.push_back(&tree[i]);
+    }
+
+    for(int i = 1; i < 1000; ++i){
+        if(i % 10 != 0){
+            tree.remove(i);
+        }
+    }
+    for(int i = 1000; i < 3000; ++i){
+        tree.insert(std::make_pair(i, std::string(100, 'x')));
+    }
+    // overwriting keeps the item
+    tree.insert(std::make_pair(500, std::string("five hundred")));
+
+    for(size_t i = 0; i < held.size(); ++i){
+        if(i == 50){
+            ASSERT_EQ("five hundred", *held[i]);
+        }
+        else{
+            ASSERT_EQ(std::to_string(i * 10), *held[i]);
+        }
+        ASSERT_EQ(held[i], &tree.find(static_cast<int>(i * 10))->second);
+    }
+    EXPECT_TRUE(tree.isBalanced());
+}
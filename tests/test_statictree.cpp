@@ -0,0 +1,104 @@
+#include <statictree.h>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+constexpr std::pair<const int, const char*> errnoNames[] = {
+    { 1, "EPERM" }, { 2, "ENOENT" }, { 3, "ESRCH" }, { 4, "EINTR" }, { 5, "EIO" } };
+constexpr StaticTree<int, const char*, 5> errnoTable = makeStaticTree(errnoNames);
+
+// lookups are constant expressions
+static_assert(errnoTable.size() == 5, "");
+static_assert(errnoTable[4][1] == 'I', "");
+static_assert(errnoTable.find(6) == errnoTable.end(), "");
+static_assert(errnoTable.lower_bound(0)->first == 1, "");
+
+/**
+* The tree of keys 0, 2, 4, ... with value i at key 2i, for any size.
+*/
+template <size_t... I>
+StaticTree<int, int, sizeof...(I)> evens(StaticTreeIndices<I...>)
+{
+    const std::pair<const int, int> items[] = { std::pair<const int, int>(2 * static_cast<int>(I), I)... };
+    return StaticTree<int, int, sizeof...(I)>(items);
+}
+
+/**
+* Checks iteration order, find(), lower_bound() and operator[] of the
+* evens tree of size N, including keys between and around the entries.
+*/
+template <size_t N>
+void checkEvens()
+{
+    SCOPED_TRACE(N);
+    StaticTree<int, int, N> tree = evens(typename StaticTreeMakeIndices<N>::type());
+    int expected = 0;
+    for(typename StaticTree<int, int, N>::iterator it = tree.begin(); it != tree.end(); ++it, expected += 2){
+        ASSERT_EQ(expected, it->first);
+        ASSERT_EQ(expected / 2, it->second);
+    }
+    ASSERT_EQ(static_cast<int>(2 * N), expected);
+    for(int key = -2; key <= static_cast<int>(2 * N) + 1; ++key){
+        bool present = key >= 0 && key % 2 == 0 && key < static_cast<int>(2 * N);
+        ASSERT_EQ(present, tree.find(key) != tree.end()) << key;
+        if(present){
+            ASSERT_EQ(key / 2, tree[key]);
+        }
+        else{
+            ASSERT_THROW(tree[key], std::out_of_range);
+        }
+        typename StaticTree<int, int, N>::iterator lower = tree.lower_bound(key);
+        if(key >= static_cast<int>(2 * N) - 1){
+            ASSERT_TRUE(lower == tree.end()) << key;
+        }
+        else{
+            ASSERT_EQ(key <= 0 ? 0 : key + (key % 2), lower->first) << key;
+        }
+    }
+}
+
+}
+
+TEST(StaticTree, CompileTimeTable)
+{
+    EXPECT_STREQ("ENOENT", errnoTable.find(2)->second);
+    EXPECT_STREQ("EIO", errnoTable[5]);
+    std::vector<int> keys;
+    for(StaticTree<int, const char*, 5>::iterator it = errnoTable.begin(); it != errnoTable.end(); ++it){
+        keys.push_back(it->first);
+    }
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 5}), keys);
+}
+
+// full, one past full and ragged last levels
+TEST(StaticTree, EverySizeShape)
+{
+    checkEvens<1>();
+    checkEvens<2>();
+    checkEvens<3>();
+    checkEvens<4>();
+    checkEvens<5>();
+    checkEvens<6>();
+    checkEvens<7>();
+    checkEvens<8>();
+    checkEvens<9>();
+    checkEvens<15>();
+    checkEvens<16>();
+    checkEvens<17>();
+    checkEvens<100>();
+    checkEvens<1000>();
+}
+
+TEST(StaticTree, RejectsUnsortedAtRunTime)
+{
+    const std::pair<const int, int> unsorted[] = { { 1, 0 }, { 3, 0 }, { 2, 0 } };
+    const std::pair<const int, int> duplicate[] = { { 1, 0 }, { 1, 0 } };
+
+    EXPECT_THROW(makeStaticTree(unsorted), std::invalid_argument);
+    EXPECT_THROW(makeStaticTree(duplicate), std::invalid_argument);
+}
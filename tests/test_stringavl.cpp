@@ -0,0 +1,213 @@
+#include <avlbst.h>
+#include <stringavl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// keys with long shared prefixes, of every length around the inline
+// capacity and the 8 byte compare stride, with high and NUL bytes
+std::string randomKey(std::mt19937& rng)
+{
+    static const char* prefixes[] = {"", "a", "https://example.com/", "https://example.com/static/img/",
+                                     "/usr/local/share/"};
+    std::string key = prefixes[rng() % 5];
+    size_t tail = rng() % 20;
+    for(size_t i = 0; i < tail; ++i){
+        switch(rng() % 8){
+        case 0:
+            key += '\0';
+            break;
+        case 1:
+            key += static_cast<char>(0xe9);
+            break;
+        default:
+            key += static_cast<char>('a' + rng() % 3);
+        }
+    }
+    return key;
+}
+
+testing::AssertionResult sameContents(const StringAVLTree<int>& tree, const std::map<std::string, int>& expected)
+{
+    std::map<std::string, int>::const_iterator want = expected.begin();
+    for(StringAVLTree<int>::iterator it = tree.begin(); it != tree.end(); ++it, ++want){
+        if(want == expected.end() || it->first.str() != want->first || it->second != want->second){
+            return testing::AssertionFailure() << "unexpected entry " << it->first.str();
+        }
+    }
+    if(want != expected.end()){
+        return testing::AssertionFailure() << "tree is missing " << want->first;
+    }
+    for(want = expected.begin(); want != expected.end(); ++want){
+        StringAVLTree<int>::iterator found = tree.find(want->first);
+        if(found == tree.end() || found->second != want->second){
+            return testing::AssertionFailure() << "find(" << want->first << ") does not return its entry";
+        }
+    }
+    return testing::AssertionSuccess();
+}
+
+}
+
+TEST(StringKey, InlineUpToCapacity)
+{
+    std::string shortKey(StringKey::inlineCapacity, 'x');
+    std::string longKey(StringKey::inlineCapacity + 1, 'x');
+
+    EXPECT_TRUE(StringKey::view(shortKey).isInline());
+    EXPECT_FALSE(StringKey::view(longKey).isInline());
+    EXPECT_EQ(longKey, StringKey::view(longKey).str());
+    EXPECT_EQ(16u, sizeof(StringKey));
+}
+
+TEST(StringKey, OrdersLikeStdString)
+{
+    std::mt19937 rng(1);
+    for(int i = 0; i < 20000; ++i){
+        std::string a = randomKey(rng);
+        std::string b = (rng() % 4 == 0) ? a : randomKey(rng);
+        StringKey ka = StringKey::view(a);
+        StringKey kb = StringKey::view(b);
+        ASSERT_EQ(a < b, ka < kb) << a << " vs " << b;
+        ASSERT_EQ(a > b, ka > kb) << a << " vs " << b;
+        ASSERT_EQ(a == b, ka == kb) << a << " vs " << b;
+    }
+}
+
+// starting after a known common prefix gives the same answer and prefix
+TEST(StringKey, CompareFromSkipsTheKnownPrefix)
+{
+    std::mt19937 rng(2);
+    for(int i = 0; i < 20000; ++i){
+        std::string a = randomKey(rng);
+        std::string b = randomKey(rng);
+        StringKey key = StringKey::view(a);
+        size_t full = 0;
+        int want = key.compareFrom(b.data(), b.size(), full);
+        ASSERT_EQ(b.compare(a) < 0, want < 0);
+        ASSERT_EQ(b == a, want == 0);
+        size_t common = rng() % (full + 1);
+        ASSERT_EQ(want, key.compareFrom(b.data(), b.size(), common));
+        ASSERT_EQ(full, common);
+    }
+}
+
+TEST(StringAVLTree, RandomAgainstStdMap)
+{
+    for(unsigned seed = 1; seed <= 3; ++seed){
+        std::mt19937 rng(seed);
+        StringAVLTree<int> tree;
+        std::map<std::string, int> expected;
+        std::vector<std::string> keys;
+        for(int i = 0; i < 600; ++i){
+            keys.push_back(randomKey(rng));
+        }
+        for(int step = 1; step <= 6000; ++step){
+            const std::string& key = keys[rng() % keys.size()];
+            if(rng() % 3 != 0){
+                tree.insert(std::make_pair(key, step));
+                expected[key] = step;
+            }
+            else{
+                tree.remove(key);
+                expected.erase(key);
+            }
+            if(step % 300 == 0){
+                ASSERT_TRUE(tree.isBalanced()) << "seed " << seed << ", step " << step;
+                ASSERT_TRUE(sameContents(tree, expected)) << "seed " << seed << ", step " << step;
+            }
+        }
+    }
+}
+
+// the tree copies keys; the caller's buffer can change afterwards
+TEST(StringAVLTree, OwnsItsKeys)
+{
+    StringAVLTree<int> tree;
+    std::string key = "https://example.com/static/img/logo.png";
+    tree.insert(std::make_pair(key, 1));
+    key[20] = 'X';
+    tree.insert(std::make_pair(key, 2));
+
+    EXPECT_EQ(1, tree["https://example.com/static/img/logo.png"]);
+    EXPECT_EQ(2, tree[key]);
+    EXPECT_TRUE(tree.find(std::string("https://example.com/")) == tree.end());
+}
+
+// the hinted insert copies keys too, whether the hint is right or not
+TEST(StringAVLTree, HintedInsert)
+{
+    StringAVLTree<int> tree;
+    std::map<std::string, int> expected;
+    StringAVLTree<int>::iterator hint = tree.end();
+    for(int i = 0; i < 100; ++i){
+        std::string key = "/usr/local/share/doc/" + std::to_string(1000 + i);
+        hint = tree.insert(hint, std::make_pair(StringKey::view(key), i));
+        ASSERT_TRUE(hint != tree.end());
+        EXPECT_EQ(key, hint->first.str());
+        ++hint;
+        key[0] = 'X';
+        expected["/usr/local/share/doc/" + std::to_string(1000 + i)] = i;
+    }
+    // a wrong hint, and an existing key
+    std::string early = "/usr/local/share/doc/0";
+    tree.insert(tree.end(), std::make_pair(StringKey::view(early), -1));
+    tree.insert(tree.begin(), std::make_pair(StringKey::view("/usr/local/share/doc/1050"), -2));
+    expected[early] = -1;
+    expected["/usr/local/share/doc/1050"] = -2;
+    early[1] = 'X';
+
+    EXPECT_TRUE(tree.isBalanced());
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+// a snapshot of AVLTree<std::string, V> loads into StringAVLTree<V> and back
+TEST(StringAVLTree, SnapshotsMatchStdStringTrees)
+{
+    std::mt19937 rng(3);
+    AVLTree<std::string, int> plain;
+    std::map<std::string, int> expected;
+    for(int i = 0; i < 500; ++i){
+        std::string key = randomKey(rng);
+        plain.insert(std::make_pair(key, i));
+        expected[key] = i;
+    }
+    std::stringstream snapshot;
+    plain.save(snapshot);
+
+    StringAVLTree<int> tree;
+    tree.load(snapshot);
+    ASSERT_TRUE(sameContents(tree, expected));
+
+    std::stringstream back;
+    tree.save(back);
+    AVLTree<std::string, int> reloaded;
+    reloaded.load(back);
+    std::map<std::string, int>::const_iterator want = expected.begin();
+    for(AVLTree<std::string, int>::iterator it = reloaded.begin(); it != reloaded.end(); ++it, ++want){
+        ASSERT_TRUE(want != expected.end());
+        ASSERT_EQ(want->first, it->first);
+    }
+    EXPECT_TRUE(want == expected.end());
+}
+
+TEST(StringAVLTree, ClearAndReuse)
+{
+    StringAVLTree<int> tree;
+    for(int round = 0; round < 3; ++round){
+        for(int i = 0; i < 1000; ++i){
+            tree.insert(std::make_pair("/usr/local/share/doc/" + std::to_string(i), i));
+        }
+        EXPECT_EQ(500, tree["/usr/local/share/doc/500"]);
+        tree.clear();
+        EXPECT_TRUE(tree.empty());
+    }
+}
@@ -0,0 +1,225 @@
+#include <avlbst.h>
+#include <bst.h>
+#include <tree_export.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/**
+* One line of a JSON lines export, picked apart with plain string
+* searches; good enough for the flat objects the exporter writes.
+*/
+struct ExportedNode
+{
+    std::string id;
+    std::string parent;
+    std::string side;
+    size_t skipped;
+    size_t depth;
+    std::string key;
+    bool elided;
+};
+
+std::string field(const std::string& line, const std::string& name)
+{
+    std::string tag = "\"" + name + "\":";
+    size_t at = line.find(tag);
+    if(at == std::string::npos){
+        return std::string();
+    }
+    at += tag.size();
+    if(line[at] == '"'){
+        std::string out;
+        for(size_t i = at + 1; line[i] != '"'; ++i){
+            if(line[i] == '\\'){
+                ++i;
+            }
+            out += line[i];
+        }
+        return out;
+    }
+    return line.substr(at, line.find_first_of(",}", at) - at);
+}
+
+std::vector<ExportedNode> parseJsonLines(const std::string& text)
+{
+    std::vector<ExportedNode> out;
+    std::istringstream in(text);
+    std::string line;
+    while(std::getline(in, line)){
+        ExportedNode node;
+        node.id = field(line, "id");
+        node.parent = field(line, "parent");
+        node.side = field(line, "side");
+        node.skipped = std::stoul(field(line, "skipped"));
+        node.depth = std::stoul(field(line, "depth"));
+        node.key = field(line, "key");
+        node.elided = field(line, "elided") == "true";
+        out.push_back(node);
+    }
+    return out;
+}
+
+template <class Tree>
+std::vector<ExportedNode> exportJson(const Tree& tree, TreeExportOptions options = TreeExportOptions())
+{
+    std::ostringstream out;
+    options.format = TREE_EXPORT_JSON;
+    tree.exportTree(out, options);
+    return parseJsonLines(out.str());
+}
+
+}
+
+TEST(TreeExport, EmptyTree)
+{
+    BinarySearchTree<int, int> tree;
+    std::ostringstream dot;
+    tree.exportTree(dot);
+
+    EXPECT_EQ("digraph tree {\n  node [shape=box];\n}\n", dot.str());
+    EXPECT_TRUE(exportJson(tree).empty());
+}
+
+// pre-order, and every node names its parent and side correctly
+TEST(TreeExport, JsonLinesDescribeTheTree)
+{
+    AVLTree<int, int> tree;
+    for(int i = 1; i <= 7; ++i){
+        tree.insert(std::make_pair(i, i * 10));
+    }
+
+    std::vector<ExportedNode> nodes = exportJson(tree);
+
+    ASSERT_EQ(7u, nodes.size());
+    std::vector<std::string> keys;
+    std::map<std::string, ExportedNode> byId;
+    for(size_t i = 0; i < nodes.size(); ++i){
+        keys.push_back(nodes[i].key);
+        byId[nodes[i].id] = nodes[i];
+    }
+    EXPECT_EQ((std::vector<std::string>{"4", "2", "1", "3", "6", "5", "7"}), keys);
+    EXPECT_EQ("null", nodes[0].parent);
+    EXPECT_EQ(0u, nodes[0].depth);
+    for(size_t i = 1; i < nodes.size(); ++i){
+        const ExportedNode& parent = byId[nodes[i].parent];
+        EXPECT_EQ(parent.depth + 1, nodes[i].depth);
+        EXPECT_EQ(std::stoi(nodes[i].key) < std::stoi(parent.key) ? "L" : "R", nodes[i].side);
+        EXPECT_EQ(0u, nodes[i].skipped);
+    }
+}
+
+TEST(TreeExport, DepthLimitElidesSubtrees)
+{
+    AVLTree<int, int> tree;
+    for(int i = 0; i < 1023; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    TreeExportOptions options;
+    options.maxDepth = 2;
+
+    std::vector<ExportedNode> nodes = exportJson(tree, options);
+
+    size_t written = 0;
+    size_t elided = 0;
+    for(size_t i = 0; i < nodes.size(); ++i){
+        if(nodes[i].elided){
+            elided++;
+            EXPECT_EQ(3u, nodes[i].depth);
+        }
+        else{
+            written++;
+            EXPECT_LE(nodes[i].depth, 2u);
+        }
+    }
+    EXPECT_EQ(7u, written);
+    EXPECT_EQ(8u, elided);
+}
+
+TEST(TreeExport, SubtreeFocus)
+{
+    AVLTree<int, int> tree;
+    for(int i = 1; i <= 7; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    TreeExportOptions options;
+    options.format = TREE_EXPORT_JSON;
+    std::ostringstream out;
+
+    tree.exportSubtree(out, 6, options);
+
+    std::vector<ExportedNode> nodes = parseJsonLines(out.str());
+    ASSERT_EQ(3u, nodes.size());
+    EXPECT_EQ("6", nodes[0].key);
+    EXPECT_EQ("null", nodes[0].parent);
+    EXPECT_EQ(1u, nodes[1].depth);
+    std::ostringstream ignored;
+    EXPECT_THROW(tree.exportSubtree(ignored, 99), std::out_of_range);
+}
+
+// sampled nodes hang off their closest written ancestor
+TEST(TreeExport, SamplingLinksToWrittenAncestors)
+{
+    std::mt19937 rng(2);
+    BinarySearchTree<int, int> tree;
+    for(int i = 0; i < 5000; ++i){
+        tree.insert(std::make_pair(static_cast<int>(rng() % 100000), i));
+    }
+    TreeExportOptions options;
+    options.sampleRate = 0.1;
+    options.seed = 42;
+
+    std::vector<ExportedNode> nodes = exportJson(tree, options);
+
+    EXPECT_GT(nodes.size(), 300u);
+    EXPECT_LT(nodes.size(), 700u);
+    std::set<std::string> written;
+    bool skippedSome = false;
+    for(size_t i = 0; i < nodes.size(); ++i){
+        if(i > 0){
+            // pre-order: the ancestor was written first
+            EXPECT_EQ(1u, written.count(nodes[i].parent)) << "line " << i;
+        }
+        skippedSome = skippedSome || nodes[i].skipped > 0;
+        written.insert(nodes[i].id);
+    }
+    EXPECT_TRUE(skippedSome);
+    // the same seed picks the same nodes
+    EXPECT_EQ(nodes.size(), exportJson(tree, options).size());
+}
+
+TEST(TreeExport, DotEscapesLabels)
+{
+    BinarySearchTree<std::string, std::string> tree;
+    tree.insert(std::make_pair(std::string("a\"b"), std::string("line\nbreak\\")));
+    std::ostringstream dot;
+
+    tree.exportTree(dot);
+
+    EXPECT_NE(std::string::npos, dot.str().find("[label=\"a\\\"b: line\\nbreak\\\\\"];"));
+}
+
+// a degenerate chain; the walk climbs parent links instead of keeping a stack
+TEST(TreeExport, DeepChain)
+{
+    BinarySearchTree<int, int> tree;
+    for(int i = 10000; i > 0; --i){
+        tree.insert(std::make_pair(i, i));
+    }
+
+    std::vector<ExportedNode> nodes = exportJson(tree);
+
+    ASSERT_EQ(10000u, nodes.size());
+    EXPECT_EQ("1", nodes.back().key);
+    EXPECT_EQ(9999u, nodes.back().depth);
+}
@@ -0,0 +1,132 @@
+#include <avlbst.h>
+#include <bst.h>
+#include <tree_shape.h>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/**
+* A node with public child pointers, like the one in equal-paths.h.
+*/
+struct PathNode
+{
+    explicit PathNode(PathNode* l = nullptr, PathNode* r = nullptr) : left(l), right(r) {}
+    PathNode* left;
+    PathNode* right;
+};
+
+// owns the nodes of a hand-built tree
+struct PathNodes
+{
+    ~PathNodes()
+    {
+        for(size_t i = 0; i < nodes.size(); ++i){
+            delete nodes[i];
+        }
+    }
+
+    PathNode* make(PathNode* left = nullptr, PathNode* right = nullptr)
+    {
+        nodes.push_back(new PathNode(left, right));
+        return nodes.back();
+    }
+
+    std::vector<PathNode*> nodes;
+};
+
+void expectSameShape(const TreeShape& want, const TreeShape& got)
+{
+    EXPECT_EQ(want.nodes, got.nodes);
+    EXPECT_EQ(want.leaves, got.leaves);
+    EXPECT_EQ(want.minLeafDepth, got.minLeafDepth);
+    EXPECT_EQ(want.maxLeafDepth, got.maxLeafDepth);
+    EXPECT_EQ(want.leafDepths, got.leafDepths);
+}
+
+}
+
+TEST(TreeShape, EmptyTree)
+{
+    TreeShape shape = treeShape<FieldLinks>(static_cast<PathNode*>(nullptr));
+
+    EXPECT_EQ(0u, shape.nodes);
+    EXPECT_EQ(0u, shape.leaves);
+    EXPECT_EQ(0u, shape.height());
+    EXPECT_TRUE(shape.equalLeafDepths());
+}
+
+// the five cases of equal-paths-test
+TEST(TreeShape, EqualLeafDepths)
+{
+    PathNodes n;
+    EXPECT_TRUE(treeShape<FieldLinks>(n.make()).equalLeafDepths());
+    EXPECT_TRUE(treeShape<FieldLinks>(n.make(n.make())).equalLeafDepths());
+    EXPECT_TRUE(treeShape<FieldLinks>(n.make(n.make(), n.make())).equalLeafDepths());
+    EXPECT_TRUE(treeShape<FieldLinks>(n.make(nullptr, n.make())).equalLeafDepths());
+
+    TreeShape uneven = treeShape<FieldLinks>(n.make(n.make(nullptr, n.make()), n.make()));
+    EXPECT_FALSE(uneven.equalLeafDepths());
+    EXPECT_EQ(4u, uneven.nodes);
+    EXPECT_EQ(2u, uneven.leaves);
+    EXPECT_EQ(1u, uneven.minLeafDepth);
+    EXPECT_EQ(2u, uneven.maxLeafDepth);
+    EXPECT_EQ(3u, uneven.height());
+    EXPECT_EQ((std::vector<uint64_t>{0, 1, 1}), uneven.leafDepths);
+}
+
+// a chain deep enough to overflow a recursive walk
+TEST(TreeShape, DeepChainDoesNotRecurse)
+{
+    PathNodes n;
+    PathNode* root = nullptr;
+    for(int i = 0; i < 1000000; ++i){
+        root = n.make(root);
+    }
+
+    TreeShape shape = treeShape<FieldLinks>(root, 4);
+
+    EXPECT_EQ(1000000u, shape.nodes);
+    EXPECT_EQ(1u, shape.leaves);
+    EXPECT_EQ(1000000u, shape.height());
+    EXPECT_TRUE(shape.equalLeafDepths());
+}
+
+TEST(TreeShape, ThreadsGiveTheSameAnswer)
+{
+    std::mt19937 rng(8);
+    BinarySearchTree<int, int> tree;
+    for(int i = 0; i < 20000; ++i){
+        tree.insert(std::make_pair(static_cast<int>(rng() % 100000), i));
+    }
+
+    TreeShape single = tree.shape();
+    for(unsigned threads = 2; threads <= 8; threads *= 2){
+        SCOPED_TRACE(threads);
+        expectSameShape(single, tree.shape(threads));
+    }
+    uint64_t leaves = 0;
+    for(size_t d = 0; d < single.leafDepths.size(); ++d){
+        leaves += single.leafDepths[d];
+    }
+    EXPECT_EQ(single.leaves, leaves);
+}
+
+TEST(TreeShape, PerfectAVLTree)
+{
+    AVLTree<int, int> tree;
+    for(int i = 0; i < 1023; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+
+    TreeShape shape = tree.shape(4);
+
+    EXPECT_EQ(1023u, shape.nodes);
+    EXPECT_EQ(512u, shape.leaves);
+    EXPECT_EQ(10u, shape.height());
+    EXPECT_TRUE(shape.equalLeafDepths());
+}
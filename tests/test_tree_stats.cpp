@@ -0,0 +1,129 @@
+#include <tree_stats.h>
+#include <avlbst.h>
+#include <wavlbst.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+
+// The registry is process-wide, so every test starts from a reset and
+// compares against what it recorded itself. Build with DEFS=-DBST_STATS
+// (make check DEFS=-DBST_STATS) to also check the counters the trees feed.
+
+TEST(TreeStats, CountersAddUp)
+{
+    treeStatsReset();
+    treeStatsLocal().add(TREE_COMPARISONS, 5);
+    treeStatsLocal().add(TREE_COMPARISONS, 2);
+    treeStatsLocal().add(TREE_ZIGZAG, 1);
+
+    TreeStatsSnapshot snapshot = treeStatsSnapshot();
+    EXPECT_EQ(7u, snapshot.counters[TREE_COMPARISONS]);
+    EXPECT_EQ(1u, snapshot.counters[TREE_ZIGZAG]);
+
+    treeStatsReset();
+    EXPECT_EQ(0u, treeStatsSnapshot().counters[TREE_COMPARISONS]);
+}
+
+TEST(TreeStats, LatencyBucketsAndPercentiles)
+{
+    treeStatsReset();
+    // bucket b holds [2^b, 2^(b+1)) ns
+    for(int i = 0; i < 90; ++i){
+        treeStatsLocal().record(TREE_FIND, 100);
+    }
+    for(int i = 0; i < 10; ++i){
+        treeStatsLocal().record(TREE_FIND, 5000);
+    }
+    treeStatsLocal().record(TREE_INSERT, 0);
+
+    TreeStatsSnapshot snapshot = treeStatsSnapshot();
+    EXPECT_EQ(100u, snapshot.operations(TREE_FIND));
+    EXPECT_EQ(101u, snapshot.totalOperations());
+    EXPECT_EQ(90u, snapshot.latency[TREE_FIND][6]);
+    EXPECT_EQ(10u, snapshot.latency[TREE_FIND][12]);
+    EXPECT_EQ(1u, snapshot.latency[TREE_INSERT][0]);
+    EXPECT_EQ(128, snapshot.latencyPercentileNs(TREE_FIND, 50));
+    EXPECT_EQ(8192, snapshot.latencyPercentileNs(TREE_FIND, 99));
+    EXPECT_EQ(0, snapshot.latencyPercentileNs(TREE_REMOVE, 50));
+}
+
+TEST(TreeStats, ExitedThreadsAreKept)
+{
+    treeStatsReset();
+    std::thread worker([]() {
+        treeStatsLocal().add(TREE_NODE_SWAPS, 3);
+        treeStatsLocal().record(TREE_REMOVE, 10);
+    });
+    worker.join();
+    treeStatsLocal().add(TREE_NODE_SWAPS, 1);
+
+    TreeStatsSnapshot snapshot = treeStatsSnapshot();
+    EXPECT_EQ(4u, snapshot.counters[TREE_NODE_SWAPS]);
+    EXPECT_EQ(1u, snapshot.operations(TREE_REMOVE));
+}
+
+TEST(TreeStats, PrintsOneJsonObject)
+{
+    treeStatsReset();
+    treeStatsLocal().add(TREE_CACHE_HITS, 3);
+    treeStatsLocal().add(TREE_CACHE_MISSES, 1);
+    std::ostringstream out;
+
+    treeStatsSnapshot().print(out);
+
+    std::string json = out.str();
+    EXPECT_EQ('{', json[0]);
+    EXPECT_EQ("}\n", json.substr(json.size() - 2));
+    EXPECT_NE(std::string::npos, json.find("\"cache_hits\":3,"));
+    EXPECT_NE(std::string::npos, json.find("\"cache_hit_rate\":0.75"));
+}
+
+TEST(TreeStats, TreesFeedTheCounters)
+{
+    treeStatsReset();
+    AVLTree<int, int> tree;
+    for(int i = 0; i < 1000; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 1000; ++i){
+        tree.find(i);
+    }
+    for(int i = 0; i < 1000; i += 2){
+        tree.remove(i);
+    }
+
+    TreeStatsSnapshot snapshot = treeStatsSnapshot();
+#ifdef BST_STATS
+    EXPECT_EQ(1000u, snapshot.operations(TREE_INSERT));
+    EXPECT_EQ(1000u, snapshot.operations(TREE_FIND));
+    EXPECT_EQ(500u, snapshot.operations(TREE_REMOVE));
+    EXPECT_GT(snapshot.counters[TREE_ZIGZIG], 0u);
+    EXPECT_GT(snapshot.counters[TREE_ROTATE_LEFT], 0u);
+    EXPECT_GE(snapshot.counters[TREE_FIND_PATH], snapshot.counters[TREE_FIND_CALLS]);
+#else
+    // compiled out entirely
+    EXPECT_EQ(0u, snapshot.totalOperations());
+    EXPECT_EQ(0u, snapshot.counters[TREE_ROTATE_LEFT]);
+#endif
+}
+
+// WAVLTree inserts descend like AVLTree's, so they count the same way
+TEST(TreeStats, WAVLInsertsFeedTheCounters)
+{
+    treeStatsReset();
+    WAVLTree<int, int> tree;
+    for(int i = 0; i < 1000; ++i){
+        tree.insert(std::make_pair((i * 37) % 1000, i));
+    }
+
+    TreeStatsSnapshot snapshot = treeStatsSnapshot();
+#ifdef BST_STATS
+    EXPECT_EQ(1000u, snapshot.operations(TREE_INSERT));
+    EXPECT_GE(snapshot.counters[TREE_COMPARISONS], 1000u);
+#else
+    EXPECT_EQ(0u, snapshot.totalOperations());
+    EXPECT_EQ(0u, snapshot.counters[TREE_COMPARISONS]);
+#endif
+}
@@ -0,0 +1,236 @@
+#include "check_tree.h"
+
+#include <ttlavl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+typedef TTLAVLTree<int, int> Tree;
+
+// the clock every test tree reads; tests move it by hand
+Tree::Time fakeNow = 0;
+
+Tree::Time fakeClock()
+{
+    return fakeNow;
+}
+
+class TTLAVL : public testing::Test
+{
+protected:
+    TTLAVL()
+    {
+        fakeNow = 1000;
+    }
+};
+
+}
+
+TEST_F(TTLAVL, EntriesVanishWhenDue)
+{
+    Tree tree(&fakeClock);
+    tree.insert(std::make_pair(1, 10), 5);
+    tree.insert(std::make_pair(2, 20));
+    tree.insert(std::make_pair(3, 30), 50);
+
+    EXPECT_EQ(1005u, tree.expiresAt(1));
+    EXPECT_EQ(Tree::NEVER, tree.expiresAt(2));
+    fakeNow = 1005;
+
+    EXPECT_TRUE(tree.find(1) == tree.end());
+    EXPECT_THROW(tree[1], std::out_of_range);
+    EXPECT_EQ(20, tree[2]);
+    std::map<int, int> expected;
+    expected[2] = 20;
+    expected[3] = 30;
+    EXPECT_TRUE(sameContents(tree, expected));
+    // held until collected
+    EXPECT_EQ(3u, tree.size());
+    EXPECT_EQ(1u, tree.expire());
+    EXPECT_EQ(2u, tree.size());
+    EXPECT_EQ(1u, tree.pending());
+}
+
+TEST_F(TTLAVL, InsertWithoutTtlMakesPermanent)
+{
+    Tree tree(&fakeClock);
+    tree.insert(std::make_pair(1, 10), 5);
+    tree.insert(std::make_pair(1, 11));
+    fakeNow += 100;
+
+    EXPECT_EQ(11, tree[1]);
+    EXPECT_EQ(0u, tree.pending());
+    EXPECT_TRUE(tree.expireAt(1, fakeNow + 1));
+    fakeNow += 1;
+    EXPECT_FALSE(tree.expireAt(1, Tree::NEVER));
+}
+
+// an expired entry not yet collected is replaced by a new insert
+TEST_F(TTLAVL, ReinsertAfterExpiry)
+{
+    Tree tree(&fakeClock);
+    tree.insert(std::make_pair(1, 10), 5);
+    fakeNow += 10;
+    tree.insert(std::make_pair(1, 12), 5);
+
+    EXPECT_EQ(12, tree[1]);
+    EXPECT_EQ(1u, tree.size());
+    fakeNow += 5;
+    EXPECT_EQ(1u, tree.expire());
+    EXPECT_EQ(0u, tree.size());
+    EXPECT_TRUE(tree.empty());
+}
+
+// find() reads the clock, so stepping its iterator skips expired entries
+TEST_F(TTLAVL, FindIteratorSkipsExpired)
+{
+    Tree tree(&fakeClock);
+    tree.insert(std::make_pair(1, 10));
+    tree.insert(std::make_pair(2, 20), 5);
+    tree.insert(std::make_pair(3, 30));
+    fakeNow += 5;
+
+    Tree::iterator it = tree.find(1);
+    ASSERT_TRUE(it != tree.end());
+    ++it;
+    ASSERT_TRUE(it != tree.end());
+    EXPECT_EQ(3, it->first);
+}
+
+TEST_F(TTLAVL, FindBatchSkipsExpired)
+{
+    Tree tree(&fakeClock);
+    tree.insert(std::make_pair(1, 10));
+    tree.insert(std::make_pair(2, 20), 5);
+    tree.insert(std::make_pair(3, 30), 50);
+    fakeNow += 5;
+
+    std::vector<int> keys;
+    keys.push_back(3);
+    keys.push_back(2);
+    keys.push_back(4);
+    keys.push_back(1);
+    std::vector<Tree::iterator> found;
+    tree.findBatch(keys, found);
+    ASSERT_EQ(4u, found.size());
+    ASSERT_TRUE(found[0] != tree.end());
+    EXPECT_EQ(30, found[0]->second);
+    EXPECT_TRUE(found[1] == tree.end());
+    EXPECT_TRUE(found[2] == tree.end());
+    ASSERT_TRUE(found[3] != tree.end());
+    EXPECT_EQ(10, found[3]->second);
+}
+
+// through a base reference too: hinted inserts never expire, like insert(item)
+TEST_F(TTLAVL, HintedInsertIsPermanent)
+{
+    Tree tree(&fakeClock);
+    AVLTree<int, int>& base = tree;
+    tree.insert(std::make_pair(4, 0), 5);
+    AVLTree<int, int>::iterator hint = base.end();
+    for(int i = 0; i < 10; ++i){
+        hint = base.insert(hint, std::make_pair(i, i));
+        ASSERT_EQ(i, hint->first);
+        ++hint;
+    }
+    fakeNow += 100;
+
+    EXPECT_EQ(0u, tree.pending());
+    EXPECT_EQ(0u, tree.expire());
+    EXPECT_EQ(10u, tree.size());
+    EXPECT_EQ(4, tree[4]);
+    EXPECT_EQ(Tree::NEVER, tree.expiresAt(4));
+}
+
+TEST_F(TTLAVL, RandomAgainstModel)
+{
+    std::mt19937 rng(4);
+    Tree tree(&fakeClock);
+    // key -> (value, expiry)
+    std::map<int, std::pair<int, Tree::Time> > model;
+    for(int step = 1; step <= 20000; ++step){
+        int key = static_cast<int>(rng() % 300);
+        switch(rng() % 6){
+        case 0:
+            tree.remove(key);
+            model.erase(key);
+            break;
+        case 1:
+            fakeNow += rng() % 4;
+            break;
+        case 2:
+            if(rng() % 8 == 0){
+                tree.expire();
+                for(auto it = model.begin(); it != model.end();){
+                    it = (it->second.second <= fakeNow) ? model.erase(it) : std::next(it);
+                }
+            }
+            break;
+        case 3:
+            tree.insert(std::make_pair(key, step));
+            model[key] = std::make_pair(step, Tree::NEVER);
+            break;
+        default:
+        {
+            Tree::Time ttl = 1 + rng() % 20;
+            tree.insert(std::make_pair(key, step), ttl);
+            model[key] = std::make_pair(step, fakeNow + ttl);
+        }
+        }
+        ASSERT_EQ(model.size(), tree.size()) << "step " << step;
+        if(step % 200 == 0){
+            ASSERT_TRUE(tree.isBalanced());
+            std::map<int, int> live;
+            for(auto it = model.begin(); it != model.end(); ++it){
+                if(it->second.second > fakeNow){
+                    live[it->first] = it->second.first;
+                }
+            }
+            ASSERT_TRUE(sameContents(tree, live)) << "step " << step;
+            std::stringstream snapshot;
+            tree.save(snapshot);
+            AVLTree<int, int> loaded;
+            loaded.load(snapshot);
+            ASSERT_TRUE(sameContents(loaded, live)) << "step " << step;
+        }
+    }
+}
+
+TEST_F(TTLAVL, ClearAndLoad)
+{
+    Tree tree(&fakeClock);
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i, i), i % 2 == 0 ? 10 : Tree::NEVER);
+    }
+    fakeNow += 10;
+    // through a const base reference too; saving collects nothing
+    std::stringstream snapshot;
+    const BinarySearchTree<int, int>& reader = tree;
+    reader.save(snapshot);
+    EXPECT_EQ(100u, tree.size());
+    EXPECT_EQ(50u, tree.pending());
+
+    BinarySearchTree<int, int>& base = tree;
+    base.clear();
+    EXPECT_EQ(0u, tree.size());
+    EXPECT_EQ(0u, tree.pending());
+
+    tree.load(snapshot);
+    EXPECT_EQ(50u, tree.size());
+    EXPECT_EQ(0u, tree.pending());
+    EXPECT_EQ(Tree::NEVER, tree.expiresAt(1));
+    std::map<int, int> expected;
+    for(int i = 1; i < 100; i += 2){
+        expected[i] = i;
+    }
+    EXPECT_TRUE(sameContents(tree, expected));
+}
@@ -0,0 +1,273 @@
+#include "check_tree.h"
+
+#include <walavl.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+typedef WalAVLTree<int, int> Tree;
+
+class WalAVL : public testing::Test
+{
+protected:
+    WalAVL() :
+        snapshot_(testing::TempDir() + "walavl-" + std::to_string(::getpid()) + ".snap"),
+        log_(testing::TempDir() + "walavl-" + std::to_string(::getpid()) + ".log")
+    {
+        removeFiles();
+    }
+
+    ~WalAVL()
+    {
+        removeFiles();
+    }
+
+    void removeFiles() const
+    {
+        ::unlink(snapshot_.c_str());
+        ::unlink(log_.c_str());
+        ::unlink((snapshot_ + ".tmp").c_str());
+    }
+
+    off_t logSize() const
+    {
+        struct stat st;
+        return ::stat(log_.c_str(), &st) == 0 ? st.st_size : -1;
+    }
+
+    std::string snapshot_;
+    std::string log_;
+};
+
+}
+
+TEST_F(WalAVL, RecoversFromLogAlone)
+{
+    std::map<int, int> expected;
+    {
+        Tree tree(snapshot_, log_);
+        randomWorkload(tree, expected, 1, 500, 100, 500, [](int) {});
+    }
+
+    Tree recovered(snapshot_, log_);
+    EXPECT_TRUE(recovered.isBalanced());
+    EXPECT_TRUE(sameContents(recovered, expected));
+}
+
+TEST_F(WalAVL, ClearIsLogged)
+{
+    {
+        Tree tree(snapshot_, log_);
+        for(int i = 0; i < 50; ++i){
+            tree.insert(std::make_pair(i, i));
+        }
+        tree.checkpoint();
+        tree.insert(std::make_pair(99, 99));
+        off_t before = logSize();
+        BinarySearchTree<int, int>& base = tree;
+        base.clear();
+        // one record however many entries there were
+        EXPECT_GT(logSize(), before);
+        EXPECT_LT(logSize() - before, 16);
+        EXPECT_TRUE(tree.empty());
+        tree.insert(std::make_pair(7, 70));
+    }
+
+    Tree recovered(snapshot_, log_);
+    std::map<int, int> expected;
+    expected[7] = 70;
+    EXPECT_TRUE(sameContents(recovered, expected));
+}
+
+TEST_F(WalAVL, LoadIsDurable)
+{
+    std::map<int, int> expected;
+    std::stringstream snapshot;
+    {
+        AVLTree<int, int> source;
+        for(int i = 0; i < 100; ++i){
+            source.insert(std::make_pair(i, -i));
+            expected[i] = -i;
+        }
+        source.save(snapshot);
+    }
+    {
+        Tree tree(snapshot_, log_);
+        tree.insert(std::make_pair(500, 500));
+        BinarySearchTree<int, int>& base = tree;
+        base.load(snapshot);
+        EXPECT_EQ(0, logSize());
+        EXPECT_TRUE(sameContents(tree, expected));
+        tree.insert(std::make_pair(1000, 1));
+        expected[1000] = 1;
+    }
+
+    Tree recovered(snapshot_, log_);
+    EXPECT_TRUE(recovered.isBalanced());
+    EXPECT_TRUE(sameContents(recovered, expected));
+}
+
+TEST_F(WalAVL, HintedInsertIsLogged)
+{
+    {
+        Tree tree(snapshot_, log_);
+        AVLTree<int, int>& base = tree;
+        Tree::iterator hint = tree.end();
+        for(int i = 0; i < 20; ++i){
+            hint = base.insert(hint, std::make_pair(i, i));
+            ++hint;
+        }
+        tree.insert(tree.find(5), std::make_pair(5, 50));
+    }
+
+    Tree recovered(snapshot_, log_);
+    std::map<int, int> expected;
+    for(int i = 0; i < 20; ++i){
+        expected[i] = i;
+    }
+    expected[5] = 50;
+    EXPECT_TRUE(sameContents(recovered, expected));
+}
+
+TEST_F(WalAVL, CheckpointEmptiesLogAndKeepsContents)
+{
+    std::map<int, int> expected;
+    {
+        Tree tree(snapshot_, log_);
+        randomWorkload(tree, expected, 2, 500, 100, 500, [](int) {});
+        tree.checkpoint();
+        EXPECT_EQ(0, logSize());
+        // replayed on top of the snapshot
+        tree.insert(std::make_pair(1000, 1));
+        tree.remove(expected.begin()->first);
+        expected[1000] = 1;
+        expected.erase(expected.begin());
+    }
+
+    Tree recovered(snapshot_, log_);
+    EXPECT_TRUE(sameContents(recovered, expected));
+}
+
+// a crash in the middle of a write leaves part of the last record behind
+TEST_F(WalAVL, DropsTornTailAndAppendsAfterIt)
+{
+    {
+        Tree tree(snapshot_, log_);
+        for(int i = 0; i < 10; ++i){
+            tree.insert(std::make_pair(i, i));
+        }
+    }
+    off_t full = logSize();
+    off_t record = full / 10;
+    for(off_t cut = 1; cut < record; ++cut){
+        ASSERT_EQ(0, ::truncate(log_.c_str(), full - cut));
+        {
+            Tree recovered(snapshot_, log_);
+            std::map<int, int> expected;
+            for(int i = 0; i < 9; ++i){
+                expected[i] = i;
+            }
+            ASSERT_TRUE(sameContents(recovered, expected)) << "cut " << cut << " bytes";
+            ASSERT_EQ(full - record, logSize()) << "torn record not cut off";
+            recovered.insert(std::make_pair(9, 9));
+        }
+        ASSERT_EQ(full, logSize());
+    }
+
+    Tree recovered(snapshot_, log_);
+    EXPECT_EQ(9, recovered[9]);
+}
+
+TEST_F(WalAVL, StopsAtCorruptRecord)
+{
+    {
+        Tree tree(snapshot_, log_);
+        for(int i = 0; i < 10; ++i){
+            tree.insert(std::make_pair(i, i));
+        }
+    }
+    off_t record = logSize() / 10;
+    {
+        // flip a payload byte of the fifth record
+        FILE* file = std::fopen(log_.c_str(), "r+b");
+        ASSERT_TRUE(file != nullptr);
+        std::fseek(file, 4 * record + 9, SEEK_SET);
+        int byte = std::fgetc(file);
+        std::fseek(file, 4 * record + 9, SEEK_SET);
+        std::fputc(byte ^ 0x40, file);
+        std::fclose(file);
+    }
+
+    Tree recovered(snapshot_, log_);
+    std::map<int, int> expected;
+    for(int i = 0; i < 4; ++i){
+        expected[i] = i;
+    }
+    EXPECT_TRUE(sameContents(recovered, expected));
+    EXPECT_EQ(4 * record, logSize());
+}
+
+TEST_F(WalAVL, OversizedLengthEndsTheLog)
+{
+    {
+        Tree tree(snapshot_, log_);
+        for(int i = 0; i < 10; ++i){
+            tree.insert(std::make_pair(i, i));
+        }
+    }
+    off_t full = logSize();
+    {
+        // a garbage header claiming a payload of almost 4GB
+        FILE* file = std::fopen(log_.c_str(), "ab");
+        ASSERT_TRUE(file != nullptr);
+        uint32_t header[2] = { 0xFFFFFFF0u, 0 };
+        std::fwrite(header, sizeof(header), 1, file);
+        std::fclose(file);
+    }
+
+    Tree recovered(snapshot_, log_);
+    std::map<int, int> expected;
+    for(int i = 0; i < 10; ++i){
+        expected[i] = i;
+    }
+    EXPECT_TRUE(sameContents(recovered, expected));
+    EXPECT_EQ(full, logSize());
+}
+
+TEST_F(WalAVL, ConcurrentWritersAreAllDurable)
+{
+    const int threads = 4;
+    const int perThread = 200;
+    {
+        Tree tree(snapshot_, log_);
+        std::vector<std::thread> writers;
+        for(int t = 0; t < threads; ++t){
+            writers.push_back(std::thread([&tree, t, perThread]() {
+                for(int i = 0; i < perThread; ++i){
+                    tree.insert(std::make_pair(t * perThread + i, t));
+                }
+            }));
+        }
+        for(size_t t = 0; t < writers.size(); ++t){
+            writers[t].join();
+        }
+    }
+
+    Tree recovered(snapshot_, log_);
+    std::map<int, int> expected;
+    for(int key = 0; key < threads * perThread; ++key){
+        expected[key] = key / perThread;
+    }
+    EXPECT_TRUE(sameContents(recovered, expected));
+}
@@ -0,0 +1,118 @@
+#include "check_tree.h"
+
+#include <wavlbst.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <map>
+#include <sstream>
+
+namespace
+{
+
+/**
+* A WAVLTree that counts the single rotations it makes (a double rotation
+* counts twice).
+*/
+class CountingWAVLTree : public WAVLTree<int, int>
+{
+public:
+    CountingWAVLTree() : rotations(0) {}
+
+    int height() const
+    {
+        return shape().height();
+    }
+
+    size_t nodes() const
+    {
+        return size_;
+    }
+
+    int rotations;
+
+protected:
+    virtual void rotateLeft(Node<int, int>* node)
+    {
+        rotations++;
+        WAVLTree<int, int>::rotateLeft(node);
+    }
+
+    virtual void rotateRight(Node<int, int>* node)
+    {
+        rotations++;
+        WAVLTree<int, int>::rotateRight(node);
+    }
+};
+
+}
+
+// without removes a WAVL tree is an AVL tree
+TEST(WAVLTree, InsertOnlyIsAVL)
+{
+    CountingWAVLTree tree;
+    std::map<int, int> expected;
+    for(int i = 0; i < 2000; ++i){
+        int key = (i * 7919) % 2003;
+        tree.insert(std::make_pair(key, i));
+        expected[key] = i;
+        ASSERT_TRUE(tree.isRankBalanced()) << "after inserting " << key;
+    }
+    EXPECT_TRUE(tree.isBalanced());
+    EXPECT_TRUE(sameContents(tree, expected));
+}
+
+TEST(WAVLTree, RemoveRotatesAtMostTwice)
+{
+    CountingWAVLTree tree;
+    for(int i = 0; i < 4096; ++i){
+        tree.insert(std::make_pair(i, i));
+    }
+    for(int i = 0; i < 4096; ++i){
+        int key = (i * 2731) % 4096;
+        tree.rotations = 0;
+        tree.remove(key);
+        ASSERT_LE(tree.rotations, 2) << "removing " << key;
+        ASSERT_TRUE(tree.isRankBalanced()) << "after removing " << key;
+    }
+    EXPECT_TRUE(tree.empty());
+}
+
+TEST(WAVLTree, RandomAgainstStdMap)
+{
+    for(unsigned seed = 1; seed <= 5; ++seed){
+        CountingWAVLTree tree;
+        std::map<int, int> expected;
+        randomWorkload(tree, expected, seed, 20000, 2000, 250, [&](int step) {
+            ASSERT_TRUE(tree.isRankBalanced()) << "seed " << seed << ", step " << step;
+            ASSERT_EQ(expected.size(), tree.nodes()) << "seed " << seed << ", step " << step;
+            if(!expected.empty()){
+                ASSERT_LE(tree.height(), 2 * std::log2(static_cast<double>(expected.size())) + 1)
+                    << "seed " << seed << ", step " << step;
+            }
+        });
+        EXPECT_TRUE(sameContents(tree, expected)) << "seed " << seed;
+    }
+}
+
+// loaded nodes get their ranks from the subtree heights
+TEST(WAVLTree, LoadedTreeKeepsRankBalance)
+{
+    WAVLTree<int, int> tree;
+    std::map<int, int> expected;
+    for(int i = 0; i < 100; ++i){
+        tree.insert(std::make_pair(i, i));
+        expected[i] = i;
+    }
+    std::stringstream snapshot;
+    tree.save(snapshot);
+
+    CountingWAVLTree loaded;
+    loaded.load(snapshot);
+    ASSERT_TRUE(loaded.isRankBalanced());
+    randomWorkload(loaded, expected, 3, 2000, 200, 1, [&](int step) {
+        ASSERT_TRUE(loaded.isRankBalanced()) << "step " << step;
+    });
+    EXPECT_TRUE(sameContents(loaded, expected));
+}
@@ -0,0 +1,287 @@
+#ifndef TREE_EXPORT_H
+#define TREE_EXPORT_H
+
+#include <iostream>
+#include <streambuf>
+#include <cstdint>
+#include <limits>
+
+// Streaming tree export
+//
+// exportTreeNodes() writes a tree, or the subtree under any node, as a
+// Graphviz DOT graph or as JSON lines (one object per node), in a single
+// pre-order pass. The walk follows parent links back up instead of
+// keeping a stack, so memory use is constant whatever the size or shape
+// of the tree, and every node is written as soon as it is reached.
+// BinarySearchTree::exportTree() and exportSubtree() are the usual entry
+// points.
+//
+// Subtrees cut off by the depth limit are not walked; each is written as
+// a single "..." placeholder so the output still shows where the tree
+// continues. Sampling writes a random subset of the nodes instead, each
+// linked to its closest written ancestor (a dashed edge in DOT when nodes
+// were skipped in between); the choice hangs off the node address, so it
+// needs no memory either. Keys and values are written with operator<<.
+
+enum TreeExportFormat { TREE_EXPORT_DOT, TREE_EXPORT_JSON };
+
+struct TreeExportOptions
+{
+    TreeExportOptions() :
+        format(TREE_EXPORT_DOT),
+        maxDepth(std::numeric_limits<size_t>::max()),
+        sampleRate(1.0),
+        seed(1)
+    {}
+
+    TreeExportFormat format;
+    // deepest level written, counted in edges from the exported root
+    size_t maxDepth;
+    // chance that a node is written; the exported root always is
+    double sampleRate;
+    // seeds the sampling
+    uint64_t seed;
+};
+
+/**
+* Writes the subtree under root; see above. NodeType needs getLeft(),
+* getRight(), getParent(), getKey() and getValue().
+*/
+template <class NodeType>
+void exportTreeNodes(std::ostream& os, const NodeType* root, const TreeExportOptions& options);
+
+/*
+  -------------------------------------------------
+  Begin implementations for the tree export engine.
+  -------------------------------------------------
+*/
+
+/**
+* A streambuf that forwards to another one, escaping what passes through
+* for use inside a double quoted DOT or JSON string. Keys and values are
+* streamed through it straight to the output, without a string copy.
+*/
+class TreeExportEscaper : public std::streambuf
+{
+public:
+    explicit TreeExportEscaper(std::streambuf* out) : out_(out) {}
+
+protected:
+    int_type overflow(int_type ch)
+    {
+        if(traits_type::eq_int_type(ch, traits_type::eof())){
+            return traits_type::not_eof(ch);
+        }
+        char c = traits_type::to_char_type(ch);
+        if(c == '"' || c == '\\'){
+            out_->sputc('\\');
+            out_->sputc(c);
+        }
+        else if(c == '\n'){
+            out_->sputn("\\n", 2);
+        }
+        else if(static_cast<unsigned char>(c) < 0x20){
+            // neither format has a use for other control characters
+            out_->sputc(' ');
+        }
+        else{
+            out_->sputc(c);
+        }
+        return ch;
+    }
+
+private:
+    std::streambuf* out_;
+};
+
+/**
+* The output stream plus a second stream over it that escapes, shared by
+* every node of one export.
+*/
+struct TreeExportWriter
+{
+    explicit TreeExportWriter(std::ostream& os) : os(os), escaper(os.rdbuf()), escaped(&escaper)
+    {
+        escaped.copyfmt(os);
+    }
+
+    std::ostream& os;
+    TreeExportEscaper escaper;
+    std::ostream escaped;
+};
+
+// node ids are the node addresses, so a child can name its parent
+// without the walk remembering anything
+inline void treeExportId(std::ostream& os, const void* node)
+{
+    std::ios::fmtflags flags(os.flags());
+    os << 'n' << std::hex << reinterpret_cast<uintptr_t>(node);
+    os.flags(flags);
+}
+
+// whether sampling keeps node; the root of the export is always kept
+template <class NodeType>
+bool treeExportSampled(const NodeType* node, const NodeType* root, const TreeExportOptions& options)
+{
+    if(node == root || options.sampleRate >= 1.0){
+        return true;
+    }
+    // splitmix64 finalizer over the address
+    uint64_t x = reinterpret_cast<uintptr_t>(node) ^ options.seed;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return static_cast<double>(x) < options.sampleRate * 18446744073709551616.0;
+}
+
+/**
+* Writes the edge into node (or into a placeholder hanging below node
+* when child is given) from the closest written ancestor, which sampling
+* may have put several levels up.
+*/
+template <class NodeType>
+void treeExportEdge(std::ostream& os, const NodeType* node, const NodeType* child, const NodeType* root,
+                    const TreeExportOptions& options)
+{
+    const NodeType* below = child;
+    const NodeType* above = node;
+    size_t skipped = 0;
+    if(child == nullptr){
+        if(node == root){
+            if(options.format == TREE_EXPORT_JSON){
+                os << "\"parent\":null,\"side\":null,\"skipped\":0";
+            }
+            return;
+        }
+        below = node;
+        above = node->getParent();
+    }
+    while(!treeExportSampled(above, root, options)){
+        skipped++;
+        below = above;
+        above = above->getParent();
+    }
+    char side = above->getLeft() == below ? 'L' : 'R';
+    if(options.format == TREE_EXPORT_DOT){
+        os << "  ";
+        treeExportId(os, above);
+        os << " -> ";
+        treeExportId(os, child == nullptr ? node : child);
+        os << " [label=\"" << side << "\"";
+        if(child != nullptr || skipped > 0){
+            os << ", style=dashed";
+        }
+        os << "];\n";
+    }
+    else{
+        os << "\"parent\":\"";
+        treeExportId(os, above);
+        os << "\",\"side\":\"" << side << "\",\"skipped\":" << skipped;
+    }
+}
+
+template <class NodeType>
+void treeExportNode(TreeExportWriter& out, const NodeType* node, const NodeType* root, size_t depth,
+                    const TreeExportOptions& options)
+{
+    std::ostream& os = out.os;
+    if(options.format == TREE_EXPORT_DOT){
+        os << "  ";
+        treeExportId(os, node);
+        os << " [label=\"";
+        out.escaped << node->getKey() << ": " << node->getValue();
+        os << "\"];\n";
+        treeExportEdge(os, node, static_cast<const NodeType*>(nullptr), root, options);
+    }
+    else{
+        os << "{\"id\":\"";
+        treeExportId(os, node);
+        os << "\",";
+        treeExportEdge(os, node, static_cast<const NodeType*>(nullptr), root, options);
+        os << ",\"depth\":" << depth << ",\"key\":\"";
+        out.escaped << node->getKey();
+        os << "\",\"value\":\"";
+        out.escaped << node->getValue();
+        os << "\"}\n";
+    }
+}
+
+// placeholder for a subtree cut off by the depth limit
+template <class NodeType>
+void treeExportElided(std::ostream& os, const NodeType* child, const NodeType* parent, const NodeType* root,
+                      size_t depth, const TreeExportOptions& options)
+{
+    if(options.format == TREE_EXPORT_DOT){
+        os << "  ";
+        treeExportId(os, child);
+        os << " [label=\"...\", shape=plaintext];\n";
+        treeExportEdge(os, parent, child, root, options);
+    }
+    else{
+        os << "{\"id\":\"";
+        treeExportId(os, child);
+        os << "\",";
+        treeExportEdge(os, parent, child, root, options);
+        os << ",\"depth\":" << depth << ",\"elided\":true}\n";
+    }
+}
+
+template <class NodeType>
+void exportTreeNodes(std::ostream& os, const NodeType* root, const TreeExportOptions& options)
+{
+    if(options.format == TREE_EXPORT_DOT){
+        os << "digraph tree {\n  node [shape=box];\n";
+    }
+    if(root == nullptr){
+        if(options.format == TREE_EXPORT_DOT){
+            os << "}\n";
+        }
+        return;
+    }
+
+    TreeExportWriter out(os);
+    enum { ARRIVED, LEFT_DONE, RIGHT_DONE };
+    const NodeType* node = root;
+    size_t depth = 0;
+    int step = ARRIVED;
+    while(true){
+        if(step == ARRIVED && treeExportSampled(node, root, options)){
+            treeExportNode(out, node, root, depth, options);
+        }
+        if(step != RIGHT_DONE){
+            // the child still to look at
+            const NodeType* child = step == ARRIVED ? node->getLeft() : node->getRight();
+            if(child != nullptr && depth < options.maxDepth){
+                node = child;
+                depth++;
+                step = ARRIVED;
+                continue;
+            }
+            if(child != nullptr){
+                treeExportElided(os, child, node, root, depth + 1, options);
+            }
+            step = step == ARRIVED ? LEFT_DONE : RIGHT_DONE;
+            continue;
+        }
+        // both children done, climb
+        if(node == root){
+            break;
+        }
+        const NodeType* parent = node->getParent();
+        step = parent->getLeft() == node ? LEFT_DONE : RIGHT_DONE;
+        node = parent;
+        depth--;
+    }
+
+    if(options.format == TREE_EXPORT_DOT){
+        os << "}\n";
+    }
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the tree export engine.
+  -----------------------------------------------
+*/
+
+#endif
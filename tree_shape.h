@@ -0,0 +1,242 @@
+#ifndef TREE_SHAPE_H
+#define TREE_SHAPE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+// Tree shape analytics
+//
+// treeShape() walks any binary tree once, iteratively, and reports node
+// and leaf counts, the shallowest and deepest leaf and a histogram of
+// leaf depths. The walk keeps its own stack on the heap, so arbitrarily
+// deep (degenerate) trees are fine. A links policy tells the engine how
+// to reach a node's children: FieldLinks for nodes with public left and
+// right members (equal-paths.h), GetterLinks for nodes with getLeft() and
+// getRight() (bst.h and the trees built on it).
+//
+// Depths count edges, so the root is at depth 0.
+
+/**
+* Shape statistics of one tree, or of several subtrees merged together.
+*/
+struct TreeShape
+{
+    TreeShape() : nodes(0), leaves(0), minLeafDepth(0), maxLeafDepth(0) {}
+
+    uint64_t nodes;
+    uint64_t leaves;
+    size_t minLeafDepth;
+    size_t maxLeafDepth;
+    // leafDepths[d] is the number of leaves at depth d
+    std::vector<uint64_t> leafDepths;
+
+    void addLeaf(size_t depth);
+    void merge(const TreeShape& other);
+    bool equalLeafDepths() const;
+    size_t height() const;
+};
+
+/**
+* Reaches children through public left and right members.
+*/
+struct FieldLinks
+{
+    template <class NodeType>
+    static NodeType* left(const NodeType* node) { return node->left; }
+    template <class NodeType>
+    static NodeType* right(const NodeType* node) { return node->right; }
+};
+
+/**
+* Reaches children through getLeft() and getRight().
+*/
+struct GetterLinks
+{
+    template <class NodeType>
+    static NodeType* left(const NodeType* node) { return node->getLeft(); }
+    template <class NodeType>
+    static NodeType* right(const NodeType* node) { return node->getRight(); }
+};
+
+template <class Links, class NodeType>
+void treeShapeWalk(const NodeType* root, size_t rootDepth, TreeShape& shape);
+
+template <class Links, class NodeType>
+TreeShape treeShape(const NodeType* root, unsigned threads = 1);
+
+/*
+  ------------------------------------------------
+  Begin implementations for the tree shape engine.
+  ------------------------------------------------
+*/
+
+inline void TreeShape::addLeaf(size_t depth)
+{
+    if(leaves == 0 || depth < minLeafDepth){
+        minLeafDepth = depth;
+    }
+    if(leaves == 0 || depth > maxLeafDepth){
+        maxLeafDepth = depth;
+    }
+    leaves++;
+    if(leafDepths.size() <= depth){
+        leafDepths.resize(depth + 1, 0);
+    }
+    leafDepths[depth]++;
+}
+
+/**
+* Adds the statistics of another part of the same tree; depths in other
+* must already be relative to the same root.
+*/
+inline void TreeShape::merge(const TreeShape& other)
+{
+    if(other.leaves > 0){
+        if(leaves == 0 || other.minLeafDepth < minLeafDepth){
+            minLeafDepth = other.minLeafDepth;
+        }
+        if(leaves == 0 || other.maxLeafDepth > maxLeafDepth){
+            maxLeafDepth = other.maxLeafDepth;
+        }
+    }
+    nodes += other.nodes;
+    leaves += other.leaves;
+    if(leafDepths.size() < other.leafDepths.size()){
+        leafDepths.resize(other.leafDepths.size(), 0);
+    }
+    for(size_t d = 0; d < other.leafDepths.size(); ++d){
+        leafDepths[d] += other.leafDepths[d];
+    }
+}
+
+/**
+* True if every leaf is at the same depth (also for an empty tree).
+*/
+inline bool TreeShape::equalLeafDepths() const
+{
+    return minLeafDepth == maxLeafDepth;
+}
+
+/**
+* Number of nodes on the longest root to leaf path, 0 for an empty tree.
+*/
+inline size_t TreeShape::height() const
+{
+    return nodes == 0 ? 0 : maxLeafDepth + 1;
+}
+
+/**
+* Adds every node under root, which sits at rootDepth, to shape.
+*/
+template <class Links, class NodeType>
+void treeShapeWalk(const NodeType* root, size_t rootDepth, TreeShape& shape)
+{
+    if(root == nullptr){
+        return;
+    }
+    std::vector<std::pair<const NodeType*, size_t> > pending(1, std::make_pair(root, rootDepth));
+    while(!pending.empty()){
+        const NodeType* node = pending.back().first;
+        size_t depth = pending.back().second;
+        pending.pop_back();
+        shape.nodes++;
+        const NodeType* left = Links::left(node);
+        const NodeType* right = Links::right(node);
+        if(left == nullptr && right == nullptr){
+            shape.addLeaf(depth);
+        }
+        if(right != nullptr){
+            pending.push_back(std::make_pair(right, depth + 1));
+        }
+        if(left != nullptr){
+            pending.push_back(std::make_pair(left, depth + 1));
+        }
+    }
+}
+
+/**
+* Shape of the tree under root. With threads > 1 the top of the tree is
+* expanded breadth first until there are a few subtrees per thread, and
+* the threads then take those subtrees one at a time, each filling its
+* own TreeShape; the results are merged at the end. Trees too small or
+* too lopsided to split are walked by the calling thread alone. The tree
+* must not be modified during the walk.
+*/
+template <class Links, class NodeType>
+TreeShape treeShape(const NodeType* root, unsigned threads)
+{
+    TreeShape shape;
+    if(threads <= 1){
+        treeShapeWalk<Links>(root, 0, shape);
+        return shape;
+    }
+
+    // expand the top levels on this thread; a level that does not widen
+    // the frontier means the tree is a chain here and not worth splitting
+    std::vector<std::pair<const NodeType*, size_t> > frontier;
+    if(root != nullptr){
+        frontier.push_back(std::make_pair(root, size_t(0)));
+    }
+    size_t wanted = static_cast<size_t>(threads) * 4;
+    while(!frontier.empty() && frontier.size() < wanted){
+        std::vector<std::pair<const NodeType*, size_t> > next;
+        for(size_t i = 0; i < frontier.size(); ++i){
+            const NodeType* node = frontier[i].first;
+            size_t depth = frontier[i].second;
+            shape.nodes++;
+            const NodeType* left = Links::left(node);
+            const NodeType* right = Links::right(node);
+            if(left == nullptr && right == nullptr){
+                shape.addLeaf(depth);
+            }
+            if(left != nullptr){
+                next.push_back(std::make_pair(left, depth + 1));
+            }
+            if(right != nullptr){
+                next.push_back(std::make_pair(right, depth + 1));
+            }
+        }
+        bool widened = next.size() > frontier.size();
+        frontier.swap(next);
+        if(!widened){
+            break;
+        }
+    }
+    if(frontier.size() < 2){
+        for(size_t i = 0; i < frontier.size(); ++i){
+            treeShapeWalk<Links>(frontier[i].first, frontier[i].second, shape);
+        }
+        return shape;
+    }
+
+    unsigned workers = std::min<size_t>(threads, frontier.size());
+    std::vector<TreeShape> partial(workers);
+    std::atomic<size_t> nextSubtree(0);
+    std::vector<std::thread> pool;
+    for(unsigned w = 0; w < workers; ++w){
+        pool.push_back(std::thread([&frontier, &partial, &nextSubtree, w]() {
+            size_t i;
+            while((i = nextSubtree.fetch_add(1)) < frontier.size()){
+                treeShapeWalk<Links>(frontier[i].first, frontier[i].second, partial[w]);
+            }
+        }));
+    }
+    for(unsigned w = 0; w < workers; ++w){
+        pool[w].join();
+        shape.merge(partial[w]);
+    }
+    return shape;
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the tree shape engine.
+  ----------------------------------------------
+*/
+
+#endif
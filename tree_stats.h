@@ -0,0 +1,337 @@
+#ifndef TREE_STATS_H
+#define TREE_STATS_H
+
+#include <iostream>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+// Tree instrumentation
+//
+// Build with -DBST_STATS to count, per thread, what BinarySearchTree and
+// AVLTree do on their hot paths and to time every insert, find and remove
+// into a log2 latency histogram. treeStatsSnapshot() sums every thread's
+// counters. Without BST_STATS the BST_STAT_* macros expand to nothing, so
+// the trees compile to exactly what they were; the snapshot API is still
+// there and reports zeros.
+
+enum TreeCounter
+{
+    TREE_COMPARISONS,      // key comparisons made while descending
+    TREE_FIND_CALLS,       // internalFind() calls
+    TREE_FIND_PATH,        // nodes visited by internalFind(), summed
+    TREE_ROTATE_LEFT,
+    TREE_ROTATE_RIGHT,
+    TREE_ZIGZIG,           // AVL rebalances fixed by a single rotation
+    TREE_ZIGZAG,           // AVL rebalances needing a double rotation
+    TREE_NODE_SWAPS,
+    TREE_CACHE_HITS,       // internalFind() answered by the lookup cache
+    TREE_CACHE_MISSES,
+    TREE_COUNTER_COUNT
+};
+
+enum TreeOp
+{
+    TREE_INSERT,
+    TREE_FIND,
+    TREE_REMOVE,
+    TREE_OP_COUNT
+};
+
+// bucket b counts operations that took [2^b, 2^(b+1)) ns; bucket 0 also
+// takes 0 and 1 ns
+static const int TREE_LATENCY_BUCKETS = 40;
+
+/**
+* A point-in-time copy of the counters of every thread.
+*/
+struct TreeStatsSnapshot
+{
+    uint64_t counters[TREE_COUNTER_COUNT];
+    uint64_t latency[TREE_OP_COUNT][TREE_LATENCY_BUCKETS];
+
+    uint64_t operations(TreeOp op) const;
+    uint64_t totalOperations() const;
+    double latencyPercentileNs(TreeOp op, double percentile) const;
+    void print(std::ostream& os) const;
+};
+
+/**
+* One thread's counters. Only the owning thread writes them, so updates
+* are plain load/store pairs with no read-modify-write; the atomics only
+* make it safe for snapshots to read them from other threads.
+*/
+struct TreeStatsCounters
+{
+    TreeStatsCounters();
+
+    void add(TreeCounter counter, uint64_t n);
+    void record(TreeOp op, uint64_t ns);
+
+    std::atomic<uint64_t> counters[TREE_COUNTER_COUNT];
+    std::atomic<uint64_t> latency[TREE_OP_COUNT][TREE_LATENCY_BUCKETS];
+};
+
+/**
+* Tracks the counters of live threads and keeps the totals of threads
+* that have exited, so nothing is lost when a worker thread ends.
+*/
+class TreeStatsRegistry
+{
+public:
+    static TreeStatsRegistry& instance();
+
+    void attach(TreeStatsCounters* counters);
+    void detach(TreeStatsCounters* counters);
+    TreeStatsSnapshot snapshot();
+    void reset();
+
+private:
+    TreeStatsRegistry() : retired_() {}
+    static void accumulate(TreeStatsSnapshot& into, const TreeStatsCounters& from);
+
+    std::mutex mutex_;
+    std::vector<TreeStatsCounters*> live_;
+    TreeStatsSnapshot retired_;
+};
+
+TreeStatsCounters& treeStatsLocal();
+TreeStatsSnapshot treeStatsSnapshot();
+void treeStatsReset();
+
+/**
+* Records the lifetime of the enclosing scope as one op.
+*/
+class TreeStatsTimer
+{
+public:
+    explicit TreeStatsTimer(TreeOp op) : op_(op), start_(std::chrono::steady_clock::now()) {}
+    ~TreeStatsTimer()
+    {
+        std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start_;
+        treeStatsLocal().record(op_, static_cast<uint64_t>(elapsed.count()));
+    }
+
+private:
+    TreeOp op_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#ifdef BST_STATS
+#define BST_STAT_ADD(counter, n) treeStatsLocal().add(counter, n)
+#define BST_STAT_TIMER(op) TreeStatsTimer bstStatTimer_(op)
+#else
+#define BST_STAT_ADD(counter, n) ((void)0)
+#define BST_STAT_TIMER(op) ((void)0)
+#endif
+
+/*
+  ------------------------------------------------
+  Begin implementations for the tree stats classes.
+  ------------------------------------------------
+*/
+
+inline uint64_t TreeStatsSnapshot::operations(TreeOp op) const
+{
+    uint64_t total = 0;
+    for(int b = 0; b < TREE_LATENCY_BUCKETS; ++b){
+        total += latency[op][b];
+    }
+    return total;
+}
+
+inline uint64_t TreeStatsSnapshot::totalOperations() const
+{
+    uint64_t total = 0;
+    for(int op = 0; op < TREE_OP_COUNT; ++op){
+        total += operations(static_cast<TreeOp>(op));
+    }
+    return total;
+}
+
+/**
+* Upper bound of the histogram bucket holding the given percentile
+* (0-100) of op's latencies, or 0 if op was never timed.
+*/
+inline double TreeStatsSnapshot::latencyPercentileNs(TreeOp op, double percentile) const
+{
+    uint64_t total = operations(op);
+    if(total == 0){
+        return 0;
+    }
+    double target = total * percentile / 100.0;
+    uint64_t seen = 0;
+    for(int b = 0; b < TREE_LATENCY_BUCKETS; ++b){
+        seen += latency[op][b];
+        if(seen >= target){
+            return static_cast<double>(uint64_t(1) << (b + 1));
+        }
+    }
+    return static_cast<double>(uint64_t(1) << TREE_LATENCY_BUCKETS);
+}
+
+/**
+* Writes the snapshot as one JSON object.
+*/
+inline void TreeStatsSnapshot::print(std::ostream& os) const
+{
+    static const char* counterNames[TREE_COUNTER_COUNT] = {
+        "comparisons", "find_calls", "find_path_nodes", "rotate_left", "rotate_right",
+        "zigzig", "zigzag", "node_swaps", "cache_hits", "cache_misses"
+    };
+    static const char* opNames[TREE_OP_COUNT] = { "insert", "find", "remove" };
+
+    uint64_t ops = totalOperations();
+    uint64_t finds = counters[TREE_FIND_CALLS];
+    uint64_t probes = counters[TREE_CACHE_HITS] + counters[TREE_CACHE_MISSES];
+    os << "{";
+    for(int c = 0; c < TREE_COUNTER_COUNT; ++c){
+        os << "\"" << counterNames[c] << "\":" << counters[c] << ",";
+    }
+    os << "\"comparisons_per_op\":" << (ops == 0 ? 0.0 : static_cast<double>(counters[TREE_COMPARISONS]) / ops) << ","
+       << "\"mean_find_path\":" << (finds == 0 ? 0.0 : static_cast<double>(counters[TREE_FIND_PATH]) / finds) << ","
+       << "\"cache_hit_rate\":" << (probes == 0 ? 0.0 : static_cast<double>(counters[TREE_CACHE_HITS]) / probes);
+    for(int op = 0; op < TREE_OP_COUNT; ++op){
+        TreeOp o = static_cast<TreeOp>(op);
+        os << ",\"" << opNames[op] << "\":{\"count\":" << operations(o)
+           << ",\"p50_ns\":" << latencyPercentileNs(o, 50)
+           << ",\"p99_ns\":" << latencyPercentileNs(o, 99)
+           << ",\"p999_ns\":" << latencyPercentileNs(o, 99.9)
+           << ",\"histogram\":[";
+        for(int b = 0; b < TREE_LATENCY_BUCKETS; ++b){
+            os << (b == 0 ? "" : ",") << latency[op][b];
+        }
+        os << "]}";
+    }
+    os << "}" << std::endl;
+}
+
+inline TreeStatsCounters::TreeStatsCounters()
+{
+    for(int c = 0; c < TREE_COUNTER_COUNT; ++c){
+        counters[c].store(0, std::memory_order_relaxed);
+    }
+    for(int op = 0; op < TREE_OP_COUNT; ++op){
+        for(int b = 0; b < TREE_LATENCY_BUCKETS; ++b){
+            latency[op][b].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+inline void TreeStatsCounters::add(TreeCounter counter, uint64_t n)
+{
+    counters[counter].store(counters[counter].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void TreeStatsCounters::record(TreeOp op, uint64_t ns)
+{
+    int bucket = 0;
+    while(ns > 1 && bucket < TREE_LATENCY_BUCKETS - 1){
+        ns >>= 1;
+        bucket++;
+    }
+    std::atomic<uint64_t>& slot = latency[op][bucket];
+    slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+inline TreeStatsRegistry& TreeStatsRegistry::instance()
+{
+    static TreeStatsRegistry registry;
+    return registry;
+}
+
+inline void TreeStatsRegistry::attach(TreeStatsCounters* counters)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    live_.push_back(counters);
+}
+
+inline void TreeStatsRegistry::detach(TreeStatsCounters* counters)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    accumulate(retired_, *counters);
+    live_.erase(std::remove(live_.begin(), live_.end(), counters), live_.end());
+}
+
+inline TreeStatsSnapshot TreeStatsRegistry::snapshot()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    TreeStatsSnapshot result = retired_;
+    for(size_t i = 0; i < live_.size(); ++i){
+        accumulate(result, *live_[i]);
+    }
+    return result;
+}
+
+/**
+* Zeroes every counter. Counts made by other threads while the reset runs
+* may survive it or be lost; reset while the trees are quiet for exact
+* numbers.
+*/
+inline void TreeStatsRegistry::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    retired_ = TreeStatsSnapshot();
+    for(size_t i = 0; i < live_.size(); ++i){
+        TreeStatsCounters* counters = live_[i];
+        for(int c = 0; c < TREE_COUNTER_COUNT; ++c){
+            counters->counters[c].store(0, std::memory_order_relaxed);
+        }
+        for(int op = 0; op < TREE_OP_COUNT; ++op){
+            for(int b = 0; b < TREE_LATENCY_BUCKETS; ++b){
+                counters->latency[op][b].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+inline void TreeStatsRegistry::accumulate(TreeStatsSnapshot& into, const TreeStatsCounters& from)
+{
+    for(int c = 0; c < TREE_COUNTER_COUNT; ++c){
+        into.counters[c] += from.counters[c].load(std::memory_order_relaxed);
+    }
+    for(int op = 0; op < TREE_OP_COUNT; ++op){
+        for(int b = 0; b < TREE_LATENCY_BUCKETS; ++b){
+            into.latency[op][b] += from.latency[op][b].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// registers the thread's counters on first use and folds them into the
+// retired totals when the thread exits
+struct TreeStatsThread
+{
+    TreeStatsThread() { TreeStatsRegistry::instance().attach(&counters); }
+    ~TreeStatsThread() { TreeStatsRegistry::instance().detach(&counters); }
+    TreeStatsCounters counters;
+};
+
+/**
+* The calling thread's counters.
+*/
+inline TreeStatsCounters& treeStatsLocal()
+{
+    static thread_local TreeStatsThread thread;
+    return thread.counters;
+}
+
+inline TreeStatsSnapshot treeStatsSnapshot()
+{
+    return TreeStatsRegistry::instance().snapshot();
+}
+
+inline void treeStatsReset()
+{
+    TreeStatsRegistry::instance().reset();
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the tree stats classes.
+  ----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,610 @@
+#ifndef TTLAVL_H
+#define TTLAVL_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <chrono>
+#include "avlbst.h"
+
+/**
+* An AVLNode with an expiry time and its position in the expiry heap.
+*/
+template <typename Key, typename Value>
+class TTLAVLNode : public AVLNode<Key, Value>
+{
+public:
+    TTLAVLNode(const Key& key, const Value& value, TTLAVLNode<Key, Value>* parent);
+    virtual ~TTLAVLNode();
+
+    uint64_t getExpiry() const;
+    void setExpiry(uint64_t expiry);
+    size_t getHeapIndex() const;
+    void setHeapIndex(size_t index);
+
+    virtual TTLAVLNode<Key, Value>* getParent() const override;
+    virtual TTLAVLNode<Key, Value>* getLeft() const override;
+    virtual TTLAVLNode<Key, Value>* getRight() const override;
+
+protected:
+    uint64_t expiry_;
+    size_t heapIndex_;
+};
+
+/*
+  ------------------------------------------------
+  Begin implementations for the TTLAVLNode class.
+  ------------------------------------------------
+*/
+
+template<class Key, class Value>
+TTLAVLNode<Key, Value>::TTLAVLNode(const Key& key, const Value& value, TTLAVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent),
+    expiry_(std::numeric_limits<uint64_t>::max()),
+    heapIndex_(std::numeric_limits<size_t>::max())
+{
+
+}
+
+template<class Key, class Value>
+TTLAVLNode<Key, Value>::~TTLAVLNode()
+{
+
+}
+
+template<class Key, class Value>
+uint64_t TTLAVLNode<Key, Value>::getExpiry() const
+{
+    return expiry_;
+}
+
+template<class Key, class Value>
+void TTLAVLNode<Key, Value>::setExpiry(uint64_t expiry)
+{
+    expiry_ = expiry;
+}
+
+template<class Key, class Value>
+size_t TTLAVLNode<Key, Value>::getHeapIndex() const
+{
+    return heapIndex_;
+}
+
+template<class Key, class Value>
+void TTLAVLNode<Key, Value>::setHeapIndex(size_t index)
+{
+    heapIndex_ = index;
+}
+
+template<class Key, class Value>
+TTLAVLNode<Key, Value>* TTLAVLNode<Key, Value>::getParent() const
+{
+    return static_cast<TTLAVLNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+TTLAVLNode<Key, Value>* TTLAVLNode<Key, Value>::getLeft() const
+{
+    return static_cast<TTLAVLNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+TTLAVLNode<Key, Value>* TTLAVLNode<Key, Value>::getRight() const
+{
+    return static_cast<TTLAVLNode<Key, Value>*>(this->right_);
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the TTLAVLNode class.
+  ----------------------------------------------
+*/
+
+/**
+* An AVLTree whose entries can expire. Each node carries its expiry time,
+* and the nodes that have one also sit in a binary min-heap ordered by
+* expiry, each node knowing its heap slot, so expire() pops exactly the
+* k due entries in O(k log n) without scanning the tree, and changing or
+* dropping an entry's expiry is O(log n).
+*
+* Expired entries that expire() has not collected yet are already gone
+* as far as find(), operator[] and iteration are concerned; those only
+* compare the expiry against the clock, so readers never do removal
+* work. Collection happens only when the owner calls expire(), e.g. from
+* a periodic task.
+*
+* Times are uint64_t ticks of the clock given to the constructor;
+* the default is std::chrono::steady_clock in milliseconds. insert(item)
+* without a ttl stores an entry that never expires, and also clears the
+* ttl of an existing entry. size() and empty() count expired entries
+* until they are collected.
+*/
+template <class Key, class Value>
+class TTLAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef uint64_t Time;
+    typedef Time (*Clock)();
+    static const Time NEVER = UINT64_MAX;
+
+    /**
+    * An iterator that steps over entries that had expired when it was
+    * created.
+    */
+    class iterator : public AVLTree<Key, Value>::iterator
+    {
+    public:
+        iterator();
+        iterator(const typename AVLTree<Key, Value>::iterator& it, Time now);
+        iterator& operator++();
+
+    private:
+        void skipExpired();
+        Time now_;
+    };
+
+    explicit TTLAVLTree(Clock clock = &TTLAVLTree::steadyMillis);
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    void insert(const std::pair<const Key, Value>& new_item, Time ttl);
+    virtual typename AVLTree<Key, Value>::iterator insert(typename AVLTree<Key, Value>::iterator hint,
+                                                          const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    bool expireAt(const Key& key, Time when);
+    Time expiresAt(const Key& key) const;
+    size_t expire();
+    size_t expire(Time now);
+    virtual void clear();
+    virtual void load(std::istream& is);
+
+    size_t size() const;
+    size_t pending() const;
+    Time now() const;
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    void findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    static Time steadyMillis();
+
+protected:
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent) override;
+    virtual uint64_t liveStamp() const override;
+    virtual size_t liveCount(uint64_t stamp) const override;
+    virtual bool isLive(const Node<Key, Value>* node, uint64_t stamp) const override;
+
+    size_t countDue(size_t index, Time now) const;
+    TTLAVLNode<Key, Value>* liveNode(const Key& key) const;
+    void schedule(TTLAVLNode<Key, Value>* node, Time expiry);
+    void heapErase(TTLAVLNode<Key, Value>* node);
+    void heapPlace(TTLAVLNode<Key, Value>* node, size_t index);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+
+    Clock clock_;
+    // the node made by the last createNode(), so insert() can schedule a
+    // new entry without looking it up again
+    TTLAVLNode<Key, Value>* created_;
+    // min-heap of every node with an expiry, by expiry
+    std::vector<TTLAVLNode<Key, Value>*> heap_;
+};
+
+/*
+  ---------------------------------------------------------
+  Begin implementations for the TTLAVLTree::iterator class.
+  ---------------------------------------------------------
+*/
+
+template<class Key, class Value>
+TTLAVLTree<Key, Value>::iterator::iterator() : now_(0)
+{
+
+}
+
+template<class Key, class Value>
+TTLAVLTree<Key, Value>::iterator::iterator(const typename AVLTree<Key, Value>::iterator& it, Time now) :
+    AVLTree<Key, Value>::iterator(it), now_(now)
+{
+    skipExpired();
+}
+
+template<class Key, class Value>
+typename TTLAVLTree<Key, Value>::iterator&
+TTLAVLTree<Key, Value>::iterator::operator++()
+{
+    AVLTree<Key, Value>::iterator::operator++();
+    skipExpired();
+    return *this;
+}
+
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::iterator::skipExpired()
+{
+    while(this->current_ != nullptr && static_cast<TTLAVLNode<Key, Value>*>(this->current_)->getExpiry() <= now_){
+        AVLTree<Key, Value>::iterator::operator++();
+    }
+}
+
+/*
+  -------------------------------------------------------
+  End implementations for the TTLAVLTree::iterator class.
+  -------------------------------------------------------
+*/
+
+/*
+  -----------------------------------------------
+  Begin implementations for the TTLAVLTree class.
+  -----------------------------------------------
+*/
+
+template<class Key, class Value>
+const typename TTLAVLTree<Key, Value>::Time TTLAVLTree<Key, Value>::NEVER;
+
+template<class Key, class Value>
+TTLAVLTree<Key, Value>::TTLAVLTree(Clock clock) :
+    clock_(clock),
+    created_(nullptr)
+{
+
+}
+
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    insert(new_item, NEVER);
+}
+
+/**
+* Inserts or overwrites an entry that expires ttl ticks from now (never
+* for NEVER). An expired entry that was not collected yet is replaced.
+*/
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item, Time ttl)
+{
+    TTLAVLNode<Key, Value>* node = static_cast<TTLAVLNode<Key, Value>*>(this->internalFind(new_item.first));
+    if(node != nullptr){
+        node->setValue(new_item.second);
+    }
+    else{
+        AVLTree<Key, Value>::insert(new_item);
+        node = created_;
+    }
+    Time now = clock_();
+    schedule(node, ttl == NEVER || ttl >= NEVER - now ? NEVER : now + ttl);
+}
+
+/**
+* Hinted insert, see AVLTree; like insert(item), the entry never expires.
+*/
+template<class Key, class Value>
+typename AVLTree<Key, Value>::iterator
+TTLAVLTree<Key, Value>::insert(typename AVLTree<Key, Value>::iterator hint, const std::pair<const Key, Value>& new_item)
+{
+    typename AVLTree<Key, Value>::iterator it = AVLTree<Key, Value>::insert(hint, new_item);
+    schedule(static_cast<TTLAVLNode<Key, Value>*>(this->iteratorNode(it)), NEVER);
+    return it;
+}
+
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::remove(const Key& key)
+{
+    TTLAVLNode<Key, Value>* node = static_cast<TTLAVLNode<Key, Value>*>(this->internalFind(key));
+    if(node == nullptr){
+        return;
+    }
+    heapErase(node);
+    AVLTree<Key, Value>::remove(key);
+}
+
+/**
+* Moves the expiry of a live entry to the absolute time when (NEVER to
+* make it permanent), e.g. to extend a session. Returns false if key is
+* absent or already expired.
+*/
+template<class Key, class Value>
+bool TTLAVLTree<Key, Value>::expireAt(const Key& key, Time when)
+{
+    TTLAVLNode<Key, Value>* node = liveNode(key);
+    if(node == nullptr){
+        return false;
+    }
+    schedule(node, when);
+    return true;
+}
+
+/**
+* The absolute expiry time of a live entry, NEVER if it has none. Throws
+* std::out_of_range if key is absent or expired.
+*/
+template<class Key, class Value>
+typename TTLAVLTree<Key, Value>::Time TTLAVLTree<Key, Value>::expiresAt(const Key& key) const
+{
+    TTLAVLNode<Key, Value>* node = liveNode(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    return node->getExpiry();
+}
+
+template<class Key, class Value>
+size_t TTLAVLTree<Key, Value>::expire()
+{
+    return expire(clock_());
+}
+
+/**
+* Removes every entry whose expiry is at or before now and returns how
+* many were removed.
+*/
+template<class Key, class Value>
+size_t TTLAVLTree<Key, Value>::expire(Time now)
+{
+    size_t removed = 0;
+    while(!heap_.empty() && heap_[0]->getExpiry() <= now){
+        TTLAVLNode<Key, Value>* node = heap_[0];
+        heapErase(node);
+        AVLTree<Key, Value>::remove(node->getKey());
+        removed++;
+    }
+    return removed;
+}
+
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::clear()
+{
+    AVLTree<Key, Value>::clear();
+    heap_.clear();
+}
+
+/**
+* Loads a snapshot; every loaded entry is permanent.
+*/
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::load(std::istream& is)
+{
+    clear();
+    BinarySearchTree<Key, Value>::load(is);
+}
+
+/**
+* Number of entries held, including expired ones not yet collected.
+*/
+template<class Key, class Value>
+size_t TTLAVLTree<Key, Value>::size() const
+{
+    return this->size_;
+}
+
+/**
+* Number of entries with an expiry, due or not.
+*/
+template<class Key, class Value>
+size_t TTLAVLTree<Key, Value>::pending() const
+{
+    return heap_.size();
+}
+
+template<class Key, class Value>
+typename TTLAVLTree<Key, Value>::Time TTLAVLTree<Key, Value>::now() const
+{
+    return clock_();
+}
+
+template<class Key, class Value>
+typename TTLAVLTree<Key, Value>::iterator TTLAVLTree<Key, Value>::begin() const
+{
+    return iterator(AVLTree<Key, Value>::begin(), clock_());
+}
+
+template<class Key, class Value>
+typename TTLAVLTree<Key, Value>::iterator TTLAVLTree<Key, Value>::end() const
+{
+    return iterator(AVLTree<Key, Value>::end(), 0);
+}
+
+template<class Key, class Value>
+typename TTLAVLTree<Key, Value>::iterator TTLAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(this->makeIterator(liveNode(key)), clock_());
+}
+
+/**
+* AVLTree::findBatch with entries that had expired by the start of the
+* batch mapped to end(), as find() would.
+*/
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::findBatch(const std::vector<Key>& keys, std::vector<iterator>& out) const
+{
+    Time now = clock_();
+    std::vector<typename AVLTree<Key, Value>::iterator> found;
+    AVLTree<Key, Value>::findBatch(keys, found);
+    out.resize(found.size());
+    for(size_t i = 0; i < found.size(); ++i){
+        TTLAVLNode<Key, Value>* node = static_cast<TTLAVLNode<Key, Value>*>(this->iteratorNode(found[i]));
+        if(node != nullptr && node->getExpiry() != NEVER && node->getExpiry() <= now){
+            node = nullptr;
+        }
+        out[i] = iterator(this->makeIterator(node), now);
+    }
+}
+
+template<class Key, class Value>
+Value& TTLAVLTree<Key, Value>::operator[](const Key& key)
+{
+    TTLAVLNode<Key, Value>* node = liveNode(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value>
+Value const & TTLAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    TTLAVLNode<Key, Value>* node = liveNode(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value>
+typename TTLAVLTree<Key, Value>::Time TTLAVLTree<Key, Value>::steadyMillis()
+{
+    return static_cast<Time>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+template<class Key, class Value>
+Node<Key, Value>* TTLAVLTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    created_ = new TTLAVLNode<Key, Value>(key, value, static_cast<TTLAVLNode<Key, Value>*>(parent));
+    return created_;
+}
+
+/**
+* Snapshots hold the entries that are live at the time of the stamp,
+* read from the clock once per save, and do not carry expiry times.
+*/
+template<class Key, class Value>
+uint64_t TTLAVLTree<Key, Value>::liveStamp() const
+{
+    return clock_();
+}
+
+template<class Key, class Value>
+size_t TTLAVLTree<Key, Value>::liveCount(uint64_t stamp) const
+{
+    return this->size_ - countDue(0, stamp);
+}
+
+template<class Key, class Value>
+bool TTLAVLTree<Key, Value>::isLive(const Node<Key, Value>* node, uint64_t stamp) const
+{
+    return static_cast<const TTLAVLNode<Key, Value>*>(node)->getExpiry() > stamp;
+}
+
+/**
+* Number of entries due by now in the heap below index. The due entries
+* form a subtree at the top of the heap, so this visits only them and
+* their direct children.
+*/
+template<class Key, class Value>
+size_t TTLAVLTree<Key, Value>::countDue(size_t index, Time now) const
+{
+    if(index >= heap_.size() || heap_[index]->getExpiry() > now){
+        return 0;
+    }
+    return 1 + countDue(2 * index + 1, now) + countDue(2 * index + 2, now);
+}
+
+/**
+* The node holding key, or NULL if key is absent or has expired.
+*/
+template<class Key, class Value>
+TTLAVLNode<Key, Value>* TTLAVLTree<Key, Value>::liveNode(const Key& key) const
+{
+    TTLAVLNode<Key, Value>* node = static_cast<TTLAVLNode<Key, Value>*>(this->internalFind(key));
+    if(node == nullptr || (node->getExpiry() != NEVER && node->getExpiry() <= clock_())){
+        return nullptr;
+    }
+    return node;
+}
+
+/**
+* Gives node a new expiry and moves it into, within or out of the heap.
+*/
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::schedule(TTLAVLNode<Key, Value>* node, Time expiry)
+{
+    if(expiry == NEVER){
+        heapErase(node);
+        node->setExpiry(NEVER);
+        return;
+    }
+    Time old = node->getExpiry();
+    node->setExpiry(expiry);
+    if(node->getHeapIndex() == std::numeric_limits<size_t>::max()){
+        heap_.push_back(node);
+        node->setHeapIndex(heap_.size() - 1);
+        siftUp(heap_.size() - 1);
+    }
+    else if(expiry < old){
+        siftUp(node->getHeapIndex());
+    }
+    else{
+        siftDown(node->getHeapIndex());
+    }
+}
+
+/**
+* Takes node out of the heap, if it is in it.
+*/
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::heapErase(TTLAVLNode<Key, Value>* node)
+{
+    size_t index = node->getHeapIndex();
+    if(index == std::numeric_limits<size_t>::max()){
+        return;
+    }
+    node->setHeapIndex(std::numeric_limits<size_t>::max());
+    TTLAVLNode<Key, Value>* last = heap_.back();
+    heap_.pop_back();
+    if(last == node){
+        return;
+    }
+    heapPlace(last, index);
+    siftUp(index);
+    siftDown(last->getHeapIndex());
+}
+
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::heapPlace(TTLAVLNode<Key, Value>* node, size_t index)
+{
+    heap_[index] = node;
+    node->setHeapIndex(index);
+}
+
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::siftUp(size_t index)
+{
+    TTLAVLNode<Key, Value>* node = heap_[index];
+    while(index > 0){
+        size_t parent = (index - 1) / 2;
+        if(heap_[parent]->getExpiry() <= node->getExpiry()){
+            break;
+        }
+        heapPlace(heap_[parent], index);
+        index = parent;
+    }
+    heapPlace(node, index);
+}
+
+template<class Key, class Value>
+void TTLAVLTree<Key, Value>::siftDown(size_t index)
+{
+    TTLAVLNode<Key, Value>* node = heap_[index];
+    while(true){
+        size_t child = 2 * index + 1;
+        if(child >= heap_.size()){
+            break;
+        }
+        if(child + 1 < heap_.size() && heap_[child + 1]->getExpiry() < heap_[child]->getExpiry()){
+            child++;
+        }
+        if(node->getExpiry() <= heap_[child]->getExpiry()){
+            break;
+        }
+        heapPlace(heap_[child], index);
+        index = child;
+    }
+    heapPlace(node, index);
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the TTLAVLTree class.
+  ---------------------------------------------
+*/
+
+#endif
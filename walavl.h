@@ -0,0 +1,520 @@
+#ifndef WALAVL_H
+#define WALAVL_H
+
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
+#include "avlbst.h"
+
+// Write-ahead log record framing
+//
+//   payload length   uint32
+//   checksum         uint32 (FNV-1a of the payload)
+//   payload          op byte, then the key field and, for inserts, the
+//                    value field, each encoded with SnapshotCodec; a
+//                    clear is the op byte alone
+//
+// Recovery stops at the first record that is short or fails its checksum,
+// which is what a crash in the middle of a write leaves behind.
+
+/**
+* An append-only log file with group commit. Any number of threads may
+* append() records and then commit() them; while one thread is inside
+* fdatasync, records appended by the others pile up in memory and are
+* written and synced together by the next committer, so a burst of
+* concurrent writers pays for one sync rather than one each.
+*/
+class WriteAheadLog
+{
+public:
+    WriteAheadLog();
+    ~WriteAheadLog();
+
+    void open(const std::string& path, uint64_t validLength);
+    void close();
+    uint64_t append(const std::string& payload);
+    void commit(uint64_t lsn);
+    void truncate();
+
+    static uint32_t checksum(const std::string& payload);
+    static void syncDirectory(const std::string& path);
+
+private:
+    WriteAheadLog(const WriteAheadLog&);
+    WriteAheadLog& operator=(const WriteAheadLog&);
+
+    void writeAll(const std::string& bytes);
+    void fail(const char* what);
+
+    int fd_;
+    std::mutex mutex_;
+    std::condition_variable durable_;
+    std::string pending_;
+    uint64_t appendedLsn_;
+    uint64_t durableLsn_;
+    bool flushing_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the WriteAheadLog class.
+  -----------------------------------------------
+*/
+
+inline WriteAheadLog::WriteAheadLog() :
+    fd_(-1),
+    appendedLsn_(0),
+    durableLsn_(0),
+    flushing_(false)
+{
+
+}
+
+/**
+* Closes the log like close(). A failing final sync cannot be reported
+* from a destructor; the records it did not cover are lost exactly as in
+* a crash, and recovery handles them the same way.
+*/
+inline WriteAheadLog::~WriteAheadLog()
+{
+    try{
+        close();
+    }
+    catch(const std::exception&){
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+/**
+* Opens the log for appending. Anything past validLength (a torn record
+* left by a crash) is cut off so new records follow the last good one.
+* The directory is synced too, so that a newly created log is still
+* there after a crash.
+*/
+inline void WriteAheadLog::open(const std::string& path, uint64_t validLength)
+{
+    close();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if(fd_ < 0){
+        fail("open");
+    }
+    if(::ftruncate(fd_, static_cast<off_t>(validLength)) != 0){
+        fail("ftruncate");
+    }
+    if(::lseek(fd_, 0, SEEK_END) < 0){
+        fail("lseek");
+    }
+    syncDirectory(path);
+}
+
+/**
+* Closes the log, first making every appended record durable.
+*/
+inline void WriteAheadLog::close()
+{
+    if(fd_ < 0){
+        return;
+    }
+    commit(appendedLsn_);
+    ::close(fd_);
+    fd_ = -1;
+}
+
+/**
+* Frames payload and queues it for the next sync. Returns the record's
+* sequence number, to be passed to commit().
+*/
+inline uint64_t WriteAheadLog::append(const std::string& payload)
+{
+    uint32_t len = static_cast<uint32_t>(payload.size());
+    uint32_t sum = checksum(payload);
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    pending_.append(reinterpret_cast<const char*>(&sum), sizeof(sum));
+    pending_.append(payload);
+    return ++appendedLsn_;
+}
+
+/**
+* Blocks until record lsn (and everything before it) is on disk. The
+* first waiter to find no sync in progress writes out the whole pending
+* batch and syncs it; everyone else just waits for that sync to land.
+*/
+inline void WriteAheadLog::commit(uint64_t lsn)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(durableLsn_ < lsn){
+        if(flushing_){
+            durable_.wait(lock);
+            continue;
+        }
+        flushing_ = true;
+        std::string batch;
+        batch.swap(pending_);
+        uint64_t target = appendedLsn_;
+        lock.unlock();
+        try{
+            writeAll(batch);
+            if(::fdatasync(fd_) != 0){
+                fail("fdatasync");
+            }
+        }
+        catch(...){
+            lock.lock();
+            flushing_ = false;
+            durable_.notify_all();
+            throw;
+        }
+        lock.lock();
+        durableLsn_ = target;
+        flushing_ = false;
+        durable_.notify_all();
+    }
+}
+
+/**
+* Drops every record, e.g. once they are covered by a new snapshot.
+* The caller must ensure no appends are in flight.
+*/
+inline void WriteAheadLog::truncate()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(flushing_){
+        durable_.wait(lock);
+    }
+    pending_.clear();
+    durableLsn_ = appendedLsn_;
+    if(::ftruncate(fd_, 0) != 0 || ::lseek(fd_, 0, SEEK_SET) < 0 || ::fdatasync(fd_) != 0){
+        fail("truncate");
+    }
+}
+
+/**
+* fsyncs the directory holding path, which makes a file created or
+* renamed there durable; syncing the file itself only covers its data.
+*/
+inline void WriteAheadLog::syncDirectory(const std::string& path)
+{
+    std::string::size_type slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(fd < 0){
+        throw std::runtime_error("WriteAheadLog: cannot open directory " + dir + ": " + std::strerror(errno));
+    }
+    if(::fsync(fd) != 0){
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("WriteAheadLog: cannot sync directory " + dir + ": " + std::strerror(error));
+    }
+    ::close(fd);
+}
+
+// FNV-1a, enough to tell a torn write from a complete record
+inline uint32_t WriteAheadLog::checksum(const std::string& payload)
+{
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < payload.size(); ++i){
+        hash ^= static_cast<unsigned char>(payload[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+inline void WriteAheadLog::writeAll(const std::string& bytes)
+{
+    size_t done = 0;
+    while(done < bytes.size()){
+        ssize_t n = ::write(fd_, bytes.data() + done, bytes.size() - done);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            fail("write");
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+inline void WriteAheadLog::fail(const char* what)
+{
+    throw std::runtime_error(std::string("WriteAheadLog: ") + what + ": " + std::strerror(errno));
+}
+
+/*
+  ---------------------------------------------
+  End implementations for the WriteAheadLog class.
+  ---------------------------------------------
+*/
+
+/**
+* An AVLTree whose mutations are made durable through a write-ahead log.
+* Constructing one recovers the last snapshot (see BinarySearchTree::save)
+* and replays the log on top of it. Every insert/remove is applied and
+* logged under one lock, so the log order matches the tree, and then waits
+* for its group commit outside that lock, so concurrent writers share
+* syncs. checkpoint() writes a fresh snapshot and empties the log, and
+* load() checkpoints right after replacing the contents.
+*
+* Only insert, remove and clear are synchronized; readers running
+* alongside writers need their own locking.
+*/
+template <class Key, class Value>
+class WalAVLTree : public AVLTree<Key, Value>
+{
+public:
+    WalAVLTree(const std::string& snapshotPath, const std::string& logPath);
+    virtual ~WalAVLTree();
+
+    typedef typename AVLTree<Key, Value>::iterator iterator;
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual iterator insert(iterator hint, const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    virtual void clear();
+    virtual void load(std::istream& is);
+    void checkpoint();
+
+protected:
+    enum LogOp { LOG_INSERT = 1, LOG_REMOVE = 2, LOG_CLEAR = 3 };
+
+    void writeCheckpoint();
+    uint64_t replay(std::istream& is);
+
+    std::string snapshotPath_;
+    WriteAheadLog log_;
+    std::mutex treeMutex_;
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the WalAVLTree class.
+  ---------------------------------------------
+*/
+
+template<class Key, class Value>
+WalAVLTree<Key, Value>::WalAVLTree(const std::string& snapshotPath, const std::string& logPath) :
+    snapshotPath_(snapshotPath)
+{
+    std::ifstream snapshot(snapshotPath.c_str(), std::ios::binary);
+    if(snapshot){
+        // load() would checkpoint before the log is open
+        this->loadSnapshot(snapshot);
+    }
+    uint64_t validLength = 0;
+    std::ifstream logFile(logPath.c_str(), std::ios::binary);
+    if(logFile){
+        validLength = replay(logFile);
+    }
+    log_.open(logPath, validLength);
+}
+
+// see ~WriteAheadLog for what happens if the final sync fails
+template<class Key, class Value>
+WalAVLTree<Key, Value>::~WalAVLTree()
+{
+
+}
+
+template<class Key, class Value>
+void WalAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& new_item)
+{
+    std::ostringstream record;
+    record.put(static_cast<char>(LOG_INSERT));
+    SnapshotCodec<Key>::write(record, new_item.first);
+    SnapshotCodec<Value>::write(record, new_item.second);
+    uint64_t lsn = 0;
+    {
+        std::lock_guard<std::mutex> lock(treeMutex_);
+        AVLTree<Key, Value>::insert(new_item);
+        lsn = log_.append(record.str());
+    }
+    log_.commit(lsn);
+}
+
+/**
+* Hinted insert, see AVLTree, logged like insert(item).
+*/
+template<class Key, class Value>
+typename WalAVLTree<Key, Value>::iterator
+WalAVLTree<Key, Value>::insert(iterator hint, const std::pair<const Key, Value>& new_item)
+{
+    std::ostringstream record;
+    record.put(static_cast<char>(LOG_INSERT));
+    SnapshotCodec<Key>::write(record, new_item.first);
+    SnapshotCodec<Value>::write(record, new_item.second);
+    iterator it;
+    uint64_t lsn = 0;
+    {
+        std::lock_guard<std::mutex> lock(treeMutex_);
+        it = AVLTree<Key, Value>::insert(hint, new_item);
+        lsn = log_.append(record.str());
+    }
+    log_.commit(lsn);
+    return it;
+}
+
+template<class Key, class Value>
+void WalAVLTree<Key, Value>::remove(const Key& key)
+{
+    std::ostringstream record;
+    record.put(static_cast<char>(LOG_REMOVE));
+    SnapshotCodec<Key>::write(record, key);
+    uint64_t lsn = 0;
+    {
+        std::lock_guard<std::mutex> lock(treeMutex_);
+        AVLTree<Key, Value>::remove(key);
+        lsn = log_.append(record.str());
+    }
+    log_.commit(lsn);
+}
+
+/**
+* Empties the tree with AVLTree::clear() and logs it as one record, so a
+* clear costs one sync however many entries there were.
+*/
+template<class Key, class Value>
+void WalAVLTree<Key, Value>::clear()
+{
+    std::string record(1, static_cast<char>(LOG_CLEAR));
+    uint64_t lsn = 0;
+    {
+        std::lock_guard<std::mutex> lock(treeMutex_);
+        AVLTree<Key, Value>::clear();
+        lsn = log_.append(record);
+    }
+    log_.commit(lsn);
+}
+
+/**
+* Writes a snapshot next to the old one, atomically renames it into place,
+* syncs the directory so the rename itself is durable, and only then
+* truncates the log. A crash at any point leaves either the old snapshot
+* plus the full log, or the new snapshot plus a log whose replay is a
+* no-op.
+*/
+template<class Key, class Value>
+void WalAVLTree<Key, Value>::checkpoint()
+{
+    std::lock_guard<std::mutex> lock(treeMutex_);
+    writeCheckpoint();
+}
+
+/**
+* Replaces the contents with a snapshot, then checkpoints so the snapshot
+* on disk matches; loaded entries never go through the log. If the
+* snapshot is malformed the tree is left empty, and that is checkpointed
+* too before the error is rethrown.
+*/
+template<class Key, class Value>
+void WalAVLTree<Key, Value>::load(std::istream& is)
+{
+    std::lock_guard<std::mutex> lock(treeMutex_);
+    AVLTree<Key, Value>::clear();
+    try{
+        this->loadSnapshot(is);
+    }
+    catch(...){
+        writeCheckpoint();
+        throw;
+    }
+    writeCheckpoint();
+}
+
+// checkpoint() with treeMutex_ already held
+template<class Key, class Value>
+void WalAVLTree<Key, Value>::writeCheckpoint()
+{
+    std::string temp = snapshotPath_ + ".tmp";
+    {
+        std::ofstream out(temp.c_str(), std::ios::binary | std::ios::trunc);
+        this->save(out);
+        out.flush();
+        if(!out){
+            throw std::runtime_error("WalAVLTree: failed to write " + temp);
+        }
+    }
+    int fd = ::open(temp.c_str(), O_RDONLY);
+    if(fd < 0 || ::fsync(fd) != 0){
+        if(fd >= 0) ::close(fd);
+        throw std::runtime_error("WalAVLTree: failed to sync " + temp);
+    }
+    ::close(fd);
+    if(std::rename(temp.c_str(), snapshotPath_.c_str()) != 0){
+        throw std::runtime_error("WalAVLTree: failed to install " + snapshotPath_);
+    }
+    WriteAheadLog::syncDirectory(snapshotPath_);
+    log_.truncate();
+}
+
+/**
+* Applies every intact record of the log to the tree and returns the byte
+* length of the intact prefix. A length field reaching past the end of
+* the file ends the log like any other torn record, before anything is
+* allocated for it.
+*/
+template<class Key, class Value>
+uint64_t WalAVLTree<Key, Value>::replay(std::istream& is)
+{
+    is.seekg(0, std::ios::end);
+    uint64_t fileLength = static_cast<uint64_t>(is.tellg());
+    is.seekg(0, std::ios::beg);
+    uint64_t validLength = 0;
+    while(true){
+        uint32_t len = 0;
+        uint32_t sum = 0;
+        if(!is.read(reinterpret_cast<char*>(&len), sizeof(len))
+           || !is.read(reinterpret_cast<char*>(&sum), sizeof(sum))){
+            break;
+        }
+        if(len == 0 || len > fileLength - validLength - sizeof(len) - sizeof(sum)){
+            break;
+        }
+        std::string payload(len, '\0');
+        if(!is.read(&payload[0], len) || WriteAheadLog::checksum(payload) != sum){
+            break;
+        }
+        std::istringstream record(payload);
+        try{
+            int op = record.get();
+            if(op == LOG_CLEAR){
+                AVLTree<Key, Value>::clear();
+                validLength += sizeof(len) + sizeof(sum) + len;
+                continue;
+            }
+            Key key = SnapshotCodec<Key>::read(record);
+            if(op == LOG_INSERT){
+                Value value = SnapshotCodec<Value>::read(record);
+                AVLTree<Key, Value>::insert(std::make_pair(key, value));
+            }
+            else if(op == LOG_REMOVE){
+                AVLTree<Key, Value>::remove(key);
+            }
+            else{
+                break;
+            }
+        }
+        catch(std::runtime_error&){
+            break;
+        }
+        validLength += sizeof(len) + sizeof(sum) + len;
+    }
+    return validLength;
+}
+
+/*
+  -------------------------------------------
+  End implementations for the WalAVLTree class.
+  -------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,388 @@
+#ifndef WAVLBST_H
+#define WAVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* A node for a weak AVL (rank-balanced) tree. Instead of a balance factor
+* each node stores a rank; the rank difference to each child (a missing
+* child has rank -1) must be 1 or 2, and leaves have rank 0.
+*/
+template <typename Key, typename Value>
+class WAVLNode : public Node<Key, Value>
+{
+public:
+    WAVLNode(const Key& key, const Value& value, WAVLNode<Key, Value>* parent);
+    virtual ~WAVLNode();
+
+    int8_t getRank() const;
+    void setRank(int8_t rank);
+    void updateRank(int8_t diff);
+
+    virtual WAVLNode<Key, Value>* getParent() const override;
+    virtual WAVLNode<Key, Value>* getLeft() const override;
+    virtual WAVLNode<Key, Value>* getRight() const override;
+
+protected:
+    int8_t rank_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the WAVLNode class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+WAVLNode<Key, Value>::WAVLNode(const Key& key, const Value& value, WAVLNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent), rank_(0)
+{
+
+}
+
+template<class Key, class Value>
+WAVLNode<Key, Value>::~WAVLNode()
+{
+
+}
+
+template<class Key, class Value>
+int8_t WAVLNode<Key, Value>::getRank() const
+{
+    return rank_;
+}
+
+template<class Key, class Value>
+void WAVLNode<Key, Value>::setRank(int8_t rank)
+{
+    rank_ = rank;
+}
+
+template<class Key, class Value>
+void WAVLNode<Key, Value>::updateRank(int8_t diff)
+{
+    rank_ += diff;
+}
+
+template<class Key, class Value>
+WAVLNode<Key, Value> *WAVLNode<Key, Value>::getParent() const
+{
+    return static_cast<WAVLNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+WAVLNode<Key, Value> *WAVLNode<Key, Value>::getLeft() const
+{
+    return static_cast<WAVLNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+WAVLNode<Key, Value> *WAVLNode<Key, Value>::getRight() const
+{
+    return static_cast<WAVLNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the WAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A weak AVL tree (Haeupler, Sen, Tarjan). Built only from inserts it is
+* exactly an AVL tree, but a remove does at most two rotations (one single
+* or one double) no matter how deep the tree is, where AVLTree::removeFix
+* may rotate at every level. Height stays below 2 log n.
+*
+* Shares the node plumbing, rotations and iteration of BinarySearchTree
+* with AVLTree, so the two are drop-in replacements for each other. Note
+* that BinarySearchTree::isBalanced() checks the stricter AVL shape, which
+* a WAVL tree need not have after removals; use isRankBalanced() instead.
+*/
+template <class Key, class Value>
+class WAVLTree : public BinarySearchTree<Key, Value>
+{
+public:
+    virtual void insert(const std::pair<const Key, Value> &new_item);
+    virtual void remove(const Key& key);
+    bool isRankBalanced() const;
+
+protected:
+    virtual void nodeSwap(WAVLNode<Key,Value>* n1, WAVLNode<Key,Value>* n2);
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void finishBuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight);
+
+    static int rank(WAVLNode<Key,Value>* node);
+    void insertFix(WAVLNode<Key,Value>* node);
+    void removeFix(WAVLNode<Key,Value>* parent, bool leftSide);
+    bool rankHelper(WAVLNode<Key,Value>* node) const;
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the WAVLTree class.
+  ---------------------------------------------
+*/
+
+/**
+* Rank of a node, where a missing node has rank -1.
+*/
+template<class Key, class Value>
+int WAVLTree<Key, Value>::rank(WAVLNode<Key,Value>* node)
+{
+    return node == nullptr ? -1 : node->getRank();
+}
+
+/*
+ * If key is already in the tree, the current value is
+ * overwritten with the new value.
+ */
+template<class Key, class Value>
+void WAVLTree<Key, Value>::insert(const std::pair<const Key, Value> &new_item)
+{
+    BST_STAT_TIMER(TREE_INSERT);
+    // if tree is empty, insert node at top
+    if(this->empty()){
+        this->root_ = createNode(new_item.first, new_item.second, nullptr);
+        this->size_++;
+        return;
+    }
+    // walk down tree, either finding the key or the parent of the new leaf
+    Node<Key, Value>* parent;
+    size_t depth;
+    Node<Key, Value>* existing = this->descend(new_item.first, parent, depth);
+    if(existing != nullptr){
+        existing->setValue(new_item.second);
+        return;
+    }
+    WAVLNode<Key, Value>* tempParent = static_cast<WAVLNode<Key, Value>*>(parent);
+    WAVLNode<Key, Value>* addedNode = static_cast<WAVLNode<Key, Value>*>(createNode(new_item.first, new_item.second, tempParent));
+    this->size_++;
+    if(new_item.first < tempParent->getKey()){
+        tempParent->setLeft(addedNode);
+    }
+    else{
+        tempParent->setRight(addedNode);
+    }
+    insertFix(addedNode);
+}
+
+/**
+* Repairs a 0-child (a node with the same rank as its parent) by promoting
+* parents up the tree, finishing with at most one single or double rotation.
+*/
+template<class Key, class Value>
+void WAVLTree<Key, Value>::insertFix(WAVLNode<Key,Value>* node)
+{
+    WAVLNode<Key,Value>* parent = node->getParent();
+    while(parent != nullptr && parent->getRank() == node->getRank()){
+        bool nodeIsLeft = (parent->getLeft() == node);
+        WAVLNode<Key,Value>* sibling = nodeIsLeft ? parent->getRight() : parent->getLeft();
+        // parent is 0,1: promote and continue upwards
+        if(parent->getRank() - rank(sibling) == 1){
+            parent->updateRank(1);
+            node = parent;
+            parent = node->getParent();
+            continue;
+        }
+        // parent is 0,2: rotate. inner is node's child on the sibling's side
+        WAVLNode<Key,Value>* inner = nodeIsLeft ? node->getRight() : node->getLeft();
+        if(node->getRank() - rank(inner) == 2){
+            // zig-zig
+            if(nodeIsLeft) this->rotateRight(parent);
+            else this->rotateLeft(parent);
+            parent->updateRank(-1);
+        }
+        else{
+            // zig-zag
+            if(nodeIsLeft){
+                this->rotateLeft(node);
+                this->rotateRight(parent);
+            }
+            else{
+                this->rotateRight(node);
+                this->rotateLeft(parent);
+            }
+            inner->updateRank(1);
+            node->updateRank(-1);
+            parent->updateRank(-1);
+        }
+        return;
+    }
+}
+
+/*
+ * If a node has 2 children it is swapped with its
+ * predecessor and then removed.
+ */
+template<class Key, class Value>
+void WAVLTree<Key, Value>::remove(const Key& key)
+{
+    WAVLNode<Key, Value>* removed = static_cast<WAVLNode<Key, Value>*>(this->internalFind(key));
+    if(removed == nullptr){
+        return;
+    }
+    this->uncache(removed);
+    // if two children exist, swap with pred
+    if(removed->getLeft() != nullptr && removed->getRight() != nullptr){
+        nodeSwap(static_cast<WAVLNode<Key, Value>*>(this->predecessor(removed)), removed);
+    }
+
+    WAVLNode<Key, Value>* parent = removed->getParent();
+    WAVLNode<Key, Value>* child = removed->getLeft() != nullptr ? removed->getLeft() : removed->getRight();
+    bool leftSide = (parent != nullptr && parent->getLeft() == removed);
+
+    // splice out removed, promoting its only child (if any)
+    if(child != nullptr){
+        child->setParent(parent);
+    }
+    if(parent == nullptr){
+        this->root_ = child;
+    }
+    else if(leftSide){
+        parent->setLeft(child);
+    }
+    else{
+        parent->setRight(child);
+    }
+    delete removed;
+    this->size_--;
+    removeFix(parent, leftSide);
+}
+
+/**
+* Repairs the tree after the child on leftSide of parent lost a level.
+* Demotes up the tree while that leaves a 3-child, then finishes with at
+* most one single or double rotation.
+*/
+template<class Key, class Value>
+void WAVLTree<Key, Value>::removeFix(WAVLNode<Key,Value>* parent, bool leftSide)
+{
+    if(parent == nullptr){
+        return;
+    }
+    // a leaf must have rank 0, so a former unary node may need a demotion
+    if(parent->getLeft() == nullptr && parent->getRight() == nullptr && parent->getRank() == 1){
+        parent->setRank(0);
+        WAVLNode<Key,Value>* grand = parent->getParent();
+        if(grand == nullptr){
+            return;
+        }
+        leftSide = (grand->getLeft() == parent);
+        parent = grand;
+    }
+
+    WAVLNode<Key,Value>* node = leftSide ? parent->getLeft() : parent->getRight();
+    while(parent != nullptr && parent->getRank() - rank(node) == 3){
+        WAVLNode<Key,Value>* sibling = leftSide ? parent->getRight() : parent->getLeft();
+        bool demote = false;
+        // sibling is a 2-child: demote parent
+        if(parent->getRank() - sibling->getRank() == 2){
+            demote = true;
+        }
+        // sibling is a 2,2 node: demote both
+        else if(sibling->getRank() - rank(sibling->getLeft()) == 2
+                && sibling->getRank() - rank(sibling->getRight()) == 2){
+            sibling->updateRank(-1);
+            demote = true;
+        }
+        if(demote){
+            parent->updateRank(-1);
+            node = parent;
+            parent = node->getParent();
+            if(parent != nullptr){
+                leftSide = (parent->getLeft() == node);
+            }
+            continue;
+        }
+
+        WAVLNode<Key,Value>* outer = leftSide ? sibling->getRight() : sibling->getLeft();
+        WAVLNode<Key,Value>* inner = leftSide ? sibling->getLeft() : sibling->getRight();
+        // outer nephew is a 1-child: single rotation
+        if(sibling->getRank() - rank(outer) == 1){
+            if(leftSide) this->rotateLeft(parent);
+            else this->rotateRight(parent);
+            sibling->updateRank(1);
+            parent->updateRank(-1);
+            if(parent->getLeft() == nullptr && parent->getRight() == nullptr){
+                parent->setRank(0);
+            }
+        }
+        // otherwise the inner nephew is: double rotation
+        else{
+            if(leftSide){
+                this->rotateRight(sibling);
+                this->rotateLeft(parent);
+            }
+            else{
+                this->rotateLeft(sibling);
+                this->rotateRight(parent);
+            }
+            inner->updateRank(2);
+            sibling->updateRank(-1);
+            parent->updateRank(-2);
+        }
+        return;
+    }
+}
+
+/**
+* Return true iff every rank difference is 1 or 2 and every leaf has rank 0.
+*/
+template<class Key, class Value>
+bool WAVLTree<Key, Value>::isRankBalanced() const
+{
+    return rankHelper(static_cast<WAVLNode<Key,Value>*>(this->root_));
+}
+
+template<class Key, class Value>
+bool WAVLTree<Key, Value>::rankHelper(WAVLNode<Key,Value>* node) const
+{
+    if(node == nullptr){
+        return true;
+    }
+    int left = node->getRank() - rank(node->getLeft());
+    int right = node->getRank() - rank(node->getRight());
+    if(left < 1 || left > 2 || right < 1 || right > 2){
+        return false;
+    }
+    if(node->getLeft() == nullptr && node->getRight() == nullptr && node->getRank() != 0){
+        return false;
+    }
+    return rankHelper(node->getLeft()) && rankHelper(node->getRight());
+}
+
+template<class Key, class Value>
+Node<Key, Value>* WAVLTree<Key, Value>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return new WAVLNode<Key, Value>(key, value, static_cast<WAVLNode<Key, Value>*>(parent));
+}
+
+// a perfectly balanced build is an AVL tree, so rank = height - 1
+template<class Key, class Value>
+void WAVLTree<Key, Value>::finishBuiltNode(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+    static_cast<WAVLNode<Key, Value>*>(node)->setRank(std::max(leftHeight, rightHeight));
+}
+
+template<class Key, class Value>
+void WAVLTree<Key, Value>::nodeSwap( WAVLNode<Key,Value>* n1, WAVLNode<Key,Value>* n2)
+{
+    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    int8_t tempR = n1->getRank();
+    n1->setRank(n2->getRank());
+    n2->setRank(tempR);
+}
+
+/*
+  -------------------------------------------
+  End implementations for the WAVLTree class.
+  -------------------------------------------
+*/
+
+#endif